@@ -18,6 +18,9 @@
  */
 
 #include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <string>
 #include <vector>
 #include <memory>
 
@@ -26,15 +29,20 @@
 #include <shlwapi.h>
 #include <commctrl.h>
 #include <commdlg.h>
+#include <shlobj.h>
 
 #include "Tools.h"
 #include "Compare.h"
 #include "NppHelpers.h"
 #include "LibHelpers.h"
 #include "AboutDialog.h"
+#include "GitRevisionDlg/GitRevisionDialog.h"
 #include "SettingsDialog.h"
 #include "NavDialog.h"
 #include "Engine.h"
+#include "CompareSession.h"
+#include "corpus_gen.h"
+#include "FolderFiles.h"
 #include "NppInternalDefines.h"
 #include "resource.h"
 
@@ -53,6 +61,9 @@ std::string		dLog("Compare Plugin debug log\n\n");
 DWORD			dLogTime_ms = 0;
 static LRESULT	dLogBuf = -1;
 
+// Duration of the last views compare (without the views alignment) - recorded in the compare sessions
+static DWORD	lastCompareTime_ms = 0;
+
 #endif
 
 
@@ -337,6 +348,11 @@ public:
 	CompareOptions	options;
 
 	AlignmentInfo_t	alignmentInfo;
+	DiffMap			diffMap;
+
+	// Range of alignment points [alignedFirst, alignedEnd) that currently have their blank sections applied
+	int				alignedFirst = 0;
+	int				alignedEnd = 0;
 
 	int				autoUpdateDelay = 0;
 };
@@ -474,6 +490,23 @@ struct TempMark_t
 };
 
 
+/**
+ *  \struct
+ *  \brief  Last folders compare report document and the files listed in it - one per line from firstItemLine
+ */
+struct FoldersCompareReport
+{
+	LRESULT			buffId {-1};
+
+	std::wstring	dir1;
+	std::wstring	dir2;
+
+	int				firstItemLine {0};
+
+	std::vector<FolderCompareItem>	items;
+};
+
+
 static const TempMark_t tempMark[] =
 {
 	{ TEXT(""),				TEXT("") },
@@ -495,6 +528,12 @@ std::unique_ptr<ViewLocation> storedLocation;
 bool goToFirst = false;
 bool selectionAutoRecompare = false;
 
+// Last revision diffed against by Git Diff to Revision
+TCHAR gitDiffRevision[MAX_PATH] = TEXT("HEAD");
+
+// Its listed files pairs are compared on demand
+FoldersCompareReport foldersReport;
+
 DelayedAlign	delayedAlignment;
 DelayedActivate	delayedActivation;
 DelayedClose	delayedClosure;
@@ -1207,6 +1246,143 @@ void showBlankAdjacentArrowMark(int view, int line, bool down)
 }
 
 
+// Returns the index of the first alignment point positioned after the given line in the given view
+inline int upperAlignmentPoint(const AlignmentInfo_t& alignmentInfo, const AlignmentViewData AlignmentPair::*pView,
+		int line)
+{
+	return static_cast<int>(std::upper_bound(alignmentInfo.begin(), alignmentInfo.end(), line,
+			[pView](int l, const AlignmentPair& ap) { return (l < (ap.*pView).line); }) - alignmentInfo.begin());
+}
+
+
+// Returns the line offset of the pair compare results (diff map and alignment points) in the given view
+// or -1 if they are outdated because the document has been edited since the compare
+int getCompareIndexOffset(const ComparedPair& cmpPair, int view)
+{
+	const int off = isAlignmentFirstLineInserted(view) ? 1 : 0;
+
+	return (cmpPair.diffMap.linesCount[view] + off == CallScintilla(view, SCI_GETLINECOUNT, 0, 0)) ? off : -1;
+}
+
+
+// Same as SCI_MARKERNEXT (down) / SCI_MARKERPREVIOUS (up) for diff lines but served by binary search in the diff map
+int getNextDiffLine(const ComparedPair& cmpPair, int view, int line, bool down)
+{
+	const int off = getCompareIndexOffset(cmpPair, view);
+
+	if (off < 0)
+		return CallScintilla(view, down ? SCI_MARKERNEXT : SCI_MARKERPREVIOUS, line, MARKER_MASK_LINE);
+
+	const diff_map_t& runs = cmpPair.diffMap.runs[view];
+
+	line -= off;
+
+	if (down)
+	{
+		auto run = std::lower_bound(runs.begin(), runs.end(), line,
+				[](const map_run& r, int l) { return (r.line + r.len <= l); });
+
+		return (run == runs.end()) ? -1 : std::max(run->line, line) + off;
+	}
+
+	auto run = std::upper_bound(runs.begin(), runs.end(), line,
+			[](int l, const map_run& r) { return (l < r.line); });
+
+	if (run == runs.begin())
+		return -1;
+
+	--run;
+
+	return std::min(run->line + run->len - 1, line) + off;
+}
+
+
+// Same as getNextUnmarkedLine() (down) / getPrevUnmarkedLine() (up) for diff lines but served by the diff map
+int getNextNonDiffLine(const ComparedPair& cmpPair, int view, int line, bool down)
+{
+	const int off = getCompareIndexOffset(cmpPair, view);
+
+	if (off < 0)
+		return down ? getNextUnmarkedLine(view, line, MARKER_MASK_LINE) :
+				getPrevUnmarkedLine(view, line, MARKER_MASK_LINE);
+
+	const diff_map_t& runs = cmpPair.diffMap.runs[view];
+
+	line -= off;
+
+	if (down)
+	{
+		auto run = std::lower_bound(runs.begin(), runs.end(), line,
+				[](const map_run& r, int l) { return (r.line + r.len <= l); });
+
+		// Adjacent runs of different types form one continuous diff
+		for (; run != runs.end() && run->line <= line; ++run)
+			line = run->line + run->len;
+
+		return std::min(line, cmpPair.diffMap.linesCount[view] - 1) + off;
+	}
+
+	auto run = std::upper_bound(runs.begin(), runs.end(), line,
+			[](int l, const map_run& r) { return (l < r.line); });
+
+	while (run != runs.begin())
+	{
+		--run;
+
+		if (run->line + run->len <= line)
+			break;
+
+		line = run->line - 1;
+	}
+
+	return std::max(line + off, 0);
+}
+
+
+// Returns the line in the other view that corresponds to the given one - mapped through the alignment points
+// intervals by binary search. Lines facing a blank section in the other view map to the line just before it.
+int getMatchingLine(const ComparedPair& cmpPair, int view, int line)
+{
+	const int otherView	= getOtherViewId(view);
+	const int off		= getCompareIndexOffset(cmpPair, view);
+	const int otherOff	= getCompareIndexOffset(cmpPair, otherView);
+
+	const AlignmentInfo_t& alignmentInfo = cmpPair.alignmentInfo;
+
+	if (off < 0 || otherOff < 0 || alignmentInfo.empty())
+		return otherViewMatchingLine(view, line);
+
+	const AlignmentViewData AlignmentPair::*pView	= (view == MAIN_VIEW) ? &AlignmentPair::main : &AlignmentPair::sub;
+	const AlignmentViewData AlignmentPair::*pOther	= (view == MAIN_VIEW) ? &AlignmentPair::sub : &AlignmentPair::main;
+
+	line -= off;
+
+	const int maxSize = static_cast<int>(alignmentInfo.size());
+
+	int i = upperAlignmentPoint(alignmentInfo, pView, line) - 1;
+
+	if (i < 0)
+		i = 0;
+
+	const int lineInSection = line - (alignmentInfo[i].*pView).line;
+
+	int otherLine = (alignmentInfo[i].*pOther).line + lineInSection;
+
+	if (lineInSection > 0 && i + 1 < maxSize)
+	{
+		const int otherSectionLen = (alignmentInfo[i + 1].*pOther).line - (alignmentInfo[i].*pOther).line;
+
+		if (lineInSection >= otherSectionLen)
+			otherLine = (alignmentInfo[i].*pOther).line + otherSectionLen - 1;
+	}
+
+	if (otherLine >= cmpPair.diffMap.linesCount[otherView])
+		otherLine = cmpPair.diffMap.linesCount[otherView] - 1;
+
+	return std::max(otherLine + otherOff, 0);
+}
+
+
 std::pair<int, int> jumpToNextChange(int mainStartLine, int subStartLine, bool down,
 		bool goToCornerDiff = false, bool doNotBlink = false)
 {
@@ -1227,7 +1403,7 @@ std::pair<int, int> jumpToNextChange(int mainStartLine, int subStartLine, bool d
 		if (!isLineMarked(view, currentLine, MARKER_MASK_LINE) &&
 			isAdjacentAnnotation(view, currentLine, down) &&
 			!isVisibleAdjacentAnnotation(view, currentLine, down) &&
-			isLineMarked(otherView, otherViewMatchingLine(view, currentLine) + 1, MARKER_MASK_LINE))
+			isLineMarked(otherView, getMatchingLine(*cmpPair, view, currentLine) + 1, MARKER_MASK_LINE))
 		{
 			centerAt(view, currentLine);
 			return std::make_pair(view, currentLine);
@@ -1238,10 +1414,8 @@ std::pair<int, int> jumpToNextChange(int mainStartLine, int subStartLine, bool d
 			((mainStartLine == CallScintilla(MAIN_VIEW, SCI_GETLINECOUNT, 0, 0)) &&
 			(subStartLine == CallScintilla(SUB_VIEW, SCI_GETLINECOUNT, 0, 0))));
 
-	const int nextMarker = down ? SCI_MARKERNEXT : SCI_MARKERPREVIOUS;
-
-	int mainNextLine	= CallScintilla(MAIN_VIEW, nextMarker, mainStartLine, MARKER_MASK_LINE);
-	int subNextLine		= CallScintilla(SUB_VIEW, nextMarker, subStartLine, MARKER_MASK_LINE);
+	int mainNextLine	= getNextDiffLine(*cmpPair, MAIN_VIEW, mainStartLine, down);
+	int subNextLine		= getNextDiffLine(*cmpPair, SUB_VIEW, subStartLine, down);
 
 	if (mainNextLine == mainStartLine && (!goToCornerDiff || !isCornerDiff))
 		mainNextLine = -1;
@@ -1265,7 +1439,7 @@ std::pair<int, int> jumpToNextChange(int mainStartLine, int subStartLine, bool d
 		}
 		else
 		{
-			line = otherViewMatchingLine(otherView, otherLine);
+			line = getMatchingLine(*cmpPair, otherView, otherLine);
 		}
 	}
 	else if (otherLine >= 0)
@@ -1284,7 +1458,7 @@ std::pair<int, int> jumpToNextChange(int mainStartLine, int subStartLine, bool d
 			}
 			else
 			{
-				line = otherViewMatchingLine(otherView, otherLine);
+				line = getMatchingLine(*cmpPair, otherView, otherLine);
 			}
 		}
 	}
@@ -1387,6 +1561,10 @@ std::pair<int, int> jumpToLastChange(bool goToCornerDiff = false, bool doNotBlin
 
 std::pair<int, int> jumpToChange(bool down, bool wrapAround)
 {
+	CompareList_t::iterator	cmpPair = getCompare(getCurrentBuffId());
+	if (cmpPair == compareList.end())
+		return std::make_pair(-1, -1);
+
 	std::pair<int, int> viewLoc;
 
 	int mainStartLine	= 0;
@@ -1408,13 +1586,13 @@ std::pair<int, int> jumpToChange(bool down, bool wrapAround)
 			++currentLine;
 
 		otherLine = (Settings.FollowingCaret ?
-				otherViewMatchingLine(currentView, currentLine) : getLastLine(otherView));
+				getMatchingLine(*cmpPair, currentView, currentLine) : getLastLine(otherView));
 
 		if (currentLineNotAnnotated && isLineAnnotated(otherView, otherLine))
 			++otherLine;
 
-		viewLoc = jumpToNextChange(getNextUnmarkedLine(MAIN_VIEW, mainStartLine, MARKER_MASK_LINE),
-				getNextUnmarkedLine(SUB_VIEW, subStartLine, MARKER_MASK_LINE), down);
+		viewLoc = jumpToNextChange(getNextNonDiffLine(*cmpPair, MAIN_VIEW, mainStartLine, down),
+				getNextNonDiffLine(*cmpPair, SUB_VIEW, subStartLine, down), down);
 	}
 	else
 	{
@@ -1424,10 +1602,10 @@ std::pair<int, int> jumpToChange(bool down, bool wrapAround)
 			--currentLine;
 
 		otherLine = (Settings.FollowingCaret ?
-				otherViewMatchingLine(currentView, currentLine) : getFirstLine(otherView));
+				getMatchingLine(*cmpPair, currentView, currentLine) : getFirstLine(otherView));
 
-		viewLoc = jumpToNextChange(getPrevUnmarkedLine(MAIN_VIEW, mainStartLine, MARKER_MASK_LINE),
-				getPrevUnmarkedLine(SUB_VIEW, subStartLine, MARKER_MASK_LINE), down);
+		viewLoc = jumpToNextChange(getNextNonDiffLine(*cmpPair, MAIN_VIEW, mainStartLine, down),
+				getNextNonDiffLine(*cmpPair, SUB_VIEW, subStartLine, down), down);
 	}
 
 	if (viewLoc.first < 0)
@@ -1475,8 +1653,13 @@ void resetCompareView(int view)
 }
 
 
-bool isAlignmentNeeded(int view, const AlignmentInfo_t& alignmentInfo)
+// Blank sections are applied only to the alignment points that are that many screens around the visible area
+const int cAlignWindowScreens = 3;
+
+
+bool isAlignmentNeeded(int view, const CompareList_t::iterator& cmpPair)
 {
+	const AlignmentInfo_t& alignmentInfo = cmpPair->alignmentInfo;
 	const AlignmentViewData AlignmentPair::*pView = (view == MAIN_VIEW) ? &AlignmentPair::main : &AlignmentPair::sub;
 
 	const int off		= isAlignmentFirstLineInserted(MAIN_VIEW) ? 1 : 0;
@@ -1489,14 +1672,20 @@ bool isAlignmentNeeded(int view, const AlignmentInfo_t& alignmentInfo)
 	const int lastLine = getLastLine(view);
 
 	const int maxSize = static_cast<int>(alignmentInfo.size());
-	int i;
 
-	for (i = 0; i < maxSize; ++i)
+	// Visible area is about to leave the aligned points range - move it
 	{
-		if ((alignmentInfo[i].*pView).line + off >= firstLine)
-			break;
+		const int screenLines = lastLine - firstLine + 1;
+
+		if ((cmpPair->alignedFirst > 0 &&
+				(alignmentInfo[cmpPair->alignedFirst].*pView).line + off > firstLine - screenLines) ||
+			(cmpPair->alignedEnd < maxSize &&
+				(alignmentInfo[cmpPair->alignedEnd].*pView).line + off <= lastLine + screenLines))
+			return true;
 	}
 
+	int i = upperAlignmentPoint(alignmentInfo, pView, firstLine - off - 1);
+
 	if (i == maxSize)
 		return false;
 
@@ -1528,8 +1717,10 @@ bool isAlignmentNeeded(int view, const AlignmentInfo_t& alignmentInfo)
 }
 
 
-void alignDiffs(const CompareList_t::iterator& cmpPair)
+void alignDiffs(const CompareList_t::iterator& cmpPair, int biasView = -1)
 {
+	STATS_PHASE(ALIGN_DIFFS);
+
 	const AlignmentInfo_t& alignmentInfo = cmpPair->alignmentInfo;
 
 	if (Settings.HideMatches)
@@ -1577,8 +1768,32 @@ void alignDiffs(const CompareList_t::iterator& cmpPair)
 
 	const int maxSize = static_cast<int>(alignmentInfo.size());
 
+	// Only the alignment points around the visible area are aligned. The blank section of the first one also
+	// compensates all mismatches above it so the views stay in sync - the rest is aligned on demand when scrolled to
+	int startIdx	= 0;
+	int endIdx		= maxSize;
+	{
+		if (biasView < 0)
+			biasView = getCurrentViewId();
+
+		const AlignmentViewData AlignmentPair::*pView =
+				(biasView == MAIN_VIEW) ? &AlignmentPair::main : &AlignmentPair::sub;
+
+		const int firstLine	= getFirstLine(biasView);
+		const int lastLine	= getLastLine(biasView);
+		const int margin	= (lastLine - firstLine + 1) * cAlignWindowScreens;
+
+		startIdx	= upperAlignmentPoint(alignmentInfo, pView, firstLine - margin - off);
+		endIdx		= upperAlignmentPoint(alignmentInfo, pView, lastLine + margin - off);
+
+		if (startIdx)
+			--startIdx;
+	}
+
+	int i = startIdx;
+
 	// Align diffs
-	for (int i = 0; i < maxSize &&
+	for (; i < endIdx &&
 			alignmentInfo[i].main.line + off <= mainEndLine && alignmentInfo[i].sub.line + off <= subEndLine; ++i)
 	{
 		int previousUnhiddenLine = getPreviousUnhiddenLine(MAIN_VIEW, alignmentInfo[i].main.line + off);
@@ -1618,6 +1833,9 @@ void alignDiffs(const CompareList_t::iterator& cmpPair)
 		}
 	}
 
+	cmpPair->alignedFirst	= startIdx;
+	cmpPair->alignedEnd		= (i < endIdx) ? maxSize : endIdx;
+
 	// Mark selections for clarity
 	if (cmpPair->options.selectionCompare)
 	{
@@ -1661,11 +1879,21 @@ void alignDiffs(const CompareList_t::iterator& cmpPair)
 					subAnnotation, subAnnotation);
 		}
 	}
+
+	// Compare stats cover the views first alignment only
+	STATS_STOP();
 }
 
 
 void showNavBar()
 {
+	CompareList_t::iterator cmpPair = getCompare(getCurrentBuffId());
+
+	if (cmpPair != compareList.end())
+		NavDlg.SetDiffMap(cmpPair->diffMap);
+	else
+		NavDlg.ClearDiffMap();
+
 	NavDlg.SetColors(Settings.colors);
 	NavDlg.Show();
 }
@@ -1753,14 +1981,28 @@ bool setFirst(bool currFileIsNew, bool markName = false)
 }
 
 
-void setContent(const char* content)
+void setContent(const char* content, size_t len)
+{
+	const int view = getCurrentViewId();
+
+	ScopedViewUndoCollectionBlocker undoBlock(view);
+	ScopedViewWriteEnabler writeEn(view);
+
+	CallScintilla(view, SCI_CLEARALL, 0, 0);
+	CallScintilla(view, SCI_APPENDTEXT, len, (LPARAM)content);
+	CallScintilla(view, SCI_SETSAVEPOINT, 0, 0);
+}
+
+
+// Appends to the content set by setContent() - the document is still left unmodified
+void appendContent(const char* content, size_t len)
 {
 	const int view = getCurrentViewId();
 
 	ScopedViewUndoCollectionBlocker undoBlock(view);
 	ScopedViewWriteEnabler writeEn(view);
 
-	CallScintilla(view, SCI_SETTEXT, 0, (LPARAM)content);
+	CallScintilla(view, SCI_APPENDTEXT, len, (LPARAM)content);
 	CallScintilla(view, SCI_SETSAVEPOINT, 0, 0);
 }
 
@@ -1961,7 +2203,10 @@ CompareResult runCompare(CompareList_t::iterator cmpPair)
 			TEXT("Comparing selected lines in \"%s\" vs. selected lines in \"%s\"...") :
 			TEXT("Comparing \"%s\" vs. \"%s\"..."), newName, oldName);
 
-	return compareViews(cmpPair->options, progressInfo, cmpPair->alignmentInfo);
+	cmpPair->alignedFirst	= 0;
+	cmpPair->alignedEnd		= 0;
+
+	return compareViews(cmpPair->options, progressInfo, cmpPair->alignmentInfo, cmpPair->diffMap);
 }
 
 
@@ -2054,8 +2299,16 @@ void compare(bool selectionCompare = false, bool findUniqueMode = false, bool au
 
 	selectionAutoRecompare = autoUpdating && cmpPair->options.selectionCompare;
 
+#ifdef DLOG
+	const DWORD compareStart_ms = ::GetTickCount();
+#endif
+
 	const CompareResult cmpResult = runCompare(cmpPair);
 
+#ifdef DLOG
+	lastCompareTime_ms = ::GetTickCount() - compareStart_ms;
+#endif
+
 	switch (cmpResult)
 	{
 		case CompareResult::COMPARE_MISMATCH:
@@ -2279,7 +2532,7 @@ void SvnDiff()
 }
 
 
-void GitDiff()
+void gitDiff(const TCHAR* revision)
 {
 	TCHAR file[MAX_PATH];
 
@@ -2288,149 +2541,881 @@ void GitDiff()
 	if (!checkFileExists(file))
 		return;
 
-	std::vector<char> content = GetGitFileContent(file);
+	// Scoped to free the Git content before compare
+	{
+		GitFileContent content = GetGitFileContent(file, revision);
+
+		if (!content.found())
+			return;
 
-	if (content.empty())
-		return;
+		const int view = getCurrentViewId();
 
-	if (!createTempFile(file, GIT_TEMP))
-		return;
+		// Same blob id - there is nothing to compare
+		if (IsSameGitContent(content, (const char*)CallScintilla(view, SCI_GETCHARACTERPOINTER, 0, 0),
+				CallScintilla(view, SCI_GETLENGTH, 0, 0)))
+		{
+			TCHAR msg[2 * MAX_PATH];
+
+			_sntprintf_s(msg, _countof(msg), _TRUNCATE, TEXT("File \"%s\" has no changes against Git%s%s."),
+					::PathFindFileName(file), revision ? TEXT(" revision ") : TEXT(""), revision ? revision : TEXT(""));
+			::MessageBox(nppData._nppHandle, msg, PLUGIN_NAME, MB_OK);
 
-	setContent(content.data());
-	content.clear();
+			return;
+		}
+
+		if (!createTempFile(file, GIT_TEMP))
+			return;
+
+		setContent(content.data(), content.size());
+
+		// Git content line hashes are kept by blob id so the same blob is not re-hashed on later diffs
+		uint64_t contentId;
+		std::memcpy(&contentId, content.id().id, sizeof(contentId));
+
+		setDocContentId(getCurrentViewId(), contentId);
+	}
 
 	compare(false, false);
 }
 
 
-void IgnoreSpaces()
+void GitDiff()
 {
-	Settings.IgnoreSpaces = !Settings.IgnoreSpaces;
-	::SendMessage(nppData._nppHandle, NPPM_SETMENUITEMCHECK, funcItem[CMD_IGNORE_SPACES]._cmdID,
-			(LPARAM)Settings.IgnoreSpaces);
-	Settings.markAsDirty();
+	gitDiff(NULL);
 }
 
 
-void IgnoreEmptyLines()
+void GitDiffToRevision()
 {
-	Settings.IgnoreEmptyLines = !Settings.IgnoreEmptyLines;
-	::SendMessage(nppData._nppHandle, NPPM_SETMENUITEMCHECK, funcItem[CMD_IGNORE_EMPTY_LINES]._cmdID,
-			(LPARAM)Settings.IgnoreEmptyLines);
-	Settings.markAsDirty();
+	GitRevisionDialog revisionDlg(hInstance, nppData);
+
+	if (revisionDlg.doDialog(gitDiffRevision, _countof(gitDiffRevision)) != IDOK)
+		return;
+
+	gitDiff(gitDiffRevision);
 }
 
 
-void IgnoreCase()
+bool selectFile(TCHAR* file, unsigned fileSize, const TCHAR* title)
 {
-	Settings.IgnoreCase = !Settings.IgnoreCase;
-	::SendMessage(nppData._nppHandle, NPPM_SETMENUITEMCHECK, funcItem[CMD_IGNORE_CASE]._cmdID,
-			(LPARAM)Settings.IgnoreCase);
-	Settings.markAsDirty();
+	OPENFILENAME ofn;
+
+	::ZeroMemory(&ofn, sizeof(ofn));
+
+	ofn.lStructSize	= sizeof(ofn);
+	ofn.hwndOwner	= nppData._nppHandle;
+	ofn.lpstrFilter	= TEXT("All Files (*.*)\0*.*\0");
+	ofn.lpstrFile	= file;
+	ofn.nMaxFile	= fileSize;
+	ofn.lpstrTitle	= title;
+	ofn.Flags		= OFN_FILEMUSTEXIST | OFN_PATHMUSTEXIST | OFN_HIDEREADONLY;
+
+	return (::GetOpenFileName(&ofn) != FALSE);
 }
 
 
-void DetectMoves()
+#ifdef DLOG
+
+bool selectSaveFile(TCHAR* file, unsigned fileSize, const TCHAR* title)
 {
-	Settings.DetectMoves = !Settings.DetectMoves;
-	::SendMessage(nppData._nppHandle, NPPM_SETMENUITEMCHECK, funcItem[CMD_DETECT_MOVES]._cmdID,
-			(LPARAM)Settings.DetectMoves);
-	Settings.markAsDirty();
+	OPENFILENAME ofn;
+
+	::ZeroMemory(&ofn, sizeof(ofn));
+
+	ofn.lStructSize	= sizeof(ofn);
+	ofn.hwndOwner	= nppData._nppHandle;
+	ofn.lpstrFilter	= TEXT("All Files (*.*)\0*.*\0");
+	ofn.lpstrFile	= file;
+	ofn.nMaxFile	= fileSize;
+	ofn.lpstrTitle	= title;
+	ofn.Flags		= OFN_OVERWRITEPROMPT | OFN_PATHMUSTEXIST | OFN_HIDEREADONLY;
+
+	return (::GetSaveFileName(&ofn) != FALSE);
 }
 
+#endif
 
-void HideMatches()
+
+// Multiple files selection - a single selected file is its full path, many are the folder followed by the names
+bool selectFiles(std::vector<std::wstring>& files, const TCHAR* title)
 {
-	Settings.HideMatches = !Settings.HideMatches;
-	::SendMessage(nppData._nppHandle, NPPM_SETMENUITEMCHECK, funcItem[CMD_HIDE_MATCHES]._cmdID,
-			(LPARAM)Settings.HideMatches);
-	Settings.markAsDirty();
+	std::vector<TCHAR> buf(32 * 1024, 0);
 
-	CompareList_t::iterator	cmpPair = getCompare(getCurrentBuffId());
+	OPENFILENAME ofn;
 
-	if (cmpPair != compareList.end())
+	::ZeroMemory(&ofn, sizeof(ofn));
+
+	ofn.lStructSize	= sizeof(ofn);
+	ofn.hwndOwner	= nppData._nppHandle;
+	ofn.lpstrFilter	= TEXT("All Files (*.*)\0*.*\0");
+	ofn.lpstrFile	= buf.data();
+	ofn.nMaxFile	= static_cast<DWORD>(buf.size());
+	ofn.lpstrTitle	= title;
+	ofn.Flags		= OFN_FILEMUSTEXIST | OFN_PATHMUSTEXIST | OFN_HIDEREADONLY | OFN_ALLOWMULTISELECT | OFN_EXPLORER;
+
+	if (!::GetOpenFileName(&ofn))
+		return false;
+
+	const TCHAR* name = buf.data() + _tcslen(buf.data()) + 1;
+
+	if (*name == 0)
 	{
-		ScopedIncrementer incr(notificationsLock);
+		files.emplace_back(buf.data());
+		return true;
+	}
 
-		const int view = getCurrentViewId();
-		int currentLine = getCurrentLine(view);
+	std::wstring dir = buf.data();
 
-		if (Settings.HideMatches && !isLineMarked(view, currentLine, MARKER_MASK_LINE))
-		{
-			currentLine = CallScintilla(view, SCI_MARKERNEXT, currentLine, MARKER_MASK_LINE);
+	if (dir.back() != L'\\')
+		dir += L'\\';
 
-			if (!isLineVisible(view, currentLine))
-				centerAt(view, currentLine);
+	for (; *name; name += _tcslen(name) + 1)
+		files.emplace_back(dir + name);
 
-			CallScintilla(view, SCI_GOTOLINE, currentLine, 0);
-		}
+	return true;
+}
 
-		ViewLocation loc;
 
-		const int firstLine = isLineVisible(view, currentLine) ? -1 : getFirstLine(view);
+// Unified diff hunk range - 1-based line numbers, empty range position is the line before it
+std::string toHunkRange(const section_t& lines)
+{
+	return std::to_string(lines.len ? lines.off + 1 : lines.off) + "," + std::to_string(lines.len);
+}
 
-		if (firstLine == -1)
-			loc.save(view);
 
-		CallScintilla(MAIN_VIEW, SCI_ANNOTATIONCLEARALL, 0, 0);
-		CallScintilla(SUB_VIEW, SCI_ANNOTATIONCLEARALL, 0, 0);
+// Reports are UTF-8 documents - paths are kept wide up to here and converted whole (no MAX_PATH or ANSI code page
+// limits)
+std::string toReportText(const std::wstring& text)
+{
+	const int textLen = static_cast<int>(text.size());
+	const int len = ::WideCharToMultiByte(CP_UTF8, 0, text.c_str(), textLen, NULL, 0, NULL, NULL);
 
-		alignDiffs(cmpPair);
+	std::string textA(len, '\0');
 
-		if (firstLine == -1)
-			loc.restore();
-		else
-			CallScintilla(view, SCI_SETFIRSTVISIBLELINE, CallScintilla(view, SCI_VISIBLEFROMDOCLINE, firstLine, 0), 0);
+	if (len)
+		::WideCharToMultiByte(CP_UTF8, 0, text.c_str(), textLen, &textA[0], len, NULL, NULL);
 
-		NavDlg.Update();
-	}
+	return textA;
 }
 
 
-void ShowOnlySelections()
+void newReportDoc()
 {
-	Settings.ShowOnlySelections = !Settings.ShowOnlySelections;
-	::SendMessage(nppData._nppHandle, NPPM_SETMENUITEMCHECK, funcItem[CMD_SHOW_ONLY_SEL]._cmdID,
-			(LPARAM)Settings.ShowOnlySelections);
-	Settings.markAsDirty();
+	::SendMessage(nppData._nppHandle, NPPM_MENUCOMMAND, 0, IDM_FILE_NEW);
+	::SendMessage(nppData._nppHandle, NPPM_MENUCOMMAND, 0, IDM_FORMAT_AS_UTF_8);
+}
 
-	CompareList_t::iterator	cmpPair = getCompare(getCurrentBuffId());
 
-	if (cmpPair != compareList.end())
-	{
-		ScopedIncrementer incr(notificationsLock);
+void showFilesCompareSummary(const TCHAR* oldFile, const TCHAR* newFile, const FilesCompareSummary& summary)
+{
+	std::string report;
 
-		const int view = getCurrentViewId();
-		int currentLine = getCurrentLine(view);
+	report += "--- ";
+	report += toReportText(oldFile);
+	report += "\n+++ ";
+	report += toReportText(newFile);
+	report += "\n\nLines: " + std::to_string(summary.linesCount1) + " / " + std::to_string(summary.linesCount2);
+	report += "\nRemoved lines: " + std::to_string(summary.removedLines);
+	report += "\nAdded lines: " + std::to_string(summary.addedLines);
+	report += "\nDiff hunks: " + std::to_string(summary.hunks.size()) + "\n\n";
 
-		if (Settings.ShowOnlySelections)
-		{
-			if (!isLineVisible(view, currentLine))
-				centerAt(view, currentLine);
+	// Unified diff hunk headers
+	for (const auto& hunk: summary.hunks)
+		report += "@@ -" + toHunkRange(hunk.lines1) + " +" + toHunkRange(hunk.lines2) + " @@\n";
 
-			CallScintilla(view, SCI_GOTOLINE, currentLine, 0);
-		}
+	newReportDoc();
+	::SendMessage(nppData._nppHandle, NPPM_SETBUFFERLANGTYPE, getCurrentBuffId(), L_DIFF);
 
-		ViewLocation loc;
+	setContent(report.c_str(), report.size());
+}
 
-		const int firstLine = isLineVisible(view, currentLine) ? -1 : getFirstLine(view);
 
-		if (firstLine == -1)
-			loc.save(view);
+void CompareFilesOnDisk()
+{
+	TCHAR oldFile[MAX_PATH] = TEXT("");
+	TCHAR newFile[MAX_PATH] = TEXT("");
 
-		CallScintilla(MAIN_VIEW, SCI_ANNOTATIONCLEARALL, 0, 0);
-		CallScintilla(SUB_VIEW, SCI_ANNOTATIONCLEARALL, 0, 0);
+	if (!selectFile(oldFile, _countof(oldFile), TEXT("Select Old File to Compare")) ||
+		!selectFile(newFile, _countof(newFile), TEXT("Select New File to Compare")))
+		return;
 
-		alignDiffs(cmpPair);
+	CompareOptions options;
 
-		if (firstLine == -1)
-			loc.restore();
-		else
-			CallScintilla(view, SCI_SETFIRSTVISIBLELINE, CallScintilla(view, SCI_VISIBLEFROMDOCLINE, firstLine, 0), 0);
+	options.oldFileViewId			= MAIN_VIEW;
+	options.findUniqueMode			= false;
+	options.charPrecision			= false;
+	options.ignoreSpaces			= Settings.IgnoreSpaces;
+	options.ignoreEmptyLines		= Settings.IgnoreEmptyLines;
+	options.ignoreCase				= Settings.IgnoreCase;
+	options.detectMoves				= false;
+	options.matchPercentThreshold	= Settings.MatchPercentThreshold;
+	options.selectionCompare		= false;
 
-		NavDlg.Update();
-	}
-}
+	const TCHAR* newName = ::PathFindFileName(newFile);
+	const TCHAR* oldName = ::PathFindFileName(oldFile);
+
+	TCHAR info[2 * MAX_PATH];
+	_sntprintf_s(info, _countof(info), _TRUNCATE, TEXT("Comparing \"%s\" vs. \"%s\" on disk..."), newName, oldName);
+
+	FilesCompareSummary summary;
+
+	switch (compareFiles(oldFile, newFile, options, info, summary))
+	{
+		case CompareResult::COMPARE_MISMATCH:
+			showFilesCompareSummary(oldFile, newFile, summary);
+		break;
+
+		case CompareResult::COMPARE_MATCH:
+			_sntprintf_s(info, _countof(info), _TRUNCATE, TEXT("Files \"%s\" and \"%s\" match."), newName, oldName);
+			::MessageBox(nppData._nppHandle, info, PLUGIN_NAME, MB_OK);
+		break;
+
+		case CompareResult::COMPARE_ERROR:
+			::MessageBox(nppData._nppHandle, TEXT("Failed to read the files - operation aborted."), PLUGIN_NAME, MB_OK);
+		break;
+
+		default:
+		break;
+	}
+}
+
+
+bool selectFolder(TCHAR (&dir)[MAX_PATH], const TCHAR* title)
+{
+	BROWSEINFO bi;
+
+	::ZeroMemory(&bi, sizeof(bi));
+
+	bi.hwndOwner	= nppData._nppHandle;
+	bi.lpszTitle	= title;
+	bi.ulFlags		= BIF_RETURNONLYFSDIRS | BIF_NEWDIALOGSTYLE;
+
+	LPITEMIDLIST pidl = ::SHBrowseForFolder(&bi);
+
+	if (!pidl)
+		return false;
+
+	const bool ok = (::SHGetPathFromIDList(pidl, dir) != FALSE);
+
+	::CoTaskMemFree(pidl);
+
+	return ok;
+}
+
+
+inline bool isRenamedItem(const FolderCompareItem& item)
+{
+	return (!item.path1.empty() && !item.path2.empty() && _wcsicmp(item.path1.c_str(), item.path2.c_str()));
+}
+
+
+// The listed items are appended to the report in chunks of about that size (or at least that often while the folders
+// are compared) - the whole list text is never built at once
+const size_t	cReportChunkSize		= 64 * 1024;
+const DWORD		cReportFlushPeriod_ms	= 500;
+
+
+/**
+ *  \class  FoldersReportWriter
+ *  \brief  Writes the folders compare report while the folders are compared - the report document is opened with the
+ *          first listed item (matching files are not listed) and the files counts are written at its end
+ */
+class FoldersReportWriter
+{
+public:
+	FoldersReportWriter(const TCHAR* oldDir, const TCHAR* newDir) : _oldDir(oldDir), _newDir(newDir)
+	{
+		// Listed files paths are relative to the folders
+		if (_oldDir.empty() || _oldDir.back() != L'\\')
+			_oldDir += L'\\';
+
+		if (_newDir.empty() || _newDir.back() != L'\\')
+			_newDir += L'\\';
+	}
+
+	void addItem(const FolderCompareItem& item);
+
+	// Completes the report if it is opened - complete is false if the compare did not finish
+	void finish(const FoldersCompareSummary& summary, bool complete);
+
+	inline bool isOpened() const
+	{
+		return _opened;
+	}
+
+private:
+	void open();
+	void flush();
+
+	std::wstring	_oldDir;
+	std::wstring	_newDir;
+
+	bool		_opened {false};
+	std::string	_report;
+	DWORD		_lastFlush_ms {0};
+
+	int		_changed	{0};
+	int		_renamed	{0};
+	int		_only1		{0};
+	int		_only2		{0};
+	int		_failed		{0};
+};
+
+
+void FoldersReportWriter::open()
+{
+	foldersReport = FoldersCompareReport();
+
+	std::string report;
+
+	report += "--- ";
+	report += toReportText(_oldDir);
+	report += "\n+++ ";
+	report += toReportText(_newDir);
+	report += "\n\nRun \"Compare Folders...\" on a changed or renamed file line to compare its files.\n\n";
+
+	foldersReport.dir1 = _oldDir;
+	foldersReport.dir2 = _newDir;
+	foldersReport.firstItemLine = static_cast<int>(std::count(report.begin(), report.end(), '\n'));
+
+	newReportDoc();
+	::SendMessage(nppData._nppHandle, NPPM_SETBUFFERLANGTYPE, getCurrentBuffId(), L_DIFF);
+
+	foldersReport.buffId = getCurrentBuffId();
+
+	setContent(report.c_str(), report.size());
+
+	_opened = true;
+	_lastFlush_ms = ::GetTickCount();
+}
+
+
+void FoldersReportWriter::flush()
+{
+	if (!_report.empty())
+		appendContent(_report.c_str(), _report.size());
+
+	_report.clear();
+	_lastFlush_ms = ::GetTickCount();
+}
+
+
+void FoldersReportWriter::addItem(const FolderCompareItem& item)
+{
+	const bool isRenamed = isRenamedItem(item);
+
+	if (item.state == FolderItemState::MATCH && !isRenamed)
+		return;
+
+	if (!_opened)
+		open();
+
+	switch (item.state)
+	{
+		case FolderItemState::ONLY_IN_1:
+			++_only1;
+			_report += "-  " + toReportText(item.path1);
+		break;
+
+		case FolderItemState::ONLY_IN_2:
+			++_only2;
+			_report += "+  " + toReportText(item.path2);
+		break;
+
+		case FolderItemState::COMPARE_ERROR:
+			++_failed;
+			_report += "!  " + toReportText(item.path1) + "  (failed to compare)";
+		break;
+
+		default:
+			if (isRenamed)
+			{
+				++_renamed;
+				_report += "R  " + toReportText(item.path1) + " -> " + toReportText(item.path2);
+			}
+			else
+			{
+				++_changed;
+				_report += "M  " + toReportText(item.path1);
+			}
+
+			if (item.state == FolderItemState::MISMATCH)
+				_report += "  (-" + std::to_string(item.removedLines) + " +" + std::to_string(item.addedLines) + ")";
+	}
+
+	_report += "\n";
+
+	foldersReport.items.emplace_back(item);
+
+	if (_report.size() >= cReportChunkSize || ::GetTickCount() - _lastFlush_ms >= cReportFlushPeriod_ms)
+		flush();
+}
+
+
+void FoldersReportWriter::finish(const FoldersCompareSummary& summary, bool complete)
+{
+	if (!_opened)
+		return;
+
+	if (complete)
+	{
+		_report += "\nFiles: " + std::to_string(summary.filesCount1) + " / " + std::to_string(summary.filesCount2);
+		_report += "\nChanged files: " + std::to_string(_changed);
+		_report += "\nRenamed files: " + std::to_string(_renamed);
+		_report += "\nOnly in old folder: " + std::to_string(_only1);
+		_report += "\nOnly in new folder: " + std::to_string(_only2);
+		_report += "\nFailed to compare: " + std::to_string(_failed) + "\n";
+	}
+	else
+	{
+		_report += "\nThe folders compare did not complete - the files list is partial.\n";
+	}
+
+	flush();
+}
+
+
+// Compares the files pair listed on the current line of the folders compare report - returns false if the current
+// document is not the report or the current line lists no files pair
+bool compareFoldersReportItem()
+{
+	if (foldersReport.buffId != getCurrentBuffId())
+		return false;
+
+	const int view = getCurrentViewId();
+	const int idx = CallScintilla(view, SCI_LINEFROMPOSITION, CallScintilla(view, SCI_GETCURRENTPOS, 0, 0), 0) -
+			foldersReport.firstItemLine;
+
+	if (idx < 0 || idx >= static_cast<int>(foldersReport.items.size()))
+		return false;
+
+	const FolderCompareItem& item = foldersReport.items[idx];
+
+	if (item.path1.empty() || item.path2.empty())
+		return false;
+
+	const std::wstring oldFile = foldersReport.dir1 + item.path1;
+	const std::wstring newFile = foldersReport.dir2 + item.path2;
+
+	if (!::SendMessage(nppData._nppHandle, NPPM_DOOPEN, 0, (LPARAM)oldFile.c_str()))
+		return true;
+
+	// Already compared file - its compare is simply shown
+	if (!setFirst(false))
+		return true;
+
+	if (!::SendMessage(nppData._nppHandle, NPPM_DOOPEN, 0, (LPARAM)newFile.c_str()))
+	{
+		newCompare.reset();
+		return true;
+	}
+
+	compare(false, false);
+
+	return true;
+}
+
+
+void CompareFolders()
+{
+	if (compareFoldersReportItem())
+		return;
+
+	TCHAR oldDir[MAX_PATH] = TEXT("");
+	TCHAR newDir[MAX_PATH] = TEXT("");
+
+	if (!selectFolder(oldDir, TEXT("Select Old Folder to Compare")) ||
+		!selectFolder(newDir, TEXT("Select New Folder to Compare")))
+		return;
+
+	CompareOptions options;
+
+	options.oldFileViewId			= MAIN_VIEW;
+	options.findUniqueMode			= false;
+	options.charPrecision			= false;
+	options.ignoreSpaces			= Settings.IgnoreSpaces;
+	options.ignoreEmptyLines		= Settings.IgnoreEmptyLines;
+	options.ignoreCase				= Settings.IgnoreCase;
+	options.detectMoves				= Settings.DetectMoves;
+	options.matchPercentThreshold	= Settings.MatchPercentThreshold;
+	options.selectionCompare		= false;
+
+	const TCHAR* newName = ::PathFindFileName(newDir);
+	const TCHAR* oldName = ::PathFindFileName(oldDir);
+
+	TCHAR info[2 * MAX_PATH];
+	_sntprintf_s(info, _countof(info), _TRUNCATE, TEXT("Comparing folders \"%s\" vs. \"%s\"..."), newName, oldName);
+
+	FoldersCompareSummary summary;
+	FoldersReportWriter reportWriter(oldDir, newDir);
+
+	const CompareResult result = compareFolders(oldDir, newDir, options, info, summary,
+			[&](const FolderCompareItem& item) { reportWriter.addItem(item); });
+
+	reportWriter.finish(summary, result == CompareResult::COMPARE_MISMATCH);
+
+	switch (result)
+	{
+		case CompareResult::COMPARE_MATCH:
+			_sntprintf_s(info, _countof(info), _TRUNCATE, TEXT("Folders \"%s\" and \"%s\" match."),
+					newName, oldName);
+			::MessageBox(nppData._nppHandle, info, PLUGIN_NAME, MB_OK);
+		break;
+
+		case CompareResult::COMPARE_ERROR:
+			::MessageBox(nppData._nppHandle, TEXT("Failed to read the folders - operation aborted."), PLUGIN_NAME,
+					MB_OK);
+		break;
+
+		default:
+		break;
+	}
+}
+
+
+void showThreeWayCompareSummary(const TCHAR* baseFile, const TCHAR* oursFile, const TCHAR* theirsFile,
+		const ThreeWayCompareSummary& summary)
+{
+	int changedOurs		= 0;
+	int changedTheirs	= 0;
+	int changedBoth		= 0;
+
+	std::string hunks;
+
+	// Diff3 like hunk headers - base range first
+	for (const auto& region: summary.regions)
+	{
+		const char* type;
+
+		switch (region.type)
+		{
+			case MergeRegionType::CHANGED_OURS:
+				++changedOurs;
+				type = "changed in ours";
+			break;
+
+			case MergeRegionType::CHANGED_THEIRS:
+				++changedTheirs;
+				type = "changed in theirs";
+			break;
+
+			case MergeRegionType::CHANGED_BOTH:
+				++changedBoth;
+				type = "changed the same way in both";
+			break;
+
+			case MergeRegionType::CONFLICT:
+				type = "CONFLICT";
+			break;
+
+			default:
+			continue;
+		}
+
+		hunks += "@@@ -" + toHunkRange(region.base) + " +" + toHunkRange(region.ours) + " +" +
+				toHunkRange(region.theirs) + " @@@ " + type + "\n";
+	}
+
+	std::string report;
+
+	report += "--- ";
+	report += toReportText(baseFile);
+	report += "\n+++ ";
+	report += toReportText(oursFile);
+	report += "\n+++ ";
+	report += toReportText(theirsFile);
+	report += "\n\nLines: " + std::to_string(summary.linesCountBase) + " / " +
+			std::to_string(summary.linesCountOurs) + " / " + std::to_string(summary.linesCountTheirs);
+	report += "\nChanged in ours: " + std::to_string(changedOurs);
+	report += "\nChanged in theirs: " + std::to_string(changedTheirs);
+	report += "\nChanged the same way in both: " + std::to_string(changedBoth);
+	report += "\nConflicts: " + std::to_string(summary.conflicts) + "\n\n";
+
+	report += hunks;
+
+	newReportDoc();
+	::SendMessage(nppData._nppHandle, NPPM_SETBUFFERLANGTYPE, getCurrentBuffId(), L_DIFF);
+
+	setContent(report.c_str(), report.size());
+}
+
+
+void CompareThreeWay()
+{
+	TCHAR baseFile[MAX_PATH]	= TEXT("");
+	TCHAR oursFile[MAX_PATH]	= TEXT("");
+	TCHAR theirsFile[MAX_PATH]	= TEXT("");
+
+	if (!selectFile(baseFile, _countof(baseFile), TEXT("Select Base File to Compare")) ||
+		!selectFile(oursFile, _countof(oursFile), TEXT("Select Our File to Compare")) ||
+		!selectFile(theirsFile, _countof(theirsFile), TEXT("Select Their File to Compare")))
+		return;
+
+	CompareOptions options;
+
+	options.oldFileViewId			= MAIN_VIEW;
+	options.findUniqueMode			= false;
+	options.charPrecision			= false;
+	options.ignoreSpaces			= Settings.IgnoreSpaces;
+	options.ignoreEmptyLines		= Settings.IgnoreEmptyLines;
+	options.ignoreCase				= Settings.IgnoreCase;
+	options.detectMoves				= false;
+	options.matchPercentThreshold	= Settings.MatchPercentThreshold;
+	options.selectionCompare		= false;
+
+	TCHAR info[3 * MAX_PATH];
+	_sntprintf_s(info, _countof(info), _TRUNCATE, TEXT("Comparing \"%s\" and \"%s\" to base \"%s\"..."),
+			::PathFindFileName(oursFile), ::PathFindFileName(theirsFile), ::PathFindFileName(baseFile));
+
+	ThreeWayCompareSummary summary;
+
+	switch (compareFilesThreeWay(baseFile, oursFile, theirsFile, options, info, summary))
+	{
+		case CompareResult::COMPARE_MISMATCH:
+			showThreeWayCompareSummary(baseFile, oursFile, theirsFile, summary);
+		break;
+
+		case CompareResult::COMPARE_MATCH:
+			::MessageBox(nppData._nppHandle, TEXT("Files match."), PLUGIN_NAME, MB_OK);
+		break;
+
+		case CompareResult::COMPARE_ERROR:
+			::MessageBox(nppData._nppHandle, TEXT("Failed to read the files - operation aborted."), PLUGIN_NAME, MB_OK);
+		break;
+
+		default:
+		break;
+	}
+}
+
+
+void showBaselineCompareSummary(const TCHAR* baselineFile, const std::vector<std::wstring>& files,
+		const BaselineCompareSummary& summary)
+{
+	int matching	= 0;
+	int failed		= 0;
+
+	std::string matrix = "   Lines   Removed     Added   Changed     Moved   File\n";
+
+	for (size_t i = 0; i < files.size(); ++i)
+	{
+		const BaselineVariantSummary& variant = summary.variants[i];
+
+		if (variant.result == CompareResult::COMPARE_ERROR)
+		{
+			++failed;
+			matrix += "                    (failed to compare)            ";
+		}
+		else
+		{
+			if (variant.result == CompareResult::COMPARE_MATCH)
+				++matching;
+
+			char row[64];
+
+			_snprintf_s(row, _countof(row), _TRUNCATE, "%8d  %8d  %8d  %8d  %8d   ", variant.linesCount,
+					variant.removedLines, variant.addedLines, variant.changedLines, variant.movedLines);
+
+			matrix += row;
+		}
+
+		matrix += toReportText(files[i]) + "\n";
+	}
+
+	std::string report;
+
+	report += "--- ";
+	report += toReportText(baselineFile);
+	report += "\n\nBaseline lines: " + std::to_string(summary.baselineLinesCount);
+	report += "\nCompared files: " + std::to_string(files.size());
+	report += "\nMatching files: " + std::to_string(matching);
+	report += "\nFailed to compare: " + std::to_string(failed) + "\n\n";
+
+	report += matrix;
+
+	newReportDoc();
+
+	setContent(report.c_str(), report.size());
+}
+
+
+void CompareToBaseline()
+{
+	TCHAR baselineFile[MAX_PATH] = TEXT("");
+
+	std::vector<std::wstring> files;
+
+	if (!selectFile(baselineFile, _countof(baselineFile), TEXT("Select Baseline File")) ||
+		!selectFiles(files, TEXT("Select Files to Compare to Baseline")))
+		return;
+
+	CompareOptions options;
+
+	options.oldFileViewId			= MAIN_VIEW;
+	options.findUniqueMode			= false;
+	options.charPrecision			= false;
+	options.ignoreSpaces			= Settings.IgnoreSpaces;
+	options.ignoreEmptyLines		= Settings.IgnoreEmptyLines;
+	options.ignoreCase				= Settings.IgnoreCase;
+	options.detectMoves				= Settings.DetectMoves;
+	options.matchPercentThreshold	= Settings.MatchPercentThreshold;
+	options.selectionCompare		= false;
+
+	TCHAR info[2 * MAX_PATH];
+	_sntprintf_s(info, _countof(info), _TRUNCATE, TEXT("Comparing %u files to baseline \"%s\"..."),
+			static_cast<unsigned>(files.size()), ::PathFindFileName(baselineFile));
+
+	BaselineCompareSummary summary;
+
+	switch (compareToBaseline(baselineFile, files, options, info, summary))
+	{
+		case CompareResult::COMPARE_MISMATCH:
+			showBaselineCompareSummary(baselineFile, files, summary);
+		break;
+
+		case CompareResult::COMPARE_MATCH:
+			::MessageBox(nppData._nppHandle, TEXT("All files match the baseline."), PLUGIN_NAME, MB_OK);
+		break;
+
+		case CompareResult::COMPARE_ERROR:
+			::MessageBox(nppData._nppHandle, TEXT("Failed to read the baseline file - operation aborted."),
+					PLUGIN_NAME, MB_OK);
+		break;
+
+		default:
+		break;
+	}
+}
+
+
+void IgnoreSpaces()
+{
+	Settings.IgnoreSpaces = !Settings.IgnoreSpaces;
+	::SendMessage(nppData._nppHandle, NPPM_SETMENUITEMCHECK, funcItem[CMD_IGNORE_SPACES]._cmdID,
+			(LPARAM)Settings.IgnoreSpaces);
+	Settings.markAsDirty();
+}
+
+
+void IgnoreEmptyLines()
+{
+	Settings.IgnoreEmptyLines = !Settings.IgnoreEmptyLines;
+	::SendMessage(nppData._nppHandle, NPPM_SETMENUITEMCHECK, funcItem[CMD_IGNORE_EMPTY_LINES]._cmdID,
+			(LPARAM)Settings.IgnoreEmptyLines);
+	Settings.markAsDirty();
+}
+
+
+void IgnoreCase()
+{
+	Settings.IgnoreCase = !Settings.IgnoreCase;
+	::SendMessage(nppData._nppHandle, NPPM_SETMENUITEMCHECK, funcItem[CMD_IGNORE_CASE]._cmdID,
+			(LPARAM)Settings.IgnoreCase);
+	Settings.markAsDirty();
+}
+
+
+void DetectMoves()
+{
+	Settings.DetectMoves = !Settings.DetectMoves;
+	::SendMessage(nppData._nppHandle, NPPM_SETMENUITEMCHECK, funcItem[CMD_DETECT_MOVES]._cmdID,
+			(LPARAM)Settings.DetectMoves);
+	Settings.markAsDirty();
+}
+
+
+void HideMatches()
+{
+	Settings.HideMatches = !Settings.HideMatches;
+	::SendMessage(nppData._nppHandle, NPPM_SETMENUITEMCHECK, funcItem[CMD_HIDE_MATCHES]._cmdID,
+			(LPARAM)Settings.HideMatches);
+	Settings.markAsDirty();
+
+	CompareList_t::iterator	cmpPair = getCompare(getCurrentBuffId());
+
+	if (cmpPair != compareList.end())
+	{
+		ScopedIncrementer incr(notificationsLock);
+
+		const int view = getCurrentViewId();
+		int currentLine = getCurrentLine(view);
+
+		if (Settings.HideMatches && !isLineMarked(view, currentLine, MARKER_MASK_LINE))
+		{
+			currentLine = CallScintilla(view, SCI_MARKERNEXT, currentLine, MARKER_MASK_LINE);
+
+			if (!isLineVisible(view, currentLine))
+				centerAt(view, currentLine);
+
+			CallScintilla(view, SCI_GOTOLINE, currentLine, 0);
+		}
+
+		ViewLocation loc;
+
+		const int firstLine = isLineVisible(view, currentLine) ? -1 : getFirstLine(view);
+
+		if (firstLine == -1)
+			loc.save(view);
+
+		CallScintilla(MAIN_VIEW, SCI_ANNOTATIONCLEARALL, 0, 0);
+		CallScintilla(SUB_VIEW, SCI_ANNOTATIONCLEARALL, 0, 0);
+
+		alignDiffs(cmpPair);
+
+		if (firstLine == -1)
+			loc.restore();
+		else
+			CallScintilla(view, SCI_SETFIRSTVISIBLELINE, CallScintilla(view, SCI_VISIBLEFROMDOCLINE, firstLine, 0), 0);
+
+		NavDlg.Update();
+	}
+}
+
+
+void ShowOnlySelections()
+{
+	Settings.ShowOnlySelections = !Settings.ShowOnlySelections;
+	::SendMessage(nppData._nppHandle, NPPM_SETMENUITEMCHECK, funcItem[CMD_SHOW_ONLY_SEL]._cmdID,
+			(LPARAM)Settings.ShowOnlySelections);
+	Settings.markAsDirty();
+
+	CompareList_t::iterator	cmpPair = getCompare(getCurrentBuffId());
+
+	if (cmpPair != compareList.end())
+	{
+		ScopedIncrementer incr(notificationsLock);
+
+		const int view = getCurrentViewId();
+		int currentLine = getCurrentLine(view);
+
+		if (Settings.ShowOnlySelections)
+		{
+			if (!isLineVisible(view, currentLine))
+				centerAt(view, currentLine);
+
+			CallScintilla(view, SCI_GOTOLINE, currentLine, 0);
+		}
+
+		ViewLocation loc;
+
+		const int firstLine = isLineVisible(view, currentLine) ? -1 : getFirstLine(view);
+
+		if (firstLine == -1)
+			loc.save(view);
+
+		CallScintilla(MAIN_VIEW, SCI_ANNOTATIONCLEARALL, 0, 0);
+		CallScintilla(SUB_VIEW, SCI_ANNOTATIONCLEARALL, 0, 0);
+
+		alignDiffs(cmpPair);
+
+		if (firstLine == -1)
+			loc.restore();
+		else
+			CallScintilla(view, SCI_SETFIRSTVISIBLELINE, CallScintilla(view, SCI_VISIBLEFROMDOCLINE, firstLine, 0), 0);
+
+		NavDlg.Update();
+	}
+}
 
 
 void AutoRecompare()
@@ -2539,6 +3524,8 @@ void OpenAboutDlg()
 
 	const int view = getCurrentViewId();
 
+	dLog += "\nLast compare stats:\n" + cmpStats.toJson() + "\n";
+
 	CallScintilla(view, SCI_APPENDTEXT, dLog.size(), (LPARAM)dLog.c_str());
 	CallScintilla(view, SCI_SETSAVEPOINT, 0, 0);
 
@@ -2553,6 +3540,415 @@ void OpenAboutDlg()
 }
 
 
+#ifdef DLOG
+
+void SaveCompareSession()
+{
+	CompareList_t::iterator cmpPair = getCompare(getCurrentBuffId());
+
+	if (cmpPair == compareList.end())
+	{
+		::MessageBox(nppData._nppHandle, TEXT("No active compare - operation ignored."), PLUGIN_NAME, MB_OK);
+		return;
+	}
+
+	const int choice = ::MessageBox(nppData._nppHandle,
+			TEXT("Record only the lines hashes (the documents text is not saved)?"), PLUGIN_NAME,
+			MB_YESNOCANCEL | MB_ICONQUESTION);
+
+	if (choice == IDCANCEL)
+		return;
+
+	TCHAR file[MAX_PATH] = { 0 };
+
+	if (!selectSaveFile(file, _countof(file), TEXT("Save Compare Session")))
+		return;
+
+	CompareSession session;
+
+	session.options			= cmpPair->options;
+	session.hashesOnly		= (choice == IDYES);
+	session.compareTime_ms	= lastCompareTime_ms;
+	session.stats			= cmpStats.toJson();
+
+	for (int view = MAIN_VIEW; view <= SUB_VIEW; ++view)
+	{
+		// The alignment first line is not part of the compared document
+		const int firstLine = isAlignmentFirstLineInserted(view) ? 1 : 0;
+
+		if (session.hashesOnly)
+		{
+			getViewLinesHashes(view, session.options, session.linesHashes[view], session.linesLengths[view]);
+
+			if (firstLine && !session.linesHashes[view].empty())
+			{
+				session.linesHashes[view].erase(session.linesHashes[view].begin());
+				session.linesLengths[view].erase(session.linesLengths[view].begin());
+			}
+		}
+		else
+		{
+			const int startPos = getLineStart(view, firstLine);
+			const char* text = (const char*)CallScintilla(view, SCI_GETCHARACTERPOINTER, 0, 0);
+
+			session.text[view].assign(text + startPos, CallScintilla(view, SCI_GETLENGTH, 0, 0) - startPos);
+		}
+	}
+
+	if (!saveCompareSession(file, session))
+		::MessageBox(nppData._nppHandle, TEXT("Saving compare session failed."), PLUGIN_NAME, MB_OK);
+}
+
+
+void ReplayCompareSession()
+{
+	TCHAR file[MAX_PATH] = { 0 };
+
+	if (!selectFile(file, _countof(file), TEXT("Replay Compare Session")))
+		return;
+
+	CompareSession session;
+
+	if (!loadCompareSession(file, session))
+	{
+		::MessageBox(nppData._nppHandle, TEXT("Loading compare session failed - operation aborted."),
+				PLUGIN_NAME, MB_OK);
+		return;
+	}
+
+	// The recorded documents are loaded in new files and compared through the usual path with the recorded options
+	for (int view = MAIN_VIEW; view <= SUB_VIEW; ++view)
+	{
+		::SendMessage(nppData._nppHandle, NPPM_MENUCOMMAND, 0, IDM_FILE_NEW);
+
+		const std::string text = getSessionText(session, view);
+
+		setContent(text.c_str(), text.size());
+
+		if (session.options.selectionCompare)
+		{
+			const int currentView	= getCurrentViewId();
+			const int endLine		= session.options.selections[view].second + 1;
+
+			const int endPos = (endLine < CallScintilla(currentView, SCI_GETLINECOUNT, 0, 0)) ?
+					getLineStart(currentView, endLine) : CallScintilla(currentView, SCI_GETLENGTH, 0, 0);
+
+			CallScintilla(currentView, SCI_SETSEL,
+					getLineStart(currentView, session.options.selections[view].first), endPos);
+		}
+
+		if (view == MAIN_VIEW && !setFirst(session.options.oldFileViewId != MAIN_VIEW))
+			return;
+	}
+
+	const UserSettings userSettings = Settings;
+
+	Settings.OldFileViewId		= session.options.oldFileViewId;
+	Settings.CharPrecision		= session.options.charPrecision;
+	Settings.IgnoreSpaces		= session.options.ignoreSpaces;
+	Settings.IgnoreEmptyLines	= session.options.ignoreEmptyLines;
+	Settings.IgnoreCase			= session.options.ignoreCase;
+	Settings.DetectMoves		= session.options.detectMoves;
+
+	compare(session.options.selectionCompare, session.options.findUniqueMode);
+
+	Settings = userSettings;
+
+	LOGD("Compare session replayed in " + std::to_string(lastCompareTime_ms) + " ms (recorded " +
+			std::to_string(session.compareTime_ms) + " ms)\n");
+
+	dLog += "\nRecorded compare stats:\n" + session.stats + "\n";
+}
+
+
+bool writeCorpusFile(const TCHAR* dir, const char* name, const std::string& text)
+{
+	TCHAR file[MAX_PATH];
+
+	_sntprintf_s(file, _countof(file), _TRUNCATE, TEXT("%s\\%S.txt"), dir, name);
+
+	HANDLE hFile = ::CreateFile(file, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	DWORD written = 0;
+
+	const bool ok = (::WriteFile(hFile, text.data(), static_cast<DWORD>(text.size()), &written, NULL) &&
+			written == text.size());
+
+	::CloseHandle(hFile);
+
+	return ok;
+}
+
+
+// Writes the predefined synthetic corpus pairs to the "1" and "2" sub-folders of the selected folder - they are then
+// compared with Compare Folders or opened and compared in the views (the debug log shows the compare stats)
+void GenerateCompareCorpus()
+{
+	TCHAR dir[MAX_PATH];
+
+	if (!selectFolder(dir, TEXT("Select folder to generate the compare corpus in")))
+		return;
+
+	TCHAR dir1[MAX_PATH];
+	TCHAR dir2[MAX_PATH];
+
+	_sntprintf_s(dir1, _countof(dir1), _TRUNCATE, TEXT("%s\\1"), dir);
+	_sntprintf_s(dir2, _countof(dir2), _TRUNCATE, TEXT("%s\\2"), dir);
+
+	::CreateDirectory(dir1, NULL);
+	::CreateDirectory(dir2, NULL);
+
+	for (size_t i = 0; i < corpus_specs_count; ++i)
+	{
+		std::string text1;
+		std::string text2;
+
+		generate_corpus_pair(corpus_specs[i], text1, text2);
+
+		if (!writeCorpusFile(dir1, corpus_specs[i].name, text1) || !writeCorpusFile(dir2, corpus_specs[i].name, text2))
+		{
+			::MessageBox(nppData._nppHandle, TEXT("Writing compare corpus failed - operation aborted."),
+					PLUGIN_NAME, MB_OK);
+			return;
+		}
+	}
+
+	LOGD("Compare corpus of " + std::to_string(corpus_specs_count) + " files pairs generated\n");
+}
+
+
+// Commits made by tests/make_git_test_repo.sh after its base commit - each file gets a "change N" line appended in
+// exactly one of them (N is the commit number)
+const int cGitTestRepoCommits = 8;
+
+
+bool readBenchFile(const TCHAR* file, std::string& text)
+{
+	HANDLE hFile = ::CreateFile(file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	const DWORD size = ::GetFileSize(hFile, NULL);
+
+	text.resize(size);
+
+	DWORD read = 0;
+
+	const bool ok = (size != INVALID_FILE_SIZE &&
+			(!size || (::ReadFile(hFile, &text[0], size, &read, NULL) && read == size)));
+
+	::CloseHandle(hFile);
+
+	return ok;
+}
+
+
+// Commit number of the "change N" last line of a test repository file (-1 if it has none) - lastLineLen is set to the
+// line length (with its line end)
+int getFileChangeCommit(const std::string& text, size_t& lastLineLen)
+{
+	if (text.empty() || text.back() != '\n')
+		return -1;
+
+	const size_t lineStart = text.rfind('\n', text.size() - 2) + 1;
+
+	lastLineLen = text.size() - lineStart;
+
+	if (text.compare(lineStart, 7, "change ") != 0)
+		return -1;
+
+	return std::atoi(text.c_str() + lineStart + 7);
+}
+
+
+/**
+ *  \brief  Gets the Git contents of all files of a local repository made by tests/make_git_test_repo.sh the way Git
+ *          diffs do and lists the timings and the checks results in a new document:
+ *          - the index contents with the Git sessions closed before each file (the repository and its index are
+ *            re-opened for each file as before the sessions were kept) and then with the sessions kept open;
+ *          - the contents at each revision from HEAD back to the base commit (HEAD~N). Each one is checked against
+ *            the work file - it is the same blob from the file change commit on and the file without its last line
+ *            before it.
+ */
+void BenchmarkGitDiff()
+{
+	TCHAR dir[MAX_PATH];
+
+	if (!selectFolder(dir, TEXT("Select the work folder of a repository made by make_git_test_repo.sh")))
+		return;
+
+	std::wstring workDir = dir;
+
+	if (workDir.back() != L'\\')
+		workDir += L'\\';
+
+	std::vector<folder_file> files;
+
+	if (!listFolderFiles(workDir, files))
+	{
+		::MessageBox(nppData._nppHandle, TEXT("Failed to list the folder files - operation aborted."),
+				PLUGIN_NAME, MB_OK);
+		return;
+	}
+
+	files.erase(std::remove_if(files.begin(), files.end(),
+			[](const folder_file& file) { return (file.path.compare(0, 5, L".git\\") == 0); }), files.end());
+
+	std::vector<std::wstring> paths;
+	std::vector<std::string> texts(files.size());
+
+	for (size_t i = 0; i < files.size(); ++i)
+	{
+		paths.emplace_back(workDir + files[i].path);
+
+		if (!readBenchFile(paths[i].c_str(), texts[i]))
+		{
+			::MessageBox(nppData._nppHandle, TEXT("Failed to read the folder files - operation aborted."),
+					PLUGIN_NAME, MB_OK);
+			return;
+		}
+	}
+
+	std::string report = "Git diff benchmark - " + toReportText(workDir) + " (" + std::to_string(paths.size()) +
+			" files)\n\n";
+
+	ClearGitSessions();
+
+	DWORD start_ms = ::GetTickCount();
+
+	for (const auto& path: paths)
+	{
+		ClearGitSessions();
+
+		if (!GetGitFileContent(path.c_str()).found())
+			return;
+	}
+
+	report += "Index contents, repository re-opened for each file: " + std::to_string(::GetTickCount() - start_ms) +
+			" ms\n";
+
+	ClearGitSessions();
+
+	start_ms = ::GetTickCount();
+
+	for (const auto& path: paths)
+	{
+		if (!GetGitFileContent(path.c_str()).found())
+			return;
+	}
+
+	report += "Index contents, repository kept open: " + std::to_string(::GetTickCount() - start_ms) + " ms\n\n";
+
+	int failedChecks = 0;
+
+	// Stepping back through the history - HEAD~cGitTestRepoCommits is the base commit
+	for (int back = 0; back <= cGitTestRepoCommits; ++back)
+	{
+		const std::wstring revision = L"HEAD~" + std::to_wstring(back);
+
+		start_ms = ::GetTickCount();
+
+		for (size_t i = 0; i < paths.size(); ++i)
+		{
+			const GitFileContent content = GetGitFileContent(paths[i].c_str(), revision.c_str());
+
+			if (!content.found())
+				return;
+
+			size_t lastLineLen = 0;
+
+			const int changeCommit = getFileChangeCommit(texts[i], lastLineLen);
+			const bool isChanged = (changeCommit > 0 && changeCommit <= cGitTestRepoCommits - back);
+
+			bool isOK = (changeCommit > 0 &&
+					IsSameGitContent(content, texts[i].c_str(), texts[i].size()) == isChanged);
+
+			if (isOK && !isChanged)
+				isOK = (content.size() == texts[i].size() - lastLineLen &&
+						!std::memcmp(content.data(), texts[i].c_str(), content.size()));
+
+			if (!isOK && ++failedChecks <= 10)
+				report += "Wrong content of " + toReportText(files[i].path) + " at " + toReportText(revision) + "\n";
+		}
+
+		report += toReportText(revision) + " contents: " + std::to_string(::GetTickCount() - start_ms) + " ms\n";
+	}
+
+	report += failedChecks ? "\nFailed checks: " + std::to_string(failedChecks) + "\n" : "\nAll checks passed\n";
+
+	ClearGitSessions();
+
+	newReportDoc();
+	setContent(report.c_str(), report.size());
+}
+
+
+// Compares each predefined synthetic corpus pair in the views through the usual path (with moves detection and the
+// other compare options as set) and lists the compare time and stats of each pair in a new document - the views
+// alignment is not part of them as each pair is closed right after its compare
+void BenchmarkCompareCorpus()
+{
+	if (!compareList.empty() || newCompare)
+	{
+		::MessageBox(nppData._nppHandle, TEXT("Clear all compares first - operation ignored."), PLUGIN_NAME, MB_OK);
+		return;
+	}
+
+	const UserSettings userSettings = Settings;
+
+	Settings.DetectMoves = true;
+
+	std::string report = "Compare corpus benchmark (ignore spaces: " + std::to_string(Settings.IgnoreSpaces) +
+			", ignore empty lines: " + std::to_string(Settings.IgnoreEmptyLines) + ", ignore case: " +
+			std::to_string(Settings.IgnoreCase) + ", char precision: " + std::to_string(Settings.CharPrecision) +
+			")\n";
+
+	for (size_t i = 0; i < corpus_specs_count; ++i)
+	{
+		std::string text[2];
+
+		generate_corpus_pair(corpus_specs[i], text[0], text[1]);
+
+		// The first text is the old file
+		for (int file = 0; file < 2; ++file)
+		{
+			::SendMessage(nppData._nppHandle, NPPM_MENUCOMMAND, 0, IDM_FILE_NEW);
+
+			setContent(text[file].c_str(), text[file].size());
+
+			if (file == 0 && !setFirst(false))
+			{
+				Settings = userSettings;
+				return;
+			}
+		}
+
+		compare();
+
+		STATS_STOP();
+
+		report += "\n" + std::string(corpus_specs[i].name) + ": " + std::to_string(lastCompareTime_ms) + " ms\n" +
+				cmpStats.toJson();
+
+		CompareList_t::iterator cmpPair = getCompare(getCurrentBuffId());
+
+		if (cmpPair != compareList.end())
+			closeComparePair(cmpPair);
+	}
+
+	Settings = userSettings;
+
+	newReportDoc();
+	setContent(report.c_str(), report.size());
+}
+
+#endif
+
+
 void createMenu()
 {
 	_tcscpy_s(funcItem[CMD_SET_FIRST]._itemName, nbChar, TEXT("Set as First to Compare"));
@@ -2630,6 +4026,21 @@ void createMenu()
 	funcItem[CMD_GIT_DIFF]._pShKey->_isShift		= false;
 	funcItem[CMD_GIT_DIFF]._pShKey->_key 			= 'G';
 
+	_tcscpy_s(funcItem[CMD_GIT_DIFF_REVISION]._itemName, nbChar, TEXT("Git Diff to Revision..."));
+	funcItem[CMD_GIT_DIFF_REVISION]._pFunc = GitDiffToRevision;
+
+	_tcscpy_s(funcItem[CMD_COMPARE_FILES]._itemName, nbChar, TEXT("Compare Files on Disk..."));
+	funcItem[CMD_COMPARE_FILES]._pFunc = CompareFilesOnDisk;
+
+	_tcscpy_s(funcItem[CMD_COMPARE_FOLDERS]._itemName, nbChar, TEXT("Compare Folders..."));
+	funcItem[CMD_COMPARE_FOLDERS]._pFunc = CompareFolders;
+
+	_tcscpy_s(funcItem[CMD_COMPARE_THREE_WAY]._itemName, nbChar, TEXT("Three-way Compare Files on Disk..."));
+	funcItem[CMD_COMPARE_THREE_WAY]._pFunc = CompareThreeWay;
+
+	_tcscpy_s(funcItem[CMD_COMPARE_BASELINE]._itemName, nbChar, TEXT("Compare Files on Disk to Baseline..."));
+	funcItem[CMD_COMPARE_BASELINE]._pFunc = CompareToBaseline;
+
 	_tcscpy_s(funcItem[CMD_IGNORE_SPACES]._itemName, nbChar, TEXT("Ignore Spaces"));
 	funcItem[CMD_IGNORE_SPACES]._pFunc = IgnoreSpaces;
 
@@ -2690,6 +4101,21 @@ void createMenu()
 	funcItem[CMD_SETTINGS]._pFunc = OpenSettingsDlg;
 
 #ifdef DLOG
+	_tcscpy_s(funcItem[CMD_SAVE_SESSION]._itemName, nbChar, TEXT("Save Compare Session..."));
+	funcItem[CMD_SAVE_SESSION]._pFunc = SaveCompareSession;
+
+	_tcscpy_s(funcItem[CMD_REPLAY_SESSION]._itemName, nbChar, TEXT("Replay Compare Session..."));
+	funcItem[CMD_REPLAY_SESSION]._pFunc = ReplayCompareSession;
+
+	_tcscpy_s(funcItem[CMD_GENERATE_CORPUS]._itemName, nbChar, TEXT("Generate Compare Corpus..."));
+	funcItem[CMD_GENERATE_CORPUS]._pFunc = GenerateCompareCorpus;
+
+	_tcscpy_s(funcItem[CMD_BENCHMARK_CORPUS]._itemName, nbChar, TEXT("Benchmark Compare Corpus"));
+	funcItem[CMD_BENCHMARK_CORPUS]._pFunc = BenchmarkCompareCorpus;
+
+	_tcscpy_s(funcItem[CMD_BENCHMARK_GIT]._itemName, nbChar, TEXT("Benchmark Git Diff..."));
+	funcItem[CMD_BENCHMARK_GIT]._pFunc = BenchmarkGitDiff;
+
 	_tcscpy_s(funcItem[CMD_ABOUT]._itemName, nbChar, TEXT("Show debug log"));
 #else
 	_tcscpy_s(funcItem[CMD_ABOUT]._itemName, nbChar, TEXT("Help / About..."));
@@ -2737,6 +4163,9 @@ void deinitPlugin()
 
 	NavDlg.destroy();
 
+	ClearGitSessions();
+	ClearSvnSessions();
+
 	// Deallocate shortcut
 	for (int i = 0; i < NB_MENU_COMMANDS; i++)
 	{
@@ -2791,7 +4220,10 @@ void syncViews(int biasView)
 	{
 		const int line = getCurrentLine(biasView);
 
-		otherLine = otherViewMatchingLine(biasView, line);
+		CompareList_t::iterator	cmpPair = getCompare(getCurrentBuffId());
+
+		otherLine = (cmpPair != compareList.end()) ?
+				getMatchingLine(*cmpPair, biasView, line) : otherViewMatchingLine(biasView, line);
 
 		if ((otherLine != getCurrentLine(otherView)) && !isSelection(otherView))
 		{
@@ -2957,7 +4389,7 @@ void DelayedAlign::operator()()
 	{
 		const int view = storedLocation ? storedLocation->getView() : getCurrentViewId();
 
-		realign = isAlignmentNeeded(view, alignmentInfo);
+		realign = isAlignmentNeeded(view, cmpPair);
 	}
 
 	if (realign)
@@ -2969,7 +4401,7 @@ void DelayedAlign::operator()()
 
 		selectionAutoRecompare = false;
 
-		alignDiffs(cmpPair);
+		alignDiffs(cmpPair, storedLocation ? storedLocation->getView() : getCurrentViewId());
 	}
 
 	if (goToFirst)
@@ -3116,6 +4548,13 @@ void onSciModified(SCNotification* notifyCode)
 		delayedAlignment.cancel();
 		delayedUpdate.cancel();
 
+		// Markers have been shifted / changed - published diff map is no longer accurate
+		if (notifyCode->linesAdded)
+		{
+			cmpPair->diffMap.clear();
+			NavDlg.ClearDiffMap();
+		}
+
 		if (cmpPair->options.selectionCompare && notifyCode->linesAdded)
 		{
 			const int startLine = CallScintilla(view, SCI_LINEFROMPOSITION, notifyCode->position, 0);
@@ -3546,6 +4985,9 @@ extern "C" __declspec(dllexport) void beNotified(SCNotification* notifyCode)
 		break;
 
 		case NPPN_FILEBEFORECLOSE:
+			// Engine caches lines hashes of any compared document, not only of the ones still in compare
+			invalidateLinesHashCache(notifyCode->nmhdr.idFrom);
+
 			if (newCompare && (newCompare->pair.file[0].buffId == static_cast<LRESULT>(notifyCode->nmhdr.idFrom)))
 				newCompare.reset();
 #ifdef DLOG
@@ -3568,6 +5010,10 @@ extern "C" __declspec(dllexport) void beNotified(SCNotification* notifyCode)
 
 		// This is used to monitor deletion of lines to properly clear their compare markings
 		case SCN_MODIFIED:
+			// Engine caches lines hashes of all documents so it must see their modifications in all modes
+			if (notifyCode->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT))
+				updateLinesHashCache((HWND)notifyCode->nmhdr.hwndFrom, notifyCode);
+
 			if (NppSettings::get().compareMode && !notificationsLock)
 				onSciModified(notifyCode);
 		break;
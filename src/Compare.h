@@ -28,6 +28,7 @@
 #include "menuCmdID.h"
 #include "PluginInterface.h"
 #include "UserSettings.h"
+#include "CompareStats.h"
 
 
 #ifdef DLOG
@@ -119,6 +120,11 @@ enum MENU_COMMANDS
 	CMD_LAST_SAVE_DIFF,
 	CMD_SVN_DIFF,
 	CMD_GIT_DIFF,
+	CMD_GIT_DIFF_REVISION,
+	CMD_COMPARE_FILES,
+	CMD_COMPARE_FOLDERS,
+	CMD_COMPARE_THREE_WAY,
+	CMD_COMPARE_BASELINE,
 	CMD_SEPARATOR_2,
 	CMD_IGNORE_SPACES,
 	CMD_IGNORE_EMPTY_LINES,
@@ -138,6 +144,13 @@ enum MENU_COMMANDS
 	CMD_SEPARATOR_6,
 	CMD_SETTINGS,
 	CMD_SEPARATOR_7,
+#ifdef DLOG
+	CMD_SAVE_SESSION,
+	CMD_REPLAY_SESSION,
+	CMD_GENERATE_CORPUS,
+	CMD_BENCHMARK_CORPUS,
+	CMD_BENCHMARK_GIT,
+#endif
 	CMD_ABOUT,
 	NB_MENU_COMMANDS
 };
@@ -156,6 +169,8 @@ inline LRESULT CallScintilla(int viewNum, unsigned int uMsg, uptr_t wParam, sptr
 {
 	assert(viewNum >= 0 && viewNum < 2);
 
+	STATS_ADD(SCI_MESSAGES, 1);
+
 	return sciFunc(sciPtr[viewNum], uMsg, wParam, lParam);
 }
 
@@ -0,0 +1,351 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define NOMINMAX
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include <windows.h>
+#include <tchar.h>
+#include <shlwapi.h>
+
+#include "Compare.h"
+#include "CompareCache.h"
+
+
+namespace {
+
+const TCHAR cCacheDir[]		= TEXT("ComparePluginCache");
+const TCHAR cEntryExt[]		= TEXT(".cmpcache");
+
+const uint32_t cEntryMagic		= 0x48434D43; // "CMCH"
+const uint32_t cEntryVersion	= 1;
+
+// When the cache grows over its max size the least recently used entries are removed until it is below 3/4 of it
+const uint64_t cCacheMaxSize	= 256 * 1024 * 1024;
+
+const uint64_t cPrime1	= 0x9E3779B185EBCA87ULL;
+const uint64_t cPrime2	= 0xC2B2AE3D27D4EB4FULL;
+const uint64_t cPrime3	= 0x165667B19E3779F9ULL;
+
+
+struct EntryHeader
+{
+	uint32_t	magic;
+	uint32_t	version;
+	CacheKey	key;
+	uint64_t	dataSize;
+};
+
+
+struct EntryFile
+{
+	EntryFile(const TCHAR* n, uint64_t s, const FILETIME& t) : size(s), lastUsed(t)
+	{
+		_tcscpy_s(name, _countof(name), n);
+	}
+
+	TCHAR		name[MAX_PATH];
+	uint64_t	size;
+	FILETIME	lastUsed;
+};
+
+
+inline uint64_t rotl(uint64_t val, int bits)
+{
+	return (val << bits) | (val >> (64 - bits));
+}
+
+
+inline uint64_t finalMix(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= cPrime2;
+	h ^= h >> 29;
+	h *= cPrime3;
+	h ^= h >> 32;
+
+	return h;
+}
+
+
+bool getCacheDir(TCHAR (&dir)[MAX_PATH], bool create)
+{
+	dir[0] = 0;
+
+	::SendMessage(nppData._nppHandle, NPPM_GETPLUGINSCONFIGDIR, (WPARAM)_countof(dir), (LPARAM)dir);
+
+	if (!dir[0] || !::PathAppend(dir, cCacheDir))
+		return false;
+
+	if (::PathFileExists(dir))
+		return true;
+
+	return (create && ::CreateDirectory(dir, NULL));
+}
+
+
+bool getEntryPath(const CacheKey& key, TCHAR (&path)[MAX_PATH], bool create = false)
+{
+	if (!getCacheDir(path, create))
+		return false;
+
+	TCHAR name[64];
+
+	_sntprintf_s(name, _countof(name), _TRUNCATE, TEXT("%016I64x%016I64x%s"), key.h1, key.h2, cEntryExt);
+
+	return (::PathAppend(path, name) != FALSE);
+}
+
+
+void evictEntries()
+{
+	TCHAR dir[MAX_PATH];
+
+	if (!getCacheDir(dir, false))
+		return;
+
+	TCHAR pattern[MAX_PATH];
+
+	_tcscpy_s(pattern, _countof(pattern), dir);
+
+	if (!::PathAppend(pattern, TEXT("*")))
+		return;
+
+	_tcscat_s(pattern, _countof(pattern), cEntryExt);
+
+	WIN32_FIND_DATA fd;
+
+	HANDLE hFind = ::FindFirstFile(pattern, &fd);
+
+	if (hFind == INVALID_HANDLE_VALUE)
+		return;
+
+	std::vector<EntryFile> entries;
+	uint64_t totalSize = 0;
+
+	do
+	{
+		if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			continue;
+
+		const uint64_t size = (static_cast<uint64_t>(fd.nFileSizeHigh) << 32) | fd.nFileSizeLow;
+
+		entries.emplace_back(fd.cFileName, size, fd.ftLastWriteTime);
+		totalSize += size;
+	}
+	while (::FindNextFile(hFind, &fd));
+
+	::FindClose(hFind);
+
+	if (totalSize <= cCacheMaxSize)
+		return;
+
+	std::sort(entries.begin(), entries.end(),
+			[](const EntryFile& lhs, const EntryFile& rhs)
+			{
+				return (::CompareFileTime(&lhs.lastUsed, &rhs.lastUsed) < 0);
+			});
+
+	const uint64_t targetSize = cCacheMaxSize / 4 * 3;
+
+	for (const auto& entry: entries)
+	{
+		if (totalSize <= targetSize)
+			break;
+
+		TCHAR path[MAX_PATH];
+
+		_tcscpy_s(path, _countof(path), dir);
+
+		// Entry in use (mapped by another instance) can't be deleted - it is simply skipped
+		if (::PathAppend(path, entry.name) && ::DeleteFile(path))
+			totalSize -= entry.size;
+	}
+}
+
+} // anonymous namespace
+
+
+uint64_t hashBlock(const void* data, size_t len, uint64_t seed)
+{
+	const char* p = static_cast<const char*>(data);
+
+	uint64_t h = seed + cPrime3 + static_cast<uint64_t>(len) * cPrime1;
+
+	for (; len >= sizeof(uint64_t); len -= sizeof(uint64_t), p += sizeof(uint64_t))
+	{
+		uint64_t word;
+		std::memcpy(&word, p, sizeof(word));
+
+		h ^= rotl(word * cPrime2, 31) * cPrime1;
+		h = rotl(h, 27) * cPrime1 + cPrime3;
+	}
+
+	for (; len; --len, ++p)
+	{
+		h ^= static_cast<uint64_t>(static_cast<unsigned char>(*p)) * cPrime3;
+		h = rotl(h, 11) * cPrime1;
+	}
+
+	return finalMix(h);
+}
+
+
+CacheEntryView::~CacheEntryView()
+{
+	close();
+}
+
+
+bool CacheEntryView::open(const CacheKey& key)
+{
+	close();
+
+	TCHAR path[MAX_PATH];
+
+	if (!getEntryPath(key, path))
+		return false;
+
+	// Entry write time is its last use time - updated on each open to keep the eviction order LRU
+	_file = ::CreateFile(path, GENERIC_READ | FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (_file == INVALID_HANDLE_VALUE)
+		return false;
+
+	FILETIME now;
+	::GetSystemTimeAsFileTime(&now);
+	::SetFileTime(_file, NULL, NULL, &now);
+
+	LARGE_INTEGER fileSize;
+
+	if (!::GetFileSizeEx(_file, &fileSize) || static_cast<uint64_t>(fileSize.QuadPart) < sizeof(EntryHeader) ||
+			static_cast<uint64_t>(fileSize.QuadPart) > cCacheMaxSize)
+	{
+		close();
+		return false;
+	}
+
+	_mapping = ::CreateFileMapping(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+	if (_mapping)
+		_view = static_cast<const char*>(::MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+
+	if (!_view)
+	{
+		close();
+		return false;
+	}
+
+	EntryHeader header;
+	std::memcpy(&header, _view, sizeof(header));
+
+	if (header.magic != cEntryMagic || header.version != cEntryVersion ||
+			header.key.h1 != key.h1 || header.key.h2 != key.h2 ||
+			header.dataSize != static_cast<uint64_t>(fileSize.QuadPart) - sizeof(EntryHeader))
+	{
+		close();
+		return false;
+	}
+
+	_data = _view + sizeof(EntryHeader);
+	_size = static_cast<size_t>(header.dataSize);
+
+	return true;
+}
+
+
+void CacheEntryView::close()
+{
+	if (_view)
+		::UnmapViewOfFile(_view);
+
+	if (_mapping)
+		::CloseHandle(_mapping);
+
+	if (_file != INVALID_HANDLE_VALUE)
+		::CloseHandle(_file);
+
+	_file		= INVALID_HANDLE_VALUE;
+	_mapping	= NULL;
+	_view		= nullptr;
+	_data		= nullptr;
+	_size		= 0;
+}
+
+
+bool storeCacheEntry(const CacheKey& key, const std::vector<char>& data)
+{
+	if (data.size() + sizeof(EntryHeader) > cCacheMaxSize)
+		return false;
+
+	TCHAR path[MAX_PATH];
+
+	if (!getEntryPath(key, path, true))
+		return false;
+
+	TCHAR tmpPath[MAX_PATH + 8];
+
+	_sntprintf_s(tmpPath, _countof(tmpPath), _TRUNCATE, TEXT("%s.tmp"), path);
+
+	HANDLE hFile = ::CreateFile(tmpPath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	EntryHeader header;
+
+	header.magic	= cEntryMagic;
+	header.version	= cEntryVersion;
+	header.key		= key;
+	header.dataSize	= data.size();
+
+	DWORD written = 0;
+
+	bool ok = (::WriteFile(hFile, &header, sizeof(header), &written, NULL) && written == sizeof(header));
+
+	if (ok && !data.empty())
+		ok = (::WriteFile(hFile, data.data(), static_cast<DWORD>(data.size()), &written, NULL) &&
+				written == data.size());
+
+	::CloseHandle(hFile);
+
+	// Write to a temp file and rename so a partially written entry is never seen
+	if (!ok || !::MoveFileEx(tmpPath, path, MOVEFILE_REPLACE_EXISTING))
+	{
+		::DeleteFile(tmpPath);
+		return false;
+	}
+
+	evictEntries();
+
+	return true;
+}
+
+
+void removeCacheEntry(const CacheKey& key)
+{
+	TCHAR path[MAX_PATH];
+
+	if (getEntryPath(key, path))
+		::DeleteFile(path);
+}
@@ -0,0 +1,169 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <windows.h>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+
+// 64-bit non-cryptographic hash of a memory block - processes 8 bytes at a time
+uint64_t hashBlock(const void* data, size_t len, uint64_t seed);
+
+
+struct CacheKey
+{
+	uint64_t h1 {0};
+	uint64_t h2 {0};
+};
+
+
+/**
+ *  \class  CacheWriter
+ *  \brief  Appends plain values to a cache entry buffer
+ */
+class CacheWriter
+{
+public:
+	template <typename T>
+	inline void put(const T& val)
+	{
+		const char* p = reinterpret_cast<const char*>(&val);
+		_buf.insert(_buf.end(), p, p + sizeof(T));
+	}
+
+	inline void putBytes(const void* data, size_t len)
+	{
+		const char* p = static_cast<const char*>(data);
+		_buf.insert(_buf.end(), p, p + len);
+	}
+
+	inline const std::vector<char>& buffer() const
+	{
+		return _buf;
+	}
+
+private:
+	std::vector<char> _buf;
+};
+
+
+/**
+ *  \class  CacheReader
+ *  \brief  Reads plain values back from a cache entry data - fails (and stays failed) on reading past its end
+ */
+class CacheReader
+{
+public:
+	CacheReader(const char* data, size_t size) : _pos(data), _end(data + size) {}
+
+	template <typename T>
+	inline bool get(T& val)
+	{
+		if (_pos == nullptr || static_cast<size_t>(_end - _pos) < sizeof(T))
+		{
+			_pos = nullptr;
+			return false;
+		}
+
+		std::memcpy(&val, _pos, sizeof(T));
+		_pos += sizeof(T);
+
+		return true;
+	}
+
+	inline bool getBytes(void* data, size_t len)
+	{
+		if (_pos == nullptr || static_cast<size_t>(_end - _pos) < len)
+		{
+			_pos = nullptr;
+			return false;
+		}
+
+		std::memcpy(data, _pos, len);
+		_pos += len;
+
+		return true;
+	}
+
+	// Checks that count elements of size elemSize can still be read - guards containers reserve against bad data
+	inline bool has(uint32_t count, size_t elemSize) const
+	{
+		return (_pos != nullptr && static_cast<size_t>(_end - _pos) / elemSize >= count);
+	}
+
+	inline bool ok() const
+	{
+		return (_pos != nullptr);
+	}
+
+	inline bool atEnd() const
+	{
+		return (_pos == _end);
+	}
+
+private:
+	const char*	_pos;
+	const char*	_end;
+};
+
+
+/**
+ *  \class  CacheEntryView
+ *  \brief  Read-only memory-mapped view of a cache entry in the plugin config dir. Opening an entry marks it
+ *          as most recently used.
+ */
+class CacheEntryView
+{
+public:
+	CacheEntryView() {}
+	~CacheEntryView();
+
+	bool open(const CacheKey& key);
+	void close();
+
+	inline const char* data() const
+	{
+		return _data;
+	}
+
+	inline size_t size() const
+	{
+		return _size;
+	}
+
+	CacheEntryView(const CacheEntryView&) = delete;
+	const CacheEntryView& operator=(const CacheEntryView&) = delete;
+
+private:
+	HANDLE		_file		{INVALID_HANDLE_VALUE};
+	HANDLE		_mapping	{NULL};
+	const char*	_view		{nullptr};
+
+	const char*	_data		{nullptr};
+	size_t		_size		{0};
+};
+
+
+// Stores entry data atomically replacing any old entry with the same key then evicts the least recently used
+// entries if the cache grew over its size limit. Returns false if the entry could not be written.
+bool storeCacheEntry(const CacheKey& key, const std::vector<char>& data);
+
+void removeCacheEntry(const CacheKey& key);
@@ -0,0 +1,304 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef DLOG
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <windows.h>
+
+#include "CompareSession.h"
+#include "CompareCache.h"
+
+
+namespace {
+
+const uint32_t cSessionMagic	= 0x53534D43; // "CMSS"
+const uint32_t cSessionVersion	= 1;
+
+// Session files bigger than that are not loaded
+const uint64_t cSessionMaxSize	= 1024 * 1024 * 1024;
+
+
+void writeString(CacheWriter& writer, const std::string& str)
+{
+	writer.put(static_cast<uint32_t>(str.size()));
+	writer.putBytes(str.data(), str.size());
+}
+
+
+bool readString(CacheReader& reader, std::string& str)
+{
+	uint32_t size;
+
+	if (!reader.get(size) || !reader.has(size, 1))
+		return false;
+
+	str.resize(size);
+
+	return (size == 0 || reader.getBytes(&str[0], size));
+}
+
+
+template <typename T>
+void writeVector(CacheWriter& writer, const std::vector<T>& vec)
+{
+	writer.put(static_cast<uint32_t>(vec.size()));
+
+	if (!vec.empty())
+		writer.putBytes(vec.data(), vec.size() * sizeof(T));
+}
+
+
+template <typename T>
+bool readVector(CacheReader& reader, std::vector<T>& vec)
+{
+	uint32_t size;
+
+	if (!reader.get(size) || !reader.has(size, sizeof(T)))
+		return false;
+
+	vec.resize(size);
+
+	return (size == 0 || reader.getBytes(vec.data(), size * sizeof(T)));
+}
+
+
+void writeOptions(CacheWriter& writer, const CompareOptions& options)
+{
+	writer.put(static_cast<int32_t>(options.oldFileViewId));
+	writer.put(static_cast<uint8_t>(options.findUniqueMode));
+	writer.put(static_cast<uint8_t>(options.charPrecision));
+	writer.put(static_cast<uint8_t>(options.ignoreSpaces));
+	writer.put(static_cast<uint8_t>(options.ignoreEmptyLines));
+	writer.put(static_cast<uint8_t>(options.ignoreCase));
+	writer.put(static_cast<uint8_t>(options.detectMoves));
+	writer.put(static_cast<int32_t>(options.matchPercentThreshold));
+	writer.put(static_cast<uint8_t>(options.selectionCompare));
+
+	for (const auto& sel: options.selections)
+	{
+		writer.put(static_cast<int32_t>(sel.first));
+		writer.put(static_cast<int32_t>(sel.second));
+	}
+}
+
+
+bool readOptions(CacheReader& reader, CompareOptions& options)
+{
+	int32_t oldFileViewId, matchPercentThreshold;
+	uint8_t findUniqueMode, charPrecision, ignoreSpaces, ignoreEmptyLines, ignoreCase, detectMoves, selectionCompare;
+
+	reader.get(oldFileViewId);
+	reader.get(findUniqueMode);
+	reader.get(charPrecision);
+	reader.get(ignoreSpaces);
+	reader.get(ignoreEmptyLines);
+	reader.get(ignoreCase);
+	reader.get(detectMoves);
+	reader.get(matchPercentThreshold);
+	reader.get(selectionCompare);
+
+	for (auto& sel: options.selections)
+	{
+		int32_t first, second;
+
+		reader.get(first);
+		reader.get(second);
+
+		sel.first	= first;
+		sel.second	= second;
+	}
+
+	if (!reader.ok() || (oldFileViewId != MAIN_VIEW && oldFileViewId != SUB_VIEW))
+		return false;
+
+	options.oldFileViewId			= oldFileViewId;
+	options.findUniqueMode			= (findUniqueMode != 0);
+	options.charPrecision			= (charPrecision != 0);
+	options.ignoreSpaces			= (ignoreSpaces != 0);
+	options.ignoreEmptyLines		= (ignoreEmptyLines != 0);
+	options.ignoreCase				= (ignoreCase != 0);
+	options.detectMoves				= (detectMoves != 0);
+	options.matchPercentThreshold	= matchPercentThreshold;
+	options.selectionCompare		= (selectionCompare != 0);
+
+	return true;
+}
+
+} // anonymous namespace
+
+
+bool saveCompareSession(const TCHAR* file, const CompareSession& session)
+{
+	CacheWriter writer;
+
+	writer.put(cSessionMagic);
+	writer.put(cSessionVersion);
+
+	writeOptions(writer, session.options);
+
+	writer.put(static_cast<uint8_t>(session.hashesOnly));
+
+	for (int view = MAIN_VIEW; view <= SUB_VIEW; ++view)
+	{
+		if (session.hashesOnly)
+		{
+			writeVector(writer, session.linesHashes[view]);
+			writeVector(writer, session.linesLengths[view]);
+		}
+		else
+		{
+			writeString(writer, session.text[view]);
+		}
+	}
+
+	writer.put(session.compareTime_ms);
+	writeString(writer, session.stats);
+
+	const std::vector<char>& data = writer.buffer();
+
+	HANDLE hFile = ::CreateFile(file, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	DWORD written = 0;
+
+	const bool ok = (::WriteFile(hFile, data.data(), static_cast<DWORD>(data.size()), &written, NULL) &&
+			written == data.size());
+
+	::CloseHandle(hFile);
+
+	if (!ok)
+		::DeleteFile(file);
+
+	return ok;
+}
+
+
+bool loadCompareSession(const TCHAR* file, CompareSession& session)
+{
+	HANDLE hFile = ::CreateFile(file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+
+	if (!::GetFileSizeEx(hFile, &fileSize) || static_cast<uint64_t>(fileSize.QuadPart) > cSessionMaxSize)
+	{
+		::CloseHandle(hFile);
+		return false;
+	}
+
+	std::vector<char> data(static_cast<size_t>(fileSize.QuadPart));
+
+	DWORD read = 0;
+
+	const bool ok = data.empty() ||
+			(::ReadFile(hFile, data.data(), static_cast<DWORD>(data.size()), &read, NULL) && read == data.size());
+
+	::CloseHandle(hFile);
+
+	if (!ok)
+		return false;
+
+	CacheReader reader(data.data(), data.size());
+
+	uint32_t magic, version;
+
+	if (!reader.get(magic) || !reader.get(version) || magic != cSessionMagic || version != cSessionVersion)
+		return false;
+
+	if (!readOptions(reader, session.options))
+		return false;
+
+	uint8_t hashesOnly;
+
+	if (!reader.get(hashesOnly))
+		return false;
+
+	session.hashesOnly = (hashesOnly != 0);
+
+	for (int view = MAIN_VIEW; view <= SUB_VIEW; ++view)
+	{
+		if (session.hashesOnly)
+		{
+			if (!readVector(reader, session.linesHashes[view]) || !readVector(reader, session.linesLengths[view]) ||
+					session.linesHashes[view].size() != session.linesLengths[view].size())
+				return false;
+		}
+		else
+		{
+			if (!readString(reader, session.text[view]))
+				return false;
+		}
+	}
+
+	return (reader.get(session.compareTime_ms) && readString(reader, session.stats) && reader.atEnd());
+}
+
+
+std::string getSessionText(const CompareSession& session, int view)
+{
+	if (!session.hashesOnly)
+		return session.text[view];
+
+	// Lines equal as compared might differ in raw length (like "a b" and "ab" if spaces are ignored) - all lines of
+	// a hash, in both views, get the first recorded length of that hash so they stay equal
+	std::unordered_map<uint64_t, int> hashLengths;
+
+	for (int v = 0; v < 2; ++v)
+	{
+		for (size_t i = 0; i < session.linesHashes[v].size(); ++i)
+			hashLengths.emplace(session.linesHashes[v][i], session.linesLengths[v][i]);
+	}
+
+	const std::vector<uint64_t>& hashes = session.linesHashes[view];
+
+	std::string text;
+
+	for (size_t i = 0; i < hashes.size(); ++i)
+	{
+		if (i)
+			text += '\n';
+
+		const int length = hashLengths[hashes[i]];
+
+		if (length <= 0)
+			continue;
+
+		char hex[20];
+		_snprintf_s(hex, _countof(hex), _TRUNCATE, "%016I64x", hashes[i]);
+
+		// Hash hex digits repeated to the recorded line length (but never shorter so different lines stay different)
+		const int len = (length > 16) ? length : 16;
+
+		for (int pos = 0; pos < len; pos += 16)
+			text.append(hex, (len - pos < 16) ? len - pos : 16);
+	}
+
+	return text;
+}
+
+#endif
@@ -0,0 +1,58 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifdef DLOG
+
+#include <windows.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Engine.h"
+
+
+/**
+ *  \struct CompareSession
+ *  \brief  Recorded views compare - its options, both documents (their text or, for privacy, only their lines
+ *          hashes and lengths) and the compare timing results
+ */
+struct CompareSession
+{
+	CompareOptions	options;
+	bool			hashesOnly {false};
+
+	// Indexed by view id
+	std::string				text[2];
+	std::vector<uint64_t>	linesHashes[2];
+	std::vector<int>		linesLengths[2];
+
+	uint32_t	compareTime_ms {0};
+	std::string	stats;
+};
+
+
+bool saveCompareSession(const TCHAR* file, const CompareSession& session);
+bool loadCompareSession(const TCHAR* file, CompareSession& session);
+
+// Gets the view document text to replay - the recorded one or, if only lines hashes are recorded, synthetic lines
+// that are equal exactly where the recorded lines were equal (as compared with the recorded options)
+std::string getSessionText(const CompareSession& session, int view);
+
+#endif
@@ -0,0 +1,112 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef DLOG
+
+#include <cstdio>
+#include <cstring>
+
+#include "CompareStats.h"
+
+
+namespace {
+
+const char* const cPhaseNames[NB_STATS_PHASES] =
+{
+	"getLines",
+	"diffLines",
+	"findMoves",
+	"compareBlocks",
+	"markAllDiffs",
+	"alignDiffs"
+};
+
+const char* const cCounterNames[NB_STATS_COUNTERS] =
+{
+	"linesHashed",
+	"diagonalsExplored",
+	"charDiffPairs",
+	"scintillaMessages"
+};
+
+} // anonymous namespace
+
+
+CompareStats cmpStats;
+
+
+CompareStats::CompareStats() : _thread(0)
+{
+	clear();
+}
+
+
+void CompareStats::start()
+{
+	clear();
+
+	_thread = ::GetCurrentThreadId();
+}
+
+
+void CompareStats::stop()
+{
+	_thread = 0;
+}
+
+
+void CompareStats::clear()
+{
+	std::memset(_phaseTicks, 0, sizeof(_phaseTicks));
+	std::memset(_phaseCalls, 0, sizeof(_phaseCalls));
+	std::memset(_counters, 0, sizeof(_counters));
+}
+
+
+std::string CompareStats::toJson() const
+{
+	LARGE_INTEGER freq;
+	::QueryPerformanceFrequency(&freq);
+
+	char buf[128];
+
+	std::string json("{\n\t\"phases\": {\n");
+
+	for (int i = 0; i < NB_STATS_PHASES; ++i)
+	{
+		_snprintf_s(buf, _countof(buf), _TRUNCATE, "\t\t\"%s\": { \"ms\": %.3f, \"calls\": %u }%s\n", cPhaseNames[i],
+				static_cast<double>(_phaseTicks[i]) * 1000.0 / static_cast<double>(freq.QuadPart), _phaseCalls[i],
+				(i + 1 < NB_STATS_PHASES) ? "," : "");
+		json += buf;
+	}
+
+	json += "\t},\n\t\"counters\": {\n";
+
+	for (int i = 0; i < NB_STATS_COUNTERS; ++i)
+	{
+		_snprintf_s(buf, _countof(buf), _TRUNCATE, "\t\t\"%s\": %I64u%s\n", cCounterNames[i], _counters[i],
+				(i + 1 < NB_STATS_COUNTERS) ? "," : "");
+		json += buf;
+	}
+
+	json += "\t}\n}\n";
+
+	return json;
+}
+
+#endif
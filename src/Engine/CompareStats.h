@@ -0,0 +1,143 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifdef DLOG
+
+#include <windows.h>
+#include <cstdint>
+#include <string>
+
+
+enum STATS_PHASES
+{
+	PHASE_GET_LINES = 0,
+	PHASE_DIFF_LINES,
+	PHASE_FIND_MOVES,
+	PHASE_COMPARE_BLOCKS,
+	PHASE_MARK_ALL_DIFFS,
+	PHASE_ALIGN_DIFFS,
+	NB_STATS_PHASES
+};
+
+
+enum STATS_COUNTERS
+{
+	COUNTER_LINES_HASHED = 0,
+	COUNTER_DIAGONALS_EXPLORED,
+	COUNTER_CHAR_DIFF_PAIRS,
+	COUNTER_SCI_MESSAGES,
+	NB_STATS_COUNTERS
+};
+
+
+/**
+ *  \class  CompareStats
+ *  \brief  Views compare phases times and work counters. Collected only on the thread that started the collection
+ *          (worker threads and on disk compares are not counted) until it is stopped.
+ */
+class CompareStats
+{
+public:
+	CompareStats();
+
+	void start();
+	void stop();
+
+	inline bool isCollecting() const
+	{
+		return (_thread != 0 && ::GetCurrentThreadId() == _thread);
+	}
+
+	inline void add(STATS_COUNTERS counter, uint64_t val)
+	{
+		if (isCollecting())
+			_counters[counter] += val;
+	}
+
+	inline void addTime(STATS_PHASES phase, LONGLONG ticks)
+	{
+		_phaseTicks[phase] += ticks;
+		++_phaseCalls[phase];
+	}
+
+	std::string toJson() const;
+
+private:
+	void clear();
+
+	DWORD		_thread;
+
+	LONGLONG	_phaseTicks[NB_STATS_PHASES];
+	unsigned	_phaseCalls[NB_STATS_PHASES];
+	uint64_t	_counters[NB_STATS_COUNTERS];
+};
+
+
+extern CompareStats	cmpStats;
+
+
+/**
+ *  \class  ScopedPhaseTimer
+ *  \brief  Adds the time spent in its scope to a compare phase stats if they were collected on its creation
+ *          (collection might be stopped inside the scope)
+ */
+class ScopedPhaseTimer
+{
+public:
+	ScopedPhaseTimer(STATS_PHASES phase) : _phase(phase), _collecting(cmpStats.isCollecting())
+	{
+		if (_collecting)
+			::QueryPerformanceCounter(&_start);
+	}
+
+	~ScopedPhaseTimer()
+	{
+		if (_collecting)
+		{
+			LARGE_INTEGER end;
+			::QueryPerformanceCounter(&end);
+
+			cmpStats.addTime(_phase, end.QuadPart - _start.QuadPart);
+		}
+	}
+
+	ScopedPhaseTimer(const ScopedPhaseTimer&) = delete;
+	const ScopedPhaseTimer& operator=(const ScopedPhaseTimer&) = delete;
+
+private:
+	const STATS_PHASES	_phase;
+	const bool			_collecting;
+	LARGE_INTEGER		_start;
+};
+
+
+	#define STATS_START()				cmpStats.start()
+	#define STATS_STOP()				cmpStats.stop()
+	#define STATS_PHASE(PHASE)			ScopedPhaseTimer phaseTimer_##PHASE(PHASE_##PHASE)
+	#define STATS_ADD(COUNTER, VAL)		cmpStats.add(COUNTER_##COUNTER, VAL)
+
+#else
+
+	#define STATS_START()
+	#define STATS_STOP()
+	#define STATS_PHASE(PHASE)
+	#define STATS_ADD(COUNTER, VAL)
+
+#endif
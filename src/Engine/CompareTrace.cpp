@@ -0,0 +1,196 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef DTRACE
+
+#include <cstdio>
+#include <string>
+#include <new>
+
+#include <windows.h>
+#include <tchar.h>
+#include <shlwapi.h>
+
+#include "Compare.h"
+#include "CompareTrace.h"
+
+
+namespace {
+
+const TCHAR cTraceFile[] = TEXT("ComparePluginTrace.json");
+
+// Trace JSON is written out in chunks of about that size
+const size_t cWriteChunkSize = 1024 * 1024;
+
+
+bool writeChunk(HANDLE hFile, std::string& chunk)
+{
+	DWORD written = 0;
+
+	const bool ok = (::WriteFile(hFile, chunk.data(), static_cast<DWORD>(chunk.size()), &written, NULL) &&
+			written == chunk.size());
+
+	chunk.clear();
+
+	return ok;
+}
+
+} // anonymous namespace
+
+
+CompareTracer cmpTracer;
+
+
+CompareTracer::~CompareTracer()
+{
+	if (_tlsIdx != TLS_OUT_OF_INDEXES)
+		::TlsFree(_tlsIdx);
+}
+
+
+void CompareTracer::start()
+{
+	// A new TLS index has all threads values zeroed so no thread is mapped to a buffer of a previous trace
+	if (_tlsIdx != TLS_OUT_OF_INDEXES)
+		::TlsFree(_tlsIdx);
+
+	_tlsIdx = ::TlsAlloc();
+
+	_threadsCount	= 0;
+	_mainThreadId	= ::GetCurrentThreadId();
+
+	LARGE_INTEGER now;
+	::QueryPerformanceCounter(&now);
+
+	_startTicks = now.QuadPart;
+
+	_active = (_tlsIdx != TLS_OUT_OF_INDEXES);
+}
+
+
+CompareTracer::ThreadEvents* CompareTracer::getThreadEvents()
+{
+	ThreadEvents* events = static_cast<ThreadEvents*>(::TlsGetValue(_tlsIdx));
+
+	if (events)
+		return (events != &_untraced) ? events : nullptr;
+
+	const LONG slot = ::InterlockedIncrement(&_threadsCount) - 1;
+
+	events = (slot < cMaxThreads) ? &_threads[slot] : &_untraced;
+
+	// Buffers are kept for the next traces
+	if (events != &_untraced && !events->buf)
+	{
+		events->buf.reset(new (std::nothrow) TraceEvent[cRingSize]);
+
+		if (!events->buf)
+			events = &_untraced;
+	}
+
+	::TlsSetValue(_tlsIdx, events);
+
+	if (events == &_untraced)
+		return nullptr;
+
+	events->threadId	= ::GetCurrentThreadId();
+	events->count		= 0;
+
+	return events;
+}
+
+
+void CompareTracer::dump()
+{
+	if (!_active)
+		return;
+
+	_active = false;
+
+	TCHAR path[MAX_PATH];
+	path[0] = 0;
+
+	::SendMessage(nppData._nppHandle, NPPM_GETPLUGINSCONFIGDIR, (WPARAM)_countof(path), (LPARAM)path);
+
+	if (!path[0] || !::PathAppend(path, cTraceFile))
+		return;
+
+	HANDLE hFile = ::CreateFile(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (hFile == INVALID_HANDLE_VALUE)
+		return;
+
+	LARGE_INTEGER freq;
+	::QueryPerformanceFrequency(&freq);
+
+	const double usPerTick = 1000000.0 / static_cast<double>(freq.QuadPart);
+	const DWORD pid = ::GetCurrentProcessId();
+
+	const int threadsCount = (_threadsCount < cMaxThreads) ? static_cast<int>(_threadsCount) : cMaxThreads;
+
+	std::string json("{\"traceEvents\":[\n");
+	bool ok = true;
+
+	char buf[256];
+	const char* sep = "";
+
+	for (int i = 0; ok && i < threadsCount; ++i)
+	{
+		const ThreadEvents& events = _threads[i];
+
+		_snprintf_s(buf, _countof(buf), _TRUNCATE,
+				"%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%lu,\"tid\":%lu,\"args\":{\"name\":\"%s\"}}",
+				sep, pid, events.threadId, (events.threadId == _mainThreadId) ? "main" : "worker");
+		json += buf;
+		sep = ",\n";
+
+		// Only the last cRingSize events are left if the buffer has wrapped
+		const uint64_t first = (events.count > cRingSize) ? events.count - cRingSize : 0;
+
+		for (uint64_t e = first; ok && e < events.count; ++e)
+		{
+			const TraceEvent& ev = events.buf[e % cRingSize];
+			const double ts = static_cast<double>(ev.ticks - _startTicks) * usPerTick;
+
+			if (ev.arg >= 0)
+				_snprintf_s(buf, _countof(buf), _TRUNCATE,
+						"%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%lu,\"tid\":%lu,\"args\":{\"arg\":%d}}",
+						sep, ev.name, ev.type, ts, pid, events.threadId, ev.arg);
+			else
+				_snprintf_s(buf, _countof(buf), _TRUNCATE,
+						"%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%lu,\"tid\":%lu}",
+						sep, ev.name, ev.type, ts, pid, events.threadId);
+			json += buf;
+
+			if (json.size() >= cWriteChunkSize)
+				ok = writeChunk(hFile, json);
+		}
+	}
+
+	json += "\n]}\n";
+
+	if (ok)
+		ok = writeChunk(hFile, json);
+
+	::CloseHandle(hFile);
+
+	if (!ok)
+		::DeleteFile(path);
+}
+
+#endif
@@ -0,0 +1,146 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifdef DTRACE
+
+#include <windows.h>
+#include <cstdint>
+#include <memory>
+
+
+/**
+ *  \class  CompareTracer
+ *  \brief  Records compare spans begin / end events to per-thread ring buffers and dumps them as Chrome trace JSON
+ *          (chrome://tracing or Perfetto UI). Each buffer is written only by its own thread so recording takes
+ *          no locks - a thread finds its buffer through a TLS index. When a buffer wraps its oldest events are lost.
+ */
+class CompareTracer
+{
+public:
+	CompareTracer() {}
+	~CompareTracer();
+
+	// Starts a new trace recording - called on the main thread before any worker thread is created
+	void start();
+
+	// Stops recording and writes the trace to the plugins config dir - called after all worker threads are done
+	void dump();
+
+	inline void record(const char* name, char type, int arg)
+	{
+		if (!_active)
+			return;
+
+		ThreadEvents* events = getThreadEvents();
+
+		if (events == nullptr)
+			return;
+
+		TraceEvent& ev = events->buf[events->count % cRingSize];
+
+		LARGE_INTEGER now;
+		::QueryPerformanceCounter(&now);
+
+		ev.name		= name;
+		ev.ticks	= now.QuadPart;
+		ev.arg		= arg;
+		ev.type		= type;
+
+		++events->count;
+	}
+
+	CompareTracer(const CompareTracer&) = delete;
+	const CompareTracer& operator=(const CompareTracer&) = delete;
+
+private:
+	static const int		cMaxThreads	= 32;
+	static const unsigned	cRingSize	= 64 * 1024;
+
+	struct TraceEvent
+	{
+		const char*	name;
+		LONGLONG	ticks;
+		int			arg;
+		char		type;
+	};
+
+	struct ThreadEvents
+	{
+		DWORD							threadId {0};
+		uint64_t						count {0};
+		std::unique_ptr<TraceEvent[]>	buf;
+	};
+
+	ThreadEvents* getThreadEvents();
+
+	volatile bool	_active {false};
+	DWORD			_tlsIdx {TLS_OUT_OF_INDEXES};
+	DWORD			_mainThreadId {0};
+	LONGLONG		_startTicks {0};
+
+	volatile LONG	_threadsCount {0};
+	ThreadEvents	_threads[cMaxThreads];
+
+	// TLS value of the threads over cMaxThreads - their events are not recorded
+	ThreadEvents	_untraced;
+};
+
+
+extern CompareTracer cmpTracer;
+
+
+/**
+ *  \class  ScopedTraceSpan
+ *  \brief  Records a trace span covering its scope
+ */
+class ScopedTraceSpan
+{
+public:
+	ScopedTraceSpan(const char* name, int arg = -1) : _name(name)
+	{
+		cmpTracer.record(_name, 'B', arg);
+	}
+
+	~ScopedTraceSpan()
+	{
+		cmpTracer.record(_name, 'E', -1);
+	}
+
+	ScopedTraceSpan(const ScopedTraceSpan&) = delete;
+	const ScopedTraceSpan& operator=(const ScopedTraceSpan&) = delete;
+
+private:
+	const char* const _name;
+};
+
+
+	#define TRACE_START()				cmpTracer.start()
+	#define TRACE_DUMP()				cmpTracer.dump()
+	#define TRACE_SPAN(NAME)			ScopedTraceSpan traceSpan_(NAME)
+	#define TRACE_SPAN_ARG(NAME, ARG)	ScopedTraceSpan traceSpan_(NAME, ARG)
+
+#else
+
+	#define TRACE_START()
+	#define TRACE_DUMP()
+	#define TRACE_SPAN(NAME)
+	#define TRACE_SPAN_ARG(NAME, ARG)
+
+#endif
@@ -20,31 +20,43 @@
 #define NOMINMAX
 
 #include <climits>
+#include <cwchar>
 #include <exception>
+#include <new>
+#include <stdexcept>
 #include <cstdint>
 #include <utility>
+#include <list>
+#include <iterator>
+#include <memory>
+#include <functional>
 #include <unordered_set>
 #include <set>
 #include <unordered_map>
 #include <map>
+#include <string>
 #include <algorithm>
 
 #include <windows.h>
 
 #include "Engine.h"
+#include "CompareCache.h"
+#include "CompareTrace.h"
+#include "casefold.h"
+#include "wordseg.h"
+#include "lru_cache.h"
 #include "diff.h"
+#include "lcs.h"
+#include "folder_compare.h"
+#include "FolderFiles.h"
+#include "WorkersJob.h"
 #include "ProgressDlg.h"
 
+#define ANCHORED_DIFF_DIAGONALS(COUNT)	STATS_ADD(DIAGONALS_EXPLORED, COUNT)
+#include "anchored_diff.h"
 
-namespace {
-
-enum class charType
-{
-	SPACECHAR,
-	ALPHANUMCHAR,
-	OTHERCHAR
-};
 
+namespace {
 
 struct Line
 {
@@ -74,6 +86,24 @@ struct Line
 };
 
 
+// Line of a file compared on disk - kept in mapped temp file arrays so it has only the hash (its line number is
+// kept apart, if needed at all). It has no plain diff key so DiffCalc reads it in place instead of copying the keys.
+struct LineHash
+{
+	uint64_t hash;
+
+	inline bool operator==(const LineHash& rhs) const
+	{
+		return (hash == rhs.hash);
+	}
+
+	inline bool operator!=(const LineHash& rhs) const
+	{
+		return (hash != rhs.hash);
+	}
+};
+
+
 struct Word
 {
 	int pos;
@@ -131,6 +161,54 @@ struct Char
 	}
 };
 
+}
+
+
+// Elements equality is a plain key compare - let DiffCalc compare the keys in bulk
+template <>
+struct diff_key<Line>
+{
+	static const bool plain = true;
+
+	typedef uint64_t type;
+
+	static inline type get(const Line& elem)
+	{
+		return elem.hash;
+	}
+};
+
+
+template <>
+struct diff_key<Word>
+{
+	static const bool plain = true;
+
+	typedef uint64_t type;
+
+	static inline type get(const Word& elem)
+	{
+		return elem.hash;
+	}
+};
+
+
+template <>
+struct diff_key<Char>
+{
+	static const bool plain = true;
+
+	typedef char type;
+
+	static inline type get(const Char& elem)
+	{
+		return elem.ch;
+	}
+};
+
+
+namespace {
+
 
 struct DocCmpInfo
 {
@@ -141,6 +219,11 @@ struct DocCmpInfo
 
 	std::vector<Line>		lines;
 	std::unordered_set<int>	nonUniqueLines;
+
+	// Raw (no ignore options) hashes of all document lines - set by getLines(), points to the lines hash cache
+	const std::vector<uint64_t>*	rawHashes {nullptr};
+
+	diff_map_t*	diffMap {nullptr};
 };
 
 
@@ -214,6 +297,44 @@ struct MatchInfo
 
 const uint64_t cHashSeed = 0x84222325;
 
+// Minimum lines count (in both documents) to use pre-alignment - smaller documents are diffed directly
+const int		cPreAlignMinLines	= 16384;
+// Max edit cost of each diffed lines window of huge files compared on disk - costlier windows are marked changed as
+// a whole (open documents are always diffed exactly)
+const int		cHugeLinesMaxCost	= 8 * 1024;
+
+// Lines of at least that many chars are compared by anchored words diff instead of full chars LCS and words diff
+const int		cLongLineMinChars		= 64 * 1024;
+// Max edit cost of a words diff window between long lines anchors - costlier windows are marked changed as a whole
+const int		cLongLineWindowMaxCost	= 1024;
+// Max chars count of changed words sections of long lines that are still resolved to chars
+const int		cLongLineMaxSectionChars	= 1024;
+
+// Line hash variants - raw, ignoring spaces, ignoring case and ignoring both
+const int		cHashVariants		= 4;
+
+// Max number of documents whose line hashes are kept between compares
+const int		cLinesHashCacheDocs	= 8;
+// Max number of known contents (like Git blobs) whose line hashes are kept after their documents are dropped
+const size_t	cContentLinesHashesCount	= 8;
+
+// Lines pairs chars similarity (LCS length) and lines pairs compare results kept between compares
+const size_t	cLinesSimilarityCacheSize	= 64 * 1024;
+const size_t	cLinesPairDiffCacheSize		= 4 * 1024;
+// Max chars count kept in the per-compare lines chars cache - it is cleared between blocks when exceeded
+const size_t	cLineCharsCacheMaxChars		= 4 * 1024 * 1024;
+
+// Minimum lines count (of both documents together) to use the results cache - smaller documents are compared
+// faster than their cached results are hashed and loaded
+const int		cCacheMinLines		= 20000;
+const uint32_t	cCacheFormatVersion	= 2;
+// Seed of the results cache key second half
+const uint64_t	cCacheKeySeed2		= 0x9E3779B97F4A7C15ULL;
+
+// Max sizes sum of the files pairs being compared at once by the folders compare workers (a single bigger pair is
+// still compared but alone) - keeps the loaded lines memory bounded regardless of the folders contents
+const uint64_t	cFoldersCompareMaxLoad		= 256 * 1024 * 1024;
+
 inline uint64_t Hash(uint64_t hval, char letter)
 {
 	hval ^= static_cast<uint64_t>(letter);
@@ -238,11 +359,222 @@ void swap(DocCmpInfo& lhs, DocCmpInfo& rhs)
 	std::swap(lhs.blockDiffMask, rhs.blockDiffMask);
 	std::swap(lhs.lines, rhs.lines);
 	std::swap(lhs.nonUniqueLines, rhs.nonUniqueLines);
+	std::swap(lhs.rawHashes, rhs.rawHashes);
+	std::swap(lhs.diffMap, rhs.diffMap);
+}
+
+
+inline void addMapRun(const DocCmpInfo& doc, int line, int len, int marker)
+{
+	if (doc.diffMap)
+		add_map_run(*doc.diffMap, line, len, toMapType(marker));
+}
+
+
+void publishDiffMap(DiffMap& diffMap)
+{
+	normalize_diff_map(diffMap.runs[MAIN_VIEW]);
+	normalize_diff_map(diffMap.runs[SUB_VIEW]);
+
+	diffMap.linesCount[MAIN_VIEW]	= CallScintilla(MAIN_VIEW, SCI_GETLINECOUNT, 0, 0);
+	diffMap.linesCount[SUB_VIEW]	= CallScintilla(SUB_VIEW, SCI_GETLINECOUNT, 0, 0);
+}
+
+
+// Hash zero terminated line text according to the compare options
+uint64_t getLineHash(std::vector<char>& line, int lineLen, const CompareOptions& options)
+{
+	uint64_t hash = cHashSeed;
+
+	if (options.ignoreCase)
+		fold_case_utf8(line.data(), lineLen);
+
+	for (int i = 0; i < lineLen; ++i)
+	{
+		if (options.ignoreSpaces && (line[i] == ' ' || line[i] == '\t'))
+			continue;
+
+		hash = Hash(hash, line[i]);
+	}
+
+	return hash;
+}
+
+
+// Line hash variants index - bit 0 set if spaces are ignored, bit 1 set if case is ignored
+inline int hashVariant(const CompareOptions& options)
+{
+	return (options.ignoreSpaces ? 1 : 0) | (options.ignoreCase ? 2 : 0);
+}
+
+
+/**
+ *  \brief  Hashes line text in all hashing variants at once (each one equal to getLineHash() with the corresponding
+ *          options). Case folded characters are fed directly to the case-insensitive hashes in the same scan.
+ */
+void getLineHashes(const std::vector<char>& line, int lineLen, uint64_t (&hashes)[cHashVariants])
+{
+	for (auto& hash: hashes)
+		hash = cHashSeed;
+
+	for (int i = 0; i < lineLen;)
+	{
+		char folded[4];
+		int charLen = 1;
+
+		if (line[i] & 0x80)
+			charLen = fold_utf8_char(line.data() + i, lineLen - i, folded);
+		else
+			folded[0] = fold_ascii(line[i]);
+
+		for (int j = 0; j < charLen; ++j, ++i)
+		{
+			hashes[0] = Hash(hashes[0], line[i]);
+			hashes[2] = Hash(hashes[2], folded[j]);
+
+			if (line[i] != ' ' && line[i] != '\t')
+			{
+				hashes[1] = Hash(hashes[1], line[i]);
+				hashes[3] = Hash(hashes[3], folded[j]);
+			}
+		}
+	}
+}
+
+
+/**
+ *  \struct DocLinesHashes
+ *  \brief  Cached document lines hashes - kept in sync with the document edits by updateLinesHashCache() so
+ *          only the changed lines are re-hashed on the next compare. Document length and lines count are tracked
+ *          as well and the cache is dropped if they don't match the document (a missed modification). Reloads are
+ *          not notified so the cache of a document not edited since its last compare is also dropped if it might
+ *          have been reloaded since (see isDocReloadPossible()). All hashing variants are kept as parallel arrays so toggling an ignore option needs no re-hashing.
+ */
+struct DocLinesHashes
+{
+	DocLinesHashes(int doc, int len, int count) : sciDoc(doc), length(len), linesCount(count) {}
+
+	int		sciDoc;
+	int		length;
+	int		linesCount;
+
+	// Buffer of the document when last compared - the hashes are dropped when it is closed
+	LRESULT		buffId {0};
+
+	// Document modified state and its file last write time when last compared and whether it has been edited since
+	bool		modified {false};
+	uint64_t	fileTime {0};
+	bool		edited {false};
+
+	// Id of the document content if it is known and unmodified (0 otherwise) - see setDocContentId()
+	uint64_t	contentId {0};
+
+	std::vector<uint64_t>	hashes[cHashVariants];
+	std::vector<char>		valid;
+};
+
+
+// Most recently used first
+std::list<DocLinesHashes> linesHashCache;
+
+// Line hashes of dropped documents with known content keyed by the content id
+lru_cache<uint64_t, DocLinesHashes> contentLinesHashes(cContentLinesHashesCount);
+
+
+inline std::list<DocLinesHashes>::iterator findDocLinesHashes(int sciDoc)
+{
+	return std::find_if(linesHashCache.begin(), linesHashCache.end(),
+			[sciDoc](const DocLinesHashes& doc) { return (doc.sciDoc == sciDoc); });
+}
+
+
+// Drops document line hashes keeping them by content id if the document content is known
+void dropDocLinesHashes(std::list<DocLinesHashes>::iterator docHashes)
+{
+	if (docHashes->contentId)
+		contentLinesHashes.put(docHashes->contentId, std::move(*docHashes));
+
+	linesHashCache.erase(docHashes);
+}
+
+
+// File last write time of the view document (0 if it has no file)
+uint64_t getDocFileTime(int view)
+{
+	TCHAR file[MAX_PATH];
+	WIN32_FILE_ATTRIBUTE_DATA attr;
+
+	if (::SendMessage(nppData._nppHandle, NPPM_GETFULLPATHFROMBUFFERID, getCurrentBuffId(view), (LPARAM)file) < 0 ||
+			!::GetFileAttributesEx(file, GetFileExInfoStandard, &attr))
+		return 0;
+
+	return (static_cast<uint64_t>(attr.ftLastWriteTime.dwHighDateTime) << 32) | attr.ftLastWriteTime.dwLowDateTime;
+}
+
+
+// A reload leaves the document unmodified (and it reads the file again - an unmodified document is changed by it only
+// if its file has changed) - cheap checks instead of hashing the whole document on each compare
+inline bool isDocReloadPossible(const DocLinesHashes& docHashes, bool modified, uint64_t fileTime)
+{
+	return (!docHashes.edited && !modified && (docHashes.modified || docHashes.fileTime != fileTime));
+}
+
+
+DocLinesHashes& getCachedLinesHashes(int view)
+{
+	const int sciDoc		= getDocId(view);
+	const int length		= CallScintilla(view, SCI_GETLENGTH, 0, 0);
+	const int linesCount	= CallScintilla(view, SCI_GETLINECOUNT, 0, 0);
+
+	const bool modified		= (CallScintilla(view, SCI_GETMODIFY, 0, 0) != 0);
+	const uint64_t fileTime	= getDocFileTime(view);
+
+	auto docHashes = findDocLinesHashes(sciDoc);
+
+	if (docHashes != linesHashCache.end() && (docHashes->length != length || docHashes->linesCount != linesCount ||
+			isDocReloadPossible(*docHashes, modified, fileTime)))
+	{
+		LOGD("Outdated lines hash cache dropped\n");
+
+		linesHashCache.erase(docHashes);
+		docHashes = linesHashCache.end();
+	}
+
+	if (docHashes == linesHashCache.end())
+	{
+		linesHashCache.emplace_front(sciDoc, length, linesCount);
+
+		if (static_cast<int>(linesHashCache.size()) > cLinesHashCacheDocs)
+			dropDocLinesHashes(std::prev(linesHashCache.end()));
+	}
+	else if (docHashes != linesHashCache.begin())
+	{
+		linesHashCache.splice(linesHashCache.begin(), linesHashCache, docHashes);
+	}
+
+	DocLinesHashes& cachedHashes = linesHashCache.front();
+
+	cachedHashes.buffId		= getCurrentBuffId(view);
+	cachedHashes.modified	= modified;
+	cachedHashes.fileTime	= fileTime;
+	cachedHashes.edited		= false;
+
+	if (static_cast<int>(cachedHashes.valid.size()) != linesCount)
+	{
+		for (auto& hashes: cachedHashes.hashes)
+			hashes.assign(linesCount, cHashSeed);
+
+		cachedHashes.valid.assign(linesCount, 0);
+	}
+
+	return cachedHashes;
 }
 
 
 void getLines(DocCmpInfo& doc, const CompareOptions& options)
 {
+	TRACE_SPAN("getLines");
+
 	const int monitorCancelEveryXLine = 500;
 
 	progress_ptr& progress = ProgressDlg::Get();
@@ -264,6 +596,12 @@ void getLines(DocCmpInfo& doc, const CompareOptions& options)
 
 	doc.lines.reserve(doc.section.len);
 
+	DocLinesHashes& cachedHashes = getCachedLinesHashes(doc.view);
+
+	const std::vector<uint64_t>& hashes = cachedHashes.hashes[hashVariant(options)];
+
+	doc.rawHashes = &cachedHashes.hashes[0];
+
 	for (int lineNum = 0; lineNum < doc.section.len; ++lineNum)
 	{
 		if (progress && (lineNum % monitorCancelEveryXLine == 0) && !progress->Advance())
@@ -272,160 +610,637 @@ void getLines(DocCmpInfo& doc, const CompareOptions& options)
 			return;
 		}
 
-		const int lineStart	= getLineStart(doc.view, lineNum + doc.section.off);
-		const int lineEnd	= getLineEnd(doc.view, lineNum + doc.section.off);
-
 		Line newLine;
-		newLine.hash = cHashSeed;
 		newLine.line = lineNum + doc.section.off;
 
-		if (lineEnd - lineStart)
+		// Only lines changed since the last compare are re-hashed
+		if (!cachedHashes.valid[newLine.line])
 		{
-			std::vector<char> line = getText(doc.view, lineStart, lineEnd);
+			const int lineStart	= getLineStart(doc.view, newLine.line);
+			const int lineEnd	= getLineEnd(doc.view, newLine.line);
 
-			if (options.ignoreCase)
-				toLowerCase(line);
+			uint64_t lineHashes[cHashVariants];
 
-			for (int i = 0; i < lineEnd - lineStart; ++i)
+			if (lineEnd - lineStart)
 			{
-				if (options.ignoreSpaces && (line[i] == ' ' || line[i] == '\t'))
-					continue;
+				std::vector<char> line = getText(doc.view, lineStart, lineEnd);
 
-				newLine.hash = Hash(newLine.hash, line[i]);
+				getLineHashes(line, lineEnd - lineStart, lineHashes);
+			}
+			else
+			{
+				for (auto& hash: lineHashes)
+					hash = cHashSeed;
 			}
+
+			for (int i = 0; i < cHashVariants; ++i)
+				cachedHashes.hashes[i][newLine.line] = lineHashes[i];
+
+			cachedHashes.valid[newLine.line] = 1;
+
+			STATS_ADD(LINES_HASHED, 1);
 		}
 
+		newLine.hash = hashes[newLine.line];
+
 		if (!options.ignoreEmptyLines || newLine.hash != cHashSeed)
 			doc.lines.emplace_back(newLine);
 	}
 }
 
 
-charType getCharType(char letter)
+/**
+ *  \class  FileLinesReader
+ *  \brief  Reads file lines through a sliding memory-mapped view so the resident memory stays bounded
+ *          regardless of the file size. Line endings are handled the same way Scintilla does (CRLF, LF, CR).
+ */
+class FileLinesReader
 {
-	if (letter == ' ' || letter == '\t')
-		return charType::SPACECHAR;
-
-	if (::IsCharAlphaNumericA(letter) || letter == '_')
-		return charType::ALPHANUMCHAR;
+public:
+	FileLinesReader() {}
+	~FileLinesReader();
 
-	return charType::OTHERCHAR;
-}
+	bool open(const TCHAR* file);
 
+	// Gets next line text (without EOL) zero terminated, returns false if there are no more lines
+	bool getLine(std::vector<char>& line);
 
-std::vector<Char> getSectionChars(int view, int secStart, int secEnd, const CompareOptions& options)
-{
-	std::vector<Char> chars;
+	inline uint64_t size() const
+	{
+		return _fileSize;
+	}
 
-	if (secEnd - secStart)
+	inline uint64_t pos() const
 	{
-		std::vector<char> line = getText(view, secStart, secEnd);
-		const int lineLen = static_cast<int>(line.size()) - 1;
+		return _viewOff + _viewPos;
+	}
 
-		chars.reserve(lineLen);
+	FileLinesReader(const FileLinesReader&) = delete;
+	const FileLinesReader& operator=(const FileLinesReader&) = delete;
 
-		if (options.ignoreCase)
-			toLowerCase(line);
+private:
+	// Must be a multiple of the system allocation granularity (64KB)
+	static const DWORD cViewSize = 64 * 1024 * 1024;
 
-		for (int i = 0; i < lineLen; ++i)
-		{
-			if (!options.ignoreSpaces || getCharType(line[i]) != charType::SPACECHAR)
-				chars.emplace_back(line[i], i);
-		}
-	}
+	bool mapNextView();
 
-	return chars;
+	HANDLE		_file		{INVALID_HANDLE_VALUE};
+	HANDLE		_mapping	{NULL};
+	const char*	_view		{nullptr};
+
+	uint64_t	_fileSize	{0};
+	uint64_t	_viewOff	{0};
+	DWORD		_viewSize	{0};
+	DWORD		_viewPos	{0};
+
+	bool		_skipLF		{false};
+	bool		_done		{true};
+};
+
+
+FileLinesReader::~FileLinesReader()
+{
+	if (_view)
+		::UnmapViewOfFile(_view);
+
+	if (_mapping)
+		::CloseHandle(_mapping);
+
+	if (_file != INVALID_HANDLE_VALUE)
+		::CloseHandle(_file);
 }
 
 
-std::vector<std::vector<Char>> getChars(const DocCmpInfo& doc, int lineOffset, int linesCount,
-		const CompareOptions& options)
+bool FileLinesReader::open(const TCHAR* file)
 {
-	std::vector<std::vector<Char>> chars(linesCount);
+	_file = ::CreateFile(file, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+			FILE_FLAG_SEQUENTIAL_SCAN, NULL);
 
-	for (int lineNum = 0; lineNum < linesCount; ++lineNum)
-	{
-		const int docLineNum	= doc.lines[lineNum + lineOffset].line;
-		const int docLineStart	= getLineStart(doc.view, docLineNum);
-		const int docLineEnd	= getLineEnd(doc.view, docLineNum);
+	if (_file == INVALID_HANDLE_VALUE)
+		return false;
 
-		if (docLineEnd - docLineStart)
-			chars[lineNum] = getSectionChars(doc.view, docLineStart, docLineEnd, options);
-	}
+	LARGE_INTEGER fileSize;
 
-	return chars;
+	if (!::GetFileSizeEx(_file, &fileSize))
+		return false;
+
+	_fileSize = static_cast<uint64_t>(fileSize.QuadPart);
+
+	// Empty file has no lines at all (the same as empty Scintilla document)
+	if (_fileSize == 0)
+		return true;
+
+	_mapping = ::CreateFileMapping(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+	if (!_mapping)
+		return false;
+
+	_done = false;
+
+	return true;
 }
 
 
-std::vector<Word> getLineWords(int view, int lineNum, const CompareOptions& options)
+bool FileLinesReader::mapNextView()
 {
-	std::vector<Word> words;
+	const uint64_t nextOff = _viewOff + _viewSize;
 
-	const int docLineStart	= getLineStart(view, lineNum);
-	const int docLineEnd	= getLineEnd(view, lineNum);
+	if (nextOff >= _fileSize)
+		return false;
 
-	if (docLineEnd - docLineStart)
-	{
-		std::vector<char> line = getText(view, docLineStart, docLineEnd);
-		const int lineLen = static_cast<int>(line.size()) - 1;
+	if (_view)
+		::UnmapViewOfFile(_view);
 
-		if (options.ignoreCase)
-			toLowerCase(line);
+	_viewOff	= nextOff;
+	_viewSize	= static_cast<DWORD>(std::min<uint64_t>(cViewSize, _fileSize - nextOff));
+	_viewPos	= 0;
+
+	_view = static_cast<const char*>(::MapViewOfFile(_mapping, FILE_MAP_READ,
+			static_cast<DWORD>(nextOff >> 32), static_cast<DWORD>(nextOff & 0xFFFFFFFF), _viewSize));
+
+	if (!_view)
+		throw std::runtime_error("Failed to map file view");
+
+	return true;
+}
+
+
+bool FileLinesReader::getLine(std::vector<char>& line)
+{
+	if (_done)
+		return false;
 
-		charType currentWordType = getCharType(line[0]);
+	line.clear();
 
-		Word word;
-		word.hash = Hash(cHashSeed, line[0]);
-		word.pos = 0;
-		word.len = 1;
+	for (;;)
+	{
+		if (_viewPos == _viewSize && !mapNextView())
+		{
+			// The last line (after the last EOL) is always present
+			_done = true;
+			break;
+		}
 
-		for (int i = 1; i < lineLen; ++i)
+		if (_skipLF)
 		{
-			charType newWordType = getCharType(line[i]);
+			_skipLF = false;
 
-			if (newWordType == currentWordType)
+			if (_view[_viewPos] == '\n')
 			{
-				++word.len;
-				word.hash = Hash(word.hash, line[i]);
+				++_viewPos;
+				continue;
 			}
-			else
-			{
-				if (!options.ignoreSpaces || currentWordType != charType::SPACECHAR)
-					words.emplace_back(word);
+		}
 
-				currentWordType = newWordType;
+		const char* lineStart	= _view + _viewPos;
+		const char* viewEnd		= _view + _viewSize;
+		const char* lineEnd		= lineStart;
 
-				word.hash = Hash(cHashSeed, line[i]);
-				word.pos = i;
-				word.len = 1;
-			}
-		}
+		for (; lineEnd < viewEnd && *lineEnd != '\n' && *lineEnd != '\r'; ++lineEnd);
+
+		line.insert(line.end(), lineStart, lineEnd);
+		_viewPos += static_cast<DWORD>(lineEnd - lineStart);
 
-		if (!options.ignoreSpaces || currentWordType != charType::SPACECHAR)
-			words.emplace_back(word);
+		if (lineEnd < viewEnd)
+		{
+			// CRLF might be split between views - skip the LF on next read
+			_skipLF = (*lineEnd == '\r');
+			++_viewPos;
+			break;
+		}
 	}
 
-	return words;
+	line.push_back(0);
+
+	return true;
 }
 
 
-// Scan for the best single matching block in the other file
-void findBestMatch(const CompareInfo& cmpInfo, const diffInfo& lookupDiff, int lookupOff, MatchInfo& mi)
+// Reads the file lines hashes - onLine(lineNum, hash) is called for each compared line (empty lines are skipped if
+// ignored). Progress can be null - file lines are then read without cancel monitoring (like in folders compare
+// workers).
+template <typename LineHandler>
+bool readFileLines(FileLinesReader& file, int& linesCount, const CompareOptions& options, ProgressDlg* progress,
+		LineHandler&& onLine)
 {
-	mi.matchLen		= 0;
-	mi.matchDiff	= nullptr;
+	TRACE_SPAN("getFileLines");
 
-	const std::vector<Line>* pLookupLines;
-	const std::vector<Line>* pMatchLines;
-	diff_type matchType;
+	const int monitorCancelEveryXLine = 500;
+	const int progressStepBytesShift = 20;
 
-	if (lookupDiff.type == diff_type::DIFF_IN_1)
+	if (progress)
+		progress->SetMaxCount(static_cast<unsigned>(file.size() >> progressStepBytesShift) + 1);
+
+	uint64_t progressPos = 0;
+
+	std::vector<char> line;
+
+	linesCount = 0;
+
+	for (int lineNum = 0; file.getLine(line); linesCount = ++lineNum)
 	{
-		pLookupLines	= &cmpInfo.doc1.lines;
-		pMatchLines		= &cmpInfo.doc2.lines;
-		matchType		= diff_type::DIFF_IN_2;
-	}
-	else
+		if (progress && (lineNum % monitorCancelEveryXLine == 0))
+		{
+			const uint64_t pos = file.pos() >> progressStepBytesShift;
+
+			if (!progress->Advance(static_cast<unsigned>(pos - progressPos)))
+				return false;
+
+			progressPos = pos;
+		}
+
+		const uint64_t hash = getLineHash(line, static_cast<int>(line.size()) - 1, options);
+
+		if (!options.ignoreEmptyLines || hash != cHashSeed)
+			onLine(lineNum, hash);
+	}
+
+	return true;
+}
+
+
+bool getFileLines(FileLinesReader& file, std::vector<Line>& lines, int& linesCount, const CompareOptions& options,
+		ProgressDlg* progress)
+{
+	return readFileLines(file, linesCount, options, progress,
+			[&lines](int lineNum, uint64_t hash)
+			{
+				Line newLine;
+				newLine.line = lineNum;
+				newLine.hash = hash;
+
+				lines.emplace_back(newLine);
+			});
+}
+
+
+/**
+ *  \class  TempFileArray
+ *  \brief  Array of POD elements appended through a small buffer - once the buffer is full the elements are spilled
+ *          to a temporary file that is memory-mapped read-only as a whole when appending is done. The mapped pages
+ *          are backed by the file so the system can drop them at will - the resident memory stays bounded
+ *          regardless of the array size. The file is deleted when closed.
+ */
+template <typename T>
+class TempFileArray
+{
+public:
+	TempFileArray() {}
+	~TempFileArray();
+
+	inline void push_back(const T& elem)
+	{
+		if (_buf.size() == cBufCount)
+			flush();
+
+		_buf.emplace_back(elem);
+		++_count;
+	}
+
+	// Makes the appended elements viewable - no more elements can be appended after that
+	void map();
+
+	inline seq_view<T> view() const
+	{
+		return seq_view<T>(_view, _count);
+	}
+
+	inline size_t size() const
+	{
+		return _count;
+	}
+
+	inline const T& operator[](size_t i) const
+	{
+		return _view[i];
+	}
+
+	TempFileArray(const TempFileArray&) = delete;
+	const TempFileArray& operator=(const TempFileArray&) = delete;
+
+private:
+	static const size_t cBufCount = 1024 * 1024 / sizeof(T);
+
+	void flush();
+
+	HANDLE		_file		{INVALID_HANDLE_VALUE};
+	HANDLE		_mapping	{NULL};
+	const T*	_view		{nullptr};
+
+	size_t			_count	{0};
+	std::vector<T>	_buf;
+};
+
+
+template <typename T>
+TempFileArray<T>::~TempFileArray()
+{
+	if (_mapping)
+	{
+		::UnmapViewOfFile(_view);
+		::CloseHandle(_mapping);
+	}
+
+	if (_file != INVALID_HANDLE_VALUE)
+		::CloseHandle(_file);
+}
+
+
+template <typename T>
+void TempFileArray<T>::flush()
+{
+	if (_file == INVALID_HANDLE_VALUE)
+	{
+		TCHAR dir[MAX_PATH];
+		TCHAR path[MAX_PATH];
+
+		if (!::GetTempPath(_countof(dir), dir) || !::GetTempFileName(dir, TEXT("cmp"), 0, path))
+			throw std::runtime_error("Failed to create temp file");
+
+		_file = ::CreateFile(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+				FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+
+		if (_file == INVALID_HANDLE_VALUE)
+		{
+			::DeleteFile(path);
+			throw std::runtime_error("Failed to create temp file");
+		}
+	}
+
+	const DWORD size = static_cast<DWORD>(_buf.size() * sizeof(T));
+	DWORD written;
+
+	if (!::WriteFile(_file, _buf.data(), size, &written, NULL) || written != size)
+		throw std::runtime_error("Failed to write temp file");
+
+	_buf.clear();
+}
+
+
+template <typename T>
+void TempFileArray<T>::map()
+{
+	// All elements fit the buffer - no file at all
+	if (_file == INVALID_HANDLE_VALUE)
+	{
+		_view = _buf.data();
+		return;
+	}
+
+	if (!_buf.empty())
+		flush();
+
+	std::vector<T>().swap(_buf);
+
+	_mapping = ::CreateFileMapping(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+	if (!_mapping)
+		throw std::runtime_error("Failed to map temp file");
+
+	_view = static_cast<const T*>(::MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+
+	// Not enough address space for the whole array (32-bit process)
+	if (!_view)
+		throw std::bad_alloc();
+}
+
+
+/**
+ *  \struct SpilledFileLines
+ *  \brief  Compared lines of a file on disk kept in temp file arrays - line numbers are kept only if empty lines
+ *          are ignored, otherwise the line number is the line index
+ */
+struct SpilledFileLines
+{
+	TempFileArray<LineHash>	hashes;
+	TempFileArray<int>		lineNums;
+
+	bool	lineNumsKept {false};
+
+	bool read(FileLinesReader& file, int& linesCount, const CompareOptions& options, ProgressDlg* progress);
+};
+
+
+bool SpilledFileLines::read(FileLinesReader& file, int& linesCount, const CompareOptions& options,
+		ProgressDlg* progress)
+{
+	lineNumsKept = options.ignoreEmptyLines;
+
+	auto addLine = [this](int lineNum, uint64_t hash)
+	{
+		LineHash lineHash;
+		lineHash.hash = hash;
+
+		hashes.push_back(lineHash);
+
+		if (lineNumsKept)
+			lineNums.push_back(lineNum);
+	};
+
+	if (!readFileLines(file, linesCount, options, progress, addLine))
+		return false;
+
+	hashes.map();
+	lineNums.map();
+
+	return true;
+}
+
+
+std::vector<Char> getSectionChars(int view, int secStart, int secEnd, const CompareOptions& options)
+{
+	std::vector<Char> chars;
+
+	if (secEnd - secStart)
+	{
+		std::vector<char> line = getText(view, secStart, secEnd);
+		const int lineLen = static_cast<int>(line.size()) - 1;
+
+		chars.reserve(lineLen);
+
+		if (options.ignoreCase)
+			fold_case_utf8(line.data(), lineLen);
+
+		for (int i = 0; i < lineLen; ++i)
+		{
+			if (!options.ignoreSpaces || get_char_type(line[i]) != char_type::SPACE)
+				chars.emplace_back(line[i], i);
+		}
+	}
+
+	return chars;
+}
+
+
+// Per-compare cache of the lines chars keyed by line hash so identical lines are tokenized once. Lines with equal
+// hashes might differ in ignored spaces so only the chars values can be used (not their positions).
+struct LineCharsCache
+{
+	std::unordered_map<uint64_t, std::vector<Char>>	chars;
+	size_t											charsCount {0};
+};
+
+
+std::vector<const std::vector<Char>*> getChars(const DocCmpInfo& doc, int lineOffset, int linesCount,
+		const CompareOptions& options, LineCharsCache& charsCache)
+{
+	std::vector<const std::vector<Char>*> chars(linesCount);
+
+	for (int lineNum = 0; lineNum < linesCount; ++lineNum)
+	{
+		const Line& line = doc.lines[lineNum + lineOffset];
+
+		auto cached = charsCache.chars.find(line.hash);
+
+		if (cached == charsCache.chars.end())
+		{
+			std::vector<Char> lineChars;
+
+			const int docLineStart	= getLineStart(doc.view, line.line);
+			const int docLineEnd	= getLineEnd(doc.view, line.line);
+
+			if (docLineEnd - docLineStart)
+				lineChars = getSectionChars(doc.view, docLineStart, docLineEnd, options);
+
+			charsCache.charsCount += lineChars.size();
+
+			cached = charsCache.chars.emplace(line.hash, std::move(lineChars)).first;
+		}
+
+		chars[lineNum] = &cached->second;
+	}
+
+	return chars;
+}
+
+
+std::vector<Word> getLineWords(int view, int lineNum, const CompareOptions& options)
+{
+	std::vector<Word> words;
+
+	const int docLineStart	= getLineStart(view, lineNum);
+	const int docLineEnd	= getLineEnd(view, lineNum);
+
+	if (docLineEnd - docLineStart)
+	{
+		std::vector<char> line = getText(view, docLineStart, docLineEnd);
+		const int lineLen = static_cast<int>(line.size()) - 1;
+
+		if (options.ignoreCase)
+			fold_case_utf8(line.data(), lineLen);
+
+		segment_words(line.data(), lineLen,
+				[&](int pos, int len, char_type type)
+				{
+					if (options.ignoreSpaces && type == char_type::SPACE)
+						return;
+
+					Word word;
+					word.hash = cHashSeed;
+					word.pos = pos;
+					word.len = len;
+
+					for (int i = pos; i < pos + len; ++i)
+						word.hash = Hash(word.hash, line[i]);
+
+					words.emplace_back(word);
+				});
+	}
+
+	return words;
+}
+
+
+// Words diff of long lines - words are pre-aligned on anchors of unique words chunks and the windows in between are
+// diffed with capped cost so lines of megabytes with few changes are compared in about linear time
+std::vector<diff_info<void>> diffLongLineWords(const std::vector<Word>& words1, const std::vector<Word>& words2)
+{
+	std::vector<diff_info<void>> wordDiffs;
+
+	const std::vector<seq_anchor> anchors = find_anchors(words1, words2);
+
+	LOGD("Long line words pre-aligned on " + std::to_string(anchors.size()) + " anchors\n");
+
+	diff_anchored(words1, words2, anchors, wordDiffs, cLongLineWindowMaxCost);
+
+	return wordDiffs;
+}
+
+
+// Matched chars count of long lines words - used instead of their chars LCS length which is too costly to get
+int getLongLinesMatchLen(const std::vector<Word>& words1, const std::vector<Word>& words2)
+{
+	int matchLen = 0;
+
+	for (const auto& wd: diffLongLineWords(words1, words2))
+	{
+		if (wd.type == diff_type::DIFF_MATCH)
+		{
+			for (int i = wd.off; i < wd.off + wd.len; ++i)
+				matchLen += words1[i].len;
+		}
+	}
+
+	return matchLen;
+}
+
+
+// Huge documents are pre-aligned on equal lines ranges found through content-defined chunks - the equal ranges
+// are matched up front and only the differing windows in between are actually diffed. Debug log is not written
+// if log is false (it is not thread safe). chunksIndex1 is lines1 chunks index if already built. The diff is
+// stopped as soon as isCancelled returns true - its result is then incomplete and should be dropped. The diff of
+// huge documents is exact unless hugeMaxCost is given - each diffed window costlier than that is then marked
+// changed as a whole. Lines are a std::vector or a seq_view of Line or LineHash.
+template <typename Seq>
+std::pair<std::vector<diffInfo>, bool> diffLines(const Seq& lines1, const Seq& lines2, bool log = true,
+		const seq_chunks_index* chunksIndex1 = nullptr, const std::function<bool()>& isCancelled = nullptr,
+		int hugeMaxCost = INT_MAX)
+{
+	TRACE_SPAN("diffLines");
+
+	const bool huge = (std::min(lines1.size(), lines2.size()) >= static_cast<size_t>(cPreAlignMinLines));
+
+	std::vector<seq_anchor> anchors;
+
+	if (huge)
+		anchors = chunksIndex1 ? find_anchors(lines1, *chunksIndex1, lines2) : find_anchors(lines1, lines2);
+
+	if (log && !anchors.empty())
+	{
+		LOGD("Lines pre-aligned on " + std::to_string(anchors.size()) + " anchors\n");
+	}
+
+	return diff_pre_aligned<blockDiffInfo>(lines1, lines2, anchors, huge ? hugeMaxCost : INT_MAX, isCancelled);
+}
+
+
+// Diffs cancel check through the progress dialog (it can be checked from any thread) - none if there is no dialog
+inline std::function<bool()> progressCancelCheck(const ProgressDlg* progress)
+{
+	if (!progress)
+		return nullptr;
+
+	return [progress]() { return progress->IsCancelled(); };
+}
+
+
+// Scan for the best single matching block in the other file
+void findBestMatch(const CompareInfo& cmpInfo, const diffInfo& lookupDiff, int lookupOff, MatchInfo& mi)
+{
+	mi.matchLen		= 0;
+	mi.matchDiff	= nullptr;
+
+	const std::vector<Line>* pLookupLines;
+	const std::vector<Line>* pMatchLines;
+	diff_type matchType;
+
+	if (lookupDiff.type == diff_type::DIFF_IN_1)
+	{
+		pLookupLines	= &cmpInfo.doc1.lines;
+		pMatchLines		= &cmpInfo.doc2.lines;
+		matchType		= diff_type::DIFF_IN_2;
+	}
+	else
 	{
 		pLookupLines	= &cmpInfo.doc2.lines;
 		pMatchLines		= &cmpInfo.doc1.lines;
@@ -525,6 +1340,8 @@ bool resolveMatch(const CompareInfo& cmpInfo, diffInfo& lookupDiff, int lookupOf
 
 void findMoves(CompareInfo& cmpInfo)
 {
+	TRACE_SPAN("findMoves");
+
 	// LOGD("FIND MOVES\n");
 
 	bool repeat = true;
@@ -574,6 +1391,8 @@ void findMoves(CompareInfo& cmpInfo)
 
 void findUniqueLines(CompareInfo& cmpInfo)
 {
+	TRACE_SPAN("findUniqueLines");
+
 	std::unordered_map<uint64_t, std::vector<int>> doc1LinesMap;
 
 	for (const auto& line: cmpInfo.doc1.lines)
@@ -602,6 +1421,62 @@ void findUniqueLines(CompareInfo& cmpInfo)
 }
 
 
+struct HashPair
+{
+	HashPair(uint64_t h1, uint64_t h2, uint32_t o = 0) : hash1(h1), hash2(h2), opts(o) {}
+
+	bool operator==(const HashPair& rhs) const
+	{
+		return (hash1 == rhs.hash1 && hash2 == rhs.hash2 && opts == rhs.opts);
+	}
+
+	uint64_t	hash1;
+	uint64_t	hash2;
+	uint32_t	opts;
+};
+
+
+struct HashPairHash
+{
+	size_t operator()(const HashPair& key) const
+	{
+		return static_cast<size_t>((key.hash1 ^ (key.hash2 * 0x9E3779B185EBCA87ULL)) + key.opts);
+	}
+};
+
+
+// Result of a lines pair compare in compareLines() - changes are empty and matched is false if the lines turned
+// out to be too different to be considered changed
+struct LinesPairDiff
+{
+	bool					matched {false};
+	std::vector<section_t>	changes1;
+	std::vector<section_t>	changes2;
+};
+
+
+// LCS lengths of lines pairs chars keyed by the lines hashes and their hash variant (the chars depend on the same
+// options as the hashes)
+lru_cache<HashPair, int, HashPairHash> linesSimilarityCache(cLinesSimilarityCacheSize);
+
+// Lines pairs compare results keyed by the lines raw hashes (changes positions depend on the raw text) and options
+lru_cache<HashPair, LinesPairDiff, HashPairHash> linesPairDiffCache(cLinesPairDiffCacheSize);
+
+
+// Length in chars of the words section referenced by a words diff
+inline int getWordsSectionLen(const std::vector<Word>& words, const diff_info<void>& wd)
+{
+	return words[wd.off + wd.len - 1].pos + words[wd.off + wd.len - 1].len - words[wd.off].pos;
+}
+
+
+inline uint32_t linesPairDiffOptions(const CompareOptions& options)
+{
+	return static_cast<uint32_t>(hashVariant(options) | (options.charPrecision ? 4 : 0) |
+			(options.matchPercentThreshold << 3));
+}
+
+
 void compareLines(const DocCmpInfo& doc1, const DocCmpInfo& doc2, diffInfo& blockDiff1, diffInfo& blockDiff2,
 		const std::map<int, std::pair<float, int>>& lineMappings, const CompareOptions& options)
 {
@@ -621,20 +1496,75 @@ void compareLines(const DocCmpInfo& doc1, const DocCmpInfo& doc2, diffInfo& bloc
 
 		lastLine2 = line2;
 
-		const std::vector<Word> lineWords1 = getLineWords(doc1.view, doc1.lines[blockDiff1.off + line1].line, options);
-		const std::vector<Word> lineWords2 = getLineWords(doc2.view, doc2.lines[blockDiff2.off + line2].line, options);
+		const int docLine1 = doc1.lines[blockDiff1.off + line1].line;
+		const int docLine2 = doc2.lines[blockDiff2.off + line2].line;
 
-		const auto* pLine1 = &lineWords1;
-		const auto* pLine2 = &lineWords2;
+		const bool usePairCache = (doc1.rawHashes && doc2.rawHashes);
 
-		const DocCmpInfo* pDoc1 = &doc1;
-		const DocCmpInfo* pDoc2 = &doc2;
+		const HashPair pairKey = usePairCache ?
+				HashPair((*doc1.rawHashes)[docLine1], (*doc2.rawHashes)[docLine2], linesPairDiffOptions(options)) :
+				HashPair(0, 0);
 
-		diffInfo* pBlockDiff1 = &blockDiff1;
-		diffInfo* pBlockDiff2 = &blockDiff2;
+		if (usePairCache)
+		{
+			const LinesPairDiff* cached = linesPairDiffCache.find(pairKey);
+
+			if (cached)
+			{
+				if (cached->matched)
+				{
+					blockDiff1.info.changedLines.emplace_back(line1);
+					blockDiff1.info.changedLines.back().changes = cached->changes1;
+
+					blockDiff2.info.changedLines.emplace_back(line2);
+					blockDiff2.info.changedLines.back().changes = cached->changes2;
+				}
+
+				continue;
+			}
+		}
+
+		const size_t changedLinesCount = blockDiff1.info.changedLines.size();
+
+		const std::vector<Word> lineWords1 = getLineWords(doc1.view, docLine1, options);
+		const std::vector<Word> lineWords2 = getLineWords(doc2.view, docLine2, options);
+
+		const auto* pLine1 = &lineWords1;
+		const auto* pLine2 = &lineWords2;
+
+		const DocCmpInfo* pDoc1 = &doc1;
+		const DocCmpInfo* pDoc2 = &doc2;
+
+		diffInfo* pBlockDiff1 = &blockDiff1;
+		diffInfo* pBlockDiff2 = &blockDiff2;
+
+		int lineLen1 = 0;
+		int lineLen2 = 0;
+
+		for (const auto& word: lineWords1)
+			lineLen1 += word.len;
+
+		for (const auto& word: lineWords2)
+			lineLen2 += word.len;
+
+		const bool longLines = (std::max(lineLen1, lineLen2) >= cLongLineMinChars);
 
 		// First use word granularity (find matching words) for better precision
-		auto wordDiffRes = DiffCalc<Word>(lineWords1, lineWords2)();
+		std::pair<std::vector<diff_info<void>>, bool> wordDiffRes;
+
+		if (longLines)
+		{
+			wordDiffRes = std::make_pair(diffLongLineWords(lineWords1, lineWords2), false);
+		}
+		else
+		{
+			DiffCalc<Word> diffCalc(lineWords1, lineWords2);
+
+			wordDiffRes = diffCalc();
+
+			STATS_ADD(DIAGONALS_EXPLORED, diffCalc.diagonals());
+		}
+
 		const std::vector<diff_info<void>> lineDiffs = std::move(wordDiffRes.first);
 
 		if (wordDiffRes.second)
@@ -643,6 +1573,7 @@ void compareLines(const DocCmpInfo& doc1, const DocCmpInfo& doc2, diffInfo& bloc
 			std::swap(pBlockDiff1, pBlockDiff2);
 			std::swap(pLine1, pLine2);
 			std::swap(line1, line2);
+			std::swap(lineLen1, lineLen2);
 		}
 
 		const int lineDiffsSize = static_cast<int>(lineDiffs.size());
@@ -655,15 +1586,6 @@ void compareLines(const DocCmpInfo& doc1, const DocCmpInfo& doc2, diffInfo& bloc
 		const int lineOff1 = getLineStart(pDoc1->view, pDoc1->lines[line1 + pBlockDiff1->off].line);
 		const int lineOff2 = getLineStart(pDoc2->view, pDoc2->lines[line2 + pBlockDiff2->off].line);
 
-		int lineLen1 = 0;
-		int lineLen2 = 0;
-
-		for (const auto& word: *pLine1)
-			lineLen1 += word.len;
-
-		for (const auto& word: *pLine2)
-			lineLen2 += word.len;
-
 		int totalLineMatchLen = 0;
 
 		for (int i = 0; i < lineDiffsSize; ++i)
@@ -686,9 +1608,12 @@ void compareLines(const DocCmpInfo& doc1, const DocCmpInfo& doc2, diffInfo& bloc
 			}
 			else
 			{
-				// Resolve words mismatched DIFF_IN_1 / DIFF_IN_2 pairs to find possible sub-word similarities
+				// Resolve words mismatched DIFF_IN_1 / DIFF_IN_2 pairs to find possible sub-word similarities.
+				// Long lines changed sections can be whole capped-cost windows - only the small ones are resolved.
 				if (options.charPrecision &&
-					(i + 1 < lineDiffsSize) && (lineDiffs[i + 1].type == diff_type::DIFF_IN_2))
+					(i + 1 < lineDiffsSize) && (lineDiffs[i + 1].type == diff_type::DIFF_IN_2) &&
+					(!longLines || (getWordsSectionLen(*pLine1, ld) <= cLongLineMaxSectionChars &&
+						getWordsSectionLen(*pLine2, lineDiffs[i + 1]) <= cLongLineMaxSectionChars)))
 				{
 					const auto& ld2 = lineDiffs[i + 1];
 
@@ -715,16 +1640,27 @@ void compareLines(const DocCmpInfo& doc1, const DocCmpInfo& doc2, diffInfo& bloc
 					diffInfo* pBD1 = pBlockDiff1;
 					diffInfo* pBD2 = pBlockDiff2;
 
-					// Compare changed words
-					auto diffRes = DiffCalc<Char>(sec1, sec2)();
-					const std::vector<diff_info<void>> sectionDiffs = std::move(diffRes.first);
+					std::vector<diff_info<void>> sectionDiffs;
+
+					STATS_ADD(CHAR_DIFF_PAIRS, 1);
 
-					if (diffRes.second)
+					// Compare changed words - calculate edit script only if there are any common chars at all
+					if (LcsCalc<Char>(sec1)(sec2))
 					{
-						std::swap(pSec1, pSec2);
-						std::swap(pBD1, pBD2);
-						std::swap(off1, off2);
-						std::swap(end1, end2);
+						DiffCalc<Char> diffCalc(sec1, sec2);
+
+						auto diffRes = diffCalc();
+						sectionDiffs = std::move(diffRes.first);
+
+						STATS_ADD(DIAGONALS_EXPLORED, diffCalc.diagonals());
+
+						if (diffRes.second)
+						{
+							std::swap(pSec1, pSec2);
+							std::swap(pBD1, pBD2);
+							std::swap(off1, off2);
+							std::swap(end1, end2);
+						}
 					}
 
 					PRINT_DIFFS("CHAR DIFFS", sectionDiffs);
@@ -845,15 +1781,39 @@ void compareLines(const DocCmpInfo& doc1, const DocCmpInfo& doc2, diffInfo& bloc
 			pBlockDiff1->info.changedLines.pop_back();
 			pBlockDiff2->info.changedLines.pop_back();
 		}
+
+		if (usePairCache)
+		{
+			LinesPairDiff pairDiff;
+
+			if (blockDiff1.info.changedLines.size() > changedLinesCount)
+			{
+				pairDiff.matched	= true;
+				pairDiff.changes1	= blockDiff1.info.changedLines.back().changes;
+				pairDiff.changes2	= blockDiff2.info.changedLines.back().changes;
+			}
+
+			linesPairDiffCache.put(pairKey, std::move(pairDiff));
+		}
 	}
 }
 
 
 void compareBlocks(const DocCmpInfo& doc1, const DocCmpInfo& doc2, diffInfo& blockDiff1, diffInfo& blockDiff2,
-		const CompareOptions& options)
+		const CompareOptions& options, LineCharsCache& charsCache)
 {
-	const std::vector<std::vector<Char>> chunk1 = getChars(doc1, blockDiff1.off, blockDiff1.len, options);
-	const std::vector<std::vector<Char>> chunk2 = getChars(doc2, blockDiff2.off, blockDiff2.len, options);
+	TRACE_SPAN_ARG("compareBlocks", blockDiff1.off);
+
+	if (charsCache.charsCount > cLineCharsCacheMaxChars)
+	{
+		charsCache.chars.clear();
+		charsCache.charsCount = 0;
+	}
+
+	const std::vector<const std::vector<Char>*> chunk1 =
+			getChars(doc1, blockDiff1.off, blockDiff1.len, options, charsCache);
+	const std::vector<const std::vector<Char>*> chunk2 =
+			getChars(doc2, blockDiff2.off, blockDiff2.len, options, charsCache);
 
 	const int linesCount1 = static_cast<int>(chunk1.size());
 	const int linesCount2 = static_cast<int>(chunk2.size());
@@ -877,9 +1837,14 @@ void compareBlocks(const DocCmpInfo& doc1, const DocCmpInfo& doc2, diffInfo& blo
 
 	std::set<conv_key> orderedLinesConvergence;
 
+	const uint32_t similarityOpts = static_cast<uint32_t>(hashVariant(options));
+
+	// Block lines2 words of those compared as long lines - each one is tokenized on first use
+	std::vector<std::vector<Word>> longLinesWords2(linesCount2);
+
 	for (int line1 = 0; line1 < linesCount1; ++line1)
 	{
-		if (chunk1[line1].empty())
+		if (chunk1[line1]->empty())
 			continue;
 
 		if (blockDiff1.info.getNextUnmoved(line1))
@@ -888,9 +1853,18 @@ void compareBlocks(const DocCmpInfo& doc1, const DocCmpInfo& doc2, diffInfo& blo
 			continue;
 		}
 
+		const uint64_t hash1 = doc1.lines[blockDiff1.off + line1].hash;
+
+		// Only the matched chars count is needed here - the edit script is calculated later for the chosen pairs.
+		// Created on first similarity cache miss.
+		std::unique_ptr<LcsCalc<Char>> lcs;
+
+		// Line1 words if it is compared as a long line - tokenized on first use
+		std::vector<Word> longLineWords1;
+
 		for (int line2 = 0; line2 < linesCount2; ++line2)
 		{
-			if (chunk2[line2].empty())
+			if (chunk2[line2]->empty())
 				continue;
 
 			if (blockDiff2.info.getNextUnmoved(line2))
@@ -899,30 +1873,48 @@ void compareBlocks(const DocCmpInfo& doc1, const DocCmpInfo& doc2, diffInfo& blo
 				continue;
 			}
 
-			const auto* pLine1 = &chunk1[line1];
-			const auto* pLine2 = &chunk2[line2];
-
-			const int minSize = std::min(pLine1->size(), pLine2->size());
-			const int maxSize = std::max(pLine1->size(), pLine2->size());
+			const int minSize = std::min(chunk1[line1]->size(), chunk2[line2]->size());
+			const int maxSize = std::max(chunk1[line1]->size(), chunk2[line2]->size());
 
 			if ((int)((minSize * 100) / maxSize) < options.matchPercentThreshold)
 				continue;
 
-			auto diffRes = DiffCalc<Char>(*pLine1, *pLine2)();
-			const std::vector<diff_info<void>> lineDiffs = std::move(diffRes.first);
+			const HashPair similarityKey(hash1, doc2.lines[blockDiff2.off + line2].hash, similarityOpts);
 
-			if (diffRes.second)
-				std::swap(pLine1, pLine2);
+			const int* cachedLcsLen = linesSimilarityCache.find(similarityKey);
+			int lcsLen;
 
-			float lineConvergence = 0;
-
-			for (const auto& ld: lineDiffs)
+			if (cachedLcsLen)
+			{
+				lcsLen = *cachedLcsLen;
+			}
+			else
 			{
-				if (ld.type == diff_type::DIFF_MATCH)
-					lineConvergence += ld.len;
+				if (maxSize >= cLongLineMinChars)
+				{
+					if (longLineWords1.empty())
+						longLineWords1 = getLineWords(doc1.view, doc1.lines[blockDiff1.off + line1].line, options);
+
+					if (longLinesWords2[line2].empty())
+						longLinesWords2[line2] =
+								getLineWords(doc2.view, doc2.lines[blockDiff2.off + line2].line, options);
+
+					lcsLen = getLongLinesMatchLen(longLineWords1, longLinesWords2[line2]);
+				}
+				else
+				{
+					if (!lcs)
+						lcs.reset(new LcsCalc<Char>(*chunk1[line1]));
+
+					lcsLen = (*lcs)(*chunk2[line2]);
+				}
+
+				linesSimilarityCache.put(similarityKey, lcsLen);
+
+				STATS_ADD(CHAR_DIFF_PAIRS, 1);
 			}
 
-			lineConvergence = lineConvergence * 100 / maxSize;
+			const float lineConvergence = static_cast<float>(lcsLen) * 100 / maxSize;
 
 			if (lineConvergence >= options.matchPercentThreshold)
 				orderedLinesConvergence.emplace(conv_key(lineConvergence, line1, line2));
@@ -1005,6 +1997,8 @@ void markSection(const DocCmpInfo& doc, const diffInfo& bd)
 
 			const int endDocLine = doc.lines[line].line + 1;
 
+			addMapRun(doc, docLine, endDocLine - docLine, doc.blockDiffMask);
+
 			for (; docLine < endDocLine; ++docLine)
 			{
 				const int mark = (doc.nonUniqueLines.find(docLine) == doc.nonUniqueLines.end()) ? doc.blockDiffMask :
@@ -1015,6 +2009,8 @@ void markSection(const DocCmpInfo& doc, const diffInfo& bd)
 		}
 		else if (movedLen == 1)
 		{
+			addMapRun(doc, docLine, 1, MARKER_MASK_MOVED_LINE);
+
 			CallScintilla(doc.view, SCI_MARKERADDSET, docLine, MARKER_MASK_MOVED_LINE);
 		}
 		else
@@ -1024,6 +2020,8 @@ void markSection(const DocCmpInfo& doc, const diffInfo& bd)
 
 			const int endDocLine = doc.lines[line].line;
 
+			addMapRun(doc, docLine, endDocLine - docLine + 1, MARKER_MASK_MOVED_BEGIN);
+
 			CallScintilla(doc.view, SCI_MARKERADDSET, docLine, MARKER_MASK_MOVED_BEGIN);
 
 			for (++docLine; docLine < endDocLine; ++docLine)
@@ -1043,6 +2041,8 @@ void markLineDiffs(const CompareInfo& cmpInfo, const diffInfo& bd, int lineIdx)
 	for (const auto& change: bd.info.changedLines[lineIdx].changes)
 		markTextAsChanged(cmpInfo.doc1.view, linePos + change.off, change.len);
 
+	addMapRun(cmpInfo.doc1, line, 1, MARKER_MASK_CHANGED);
+
 	CallScintilla(cmpInfo.doc1.view, SCI_MARKERADDSET, line,
 			cmpInfo.doc1.nonUniqueLines.find(line) == cmpInfo.doc1.nonUniqueLines.end() ?
 			MARKER_MASK_CHANGED : MARKER_MASK_CHANGED_LOCAL);
@@ -1053,6 +2053,8 @@ void markLineDiffs(const CompareInfo& cmpInfo, const diffInfo& bd, int lineIdx)
 	for (const auto& change: bd.info.matchBlock->info.changedLines[lineIdx].changes)
 		markTextAsChanged(cmpInfo.doc2.view, linePos + change.off, change.len);
 
+	addMapRun(cmpInfo.doc2, line, 1, MARKER_MASK_CHANGED);
+
 	CallScintilla(cmpInfo.doc2.view, SCI_MARKERADDSET, line,
 			cmpInfo.doc2.nonUniqueLines.find(line) == cmpInfo.doc2.nonUniqueLines.end() ?
 			MARKER_MASK_CHANGED : MARKER_MASK_CHANGED_LOCAL);
@@ -1061,6 +2063,8 @@ void markLineDiffs(const CompareInfo& cmpInfo, const diffInfo& bd, int lineIdx)
 
 bool markAllDiffs(CompareInfo& cmpInfo, AlignmentInfo_t& alignmentInfo)
 {
+	TRACE_SPAN("markAllDiffs");
+
 	progress_ptr& progress = ProgressDlg::Get();
 
 	alignmentInfo.clear();
@@ -1236,221 +2240,1331 @@ bool markAllDiffs(CompareInfo& cmpInfo, AlignmentInfo_t& alignmentInfo)
 }
 
 
-CompareResult runCompare(const CompareOptions& options, AlignmentInfo_t& alignmentInfo)
+inline bool isMatch(const std::vector<diffInfo>& blockDiffs)
 {
-	progress_ptr& progress = ProgressDlg::Get();
+	return (blockDiffs.empty() || (blockDiffs.size() == 1 && blockDiffs[0].type == diff_type::DIFF_MATCH));
+}
 
-	CompareInfo cmpInfo;
 
-	cmpInfo.doc1.view	= MAIN_VIEW;
-	cmpInfo.doc2.view	= SUB_VIEW;
+// Results cache key - hash of the compared documents raw content (compareBlocks() works on the raw text, the line
+// hashes alone are not enough) and of the options affecting the result (old file view only selects the markers)
+CacheKey getCompareCacheKey(const CompareOptions& options)
+{
+	TRACE_SPAN("getCompareCacheKey");
 
-	cmpInfo.selectionCompare	= options.selectionCompare;
+	CacheWriter opts;
+
+	opts.put(cCacheFormatVersion);
+	opts.put(options.charPrecision);
+	opts.put(options.ignoreSpaces);
+	opts.put(options.ignoreEmptyLines);
+	opts.put(options.ignoreCase);
+	opts.put(options.detectMoves);
+	opts.put(options.matchPercentThreshold);
+	opts.put(options.selectionCompare);
 
 	if (options.selectionCompare)
 	{
-		cmpInfo.doc1.section.off	= options.selections[MAIN_VIEW].first;
-		cmpInfo.doc1.section.len	= options.selections[MAIN_VIEW].second - options.selections[MAIN_VIEW].first + 1;
-
-		cmpInfo.doc2.section.off	= options.selections[SUB_VIEW].first;
-		cmpInfo.doc2.section.len	= options.selections[SUB_VIEW].second - options.selections[SUB_VIEW].first + 1;
+		opts.put(options.selections[MAIN_VIEW]);
+		opts.put(options.selections[SUB_VIEW]);
 	}
 
-	cmpInfo.doc1.blockDiffMask = (options.oldFileViewId == MAIN_VIEW) ? MARKER_MASK_REMOVED : MARKER_MASK_ADDED;
-	cmpInfo.doc2.blockDiffMask = (options.oldFileViewId == MAIN_VIEW) ? MARKER_MASK_ADDED : MARKER_MASK_REMOVED;
+	CacheKey key;
 
-	getLines(cmpInfo.doc1, options);
+	// Both key halves hash all the contents but with different seeds - a collision of one says nothing of the other
+	key.h1 = hashBlock(opts.buffer().data(), opts.buffer().size(), cHashSeed);
+	key.h2 = hashBlock(opts.buffer().data(), opts.buffer().size(), cCacheKeySeed2);
 
-	if (progress && !progress->NextPhase())
-		return CompareResult::COMPARE_CANCELLED;
+	for (int view = MAIN_VIEW; view <= SUB_VIEW; ++view)
+	{
+		const size_t len = static_cast<size_t>(CallScintilla(view, SCI_GETLENGTH, 0, 0));
+		const char* text = reinterpret_cast<const char*>(CallScintilla(view, SCI_GETCHARACTERPOINTER, 0, 0));
 
-	getLines(cmpInfo.doc2, options);
+		// Length first keeps the views contents apart
+		key.h1 = hashBlock(&len, sizeof(len), key.h1);
+		key.h2 = hashBlock(&len, sizeof(len), key.h2);
 
-	if (progress && !progress->NextPhase())
-		return CompareResult::COMPARE_CANCELLED;
+		if (len && text)
+		{
+			key.h1 = hashBlock(text, len, key.h1);
+			key.h2 = hashBlock(text, len, key.h2);
+		}
+	}
 
-	auto diffRes = DiffCalc<Line, blockDiffInfo>(cmpInfo.doc1.lines, cmpInfo.doc2.lines)();
-	cmpInfo.blockDiffs = std::move(diffRes.first);
+	return key;
+}
 
-	if (diffRes.second)
-		swap(cmpInfo.doc1, cmpInfo.doc2);
 
-	PRINT_DIFFS("LINE DIFFS", cmpInfo.blockDiffs);
+void writeDocResult(CacheWriter& writer, const DocCmpInfo& doc)
+{
+	// Lines are stored as runs of consecutive line numbers - a single run unless empty lines are ignored
+	std::vector<section_t> runs;
 
-	const int blockDiffsSize = static_cast<int>(cmpInfo.blockDiffs.size());
+	for (const auto& line: doc.lines)
+	{
+		if (!runs.empty() && runs.back().off + runs.back().len == line.line)
+			++runs.back().len;
+		else
+			runs.emplace_back(line.line, 1);
+	}
 
-	if (blockDiffsSize == 0 || (blockDiffsSize == 1 && cmpInfo.blockDiffs[0].type == diff_type::DIFF_MATCH))
-		return CompareResult::COMPARE_MATCH;
+	writer.put(static_cast<uint32_t>(runs.size()));
 
-	findUniqueLines(cmpInfo);
+	for (const auto& run: runs)
+		writer.put(run);
 
-	if (options.detectMoves)
-		findMoves(cmpInfo);
+	writer.put(static_cast<uint32_t>(doc.nonUniqueLines.size()));
 
-	if (progress && !progress->NextPhase())
-		return CompareResult::COMPARE_CANCELLED;
+	for (int line: doc.nonUniqueLines)
+		writer.put(line);
+}
 
-	if (progress)
-		progress->SetMaxCount(blockDiffsSize - 1);
 
-	// Do block compares
-	for (int i = 1; i < blockDiffsSize; ++i)
+bool readDocResult(CacheReader& reader, DocCmpInfo& doc)
+{
+	const int linesCount = CallScintilla(doc.view, SCI_GETLINECOUNT, 0, 0);
+
+	uint32_t count;
+
+	if (!reader.get(count) || !reader.has(count, sizeof(section_t)))
+		return false;
+
+	for (uint32_t i = 0; i < count; ++i)
 	{
-		// Check if the DIFF_IN_1 / DIFF_IN_2 pair includes changed lines or it's a completely replaced block
-		if ((cmpInfo.blockDiffs[i].type == diff_type::DIFF_IN_2) &&
-			(cmpInfo.blockDiffs[i - 1].type == diff_type::DIFF_IN_1))
-		{
-			diffInfo& blockDiff1 = cmpInfo.blockDiffs[i - 1];
-			diffInfo& blockDiff2 = cmpInfo.blockDiffs[i];
+		section_t run;
+		reader.get(run);
 
-			blockDiff1.info.matchBlock = &blockDiff2;
-			blockDiff2.info.matchBlock = &blockDiff1;
+		if (run.off < 0 || run.len <= 0 || run.off + run.len > linesCount)
+			return false;
 
-			compareBlocks(cmpInfo.doc1, cmpInfo.doc2, blockDiff1, blockDiff2, options);
-		}
+		Line newLine;
+		newLine.hash = cHashSeed;
 
-		if (progress && !progress->Advance())
-			return CompareResult::COMPARE_CANCELLED;
+		for (newLine.line = run.off; newLine.line < run.off + run.len; ++newLine.line)
+			doc.lines.emplace_back(newLine);
 	}
 
-	if (progress && !progress->NextPhase())
-		return CompareResult::COMPARE_CANCELLED;
+	if (!reader.get(count) || !reader.has(count, sizeof(int)))
+		return false;
 
-	if (!markAllDiffs(cmpInfo, alignmentInfo))
-		return CompareResult::COMPARE_CANCELLED;
+	doc.nonUniqueLines.reserve(count);
 
-	return CompareResult::COMPARE_MISMATCH;
-}
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		int line;
+		reader.get(line);
 
+		doc.nonUniqueLines.emplace(line);
+	}
 
-CompareResult runFindUnique(const CompareOptions& options, AlignmentInfo_t& alignmentInfo)
-{
-	progress_ptr& progress = ProgressDlg::Get();
+	return true;
+}
 
-	alignmentInfo.clear();
 
-	DocCmpInfo doc1;
-	DocCmpInfo doc2;
+template <typename T>
+void writeSections(CacheWriter& writer, const std::vector<T>& sections)
+{
+	writer.put(static_cast<uint32_t>(sections.size()));
 
-	doc1.view	= MAIN_VIEW;
-	doc2.view	= SUB_VIEW;
+	for (const auto& sec: sections)
+		writer.put(sec);
+}
 
-	if (options.selectionCompare)
-	{
-		doc1.section.off	= options.selections[MAIN_VIEW].first;
-		doc1.section.len	= options.selections[MAIN_VIEW].second - options.selections[MAIN_VIEW].first + 1;
 
-		doc2.section.off	= options.selections[SUB_VIEW].first;
-		doc2.section.len	= options.selections[SUB_VIEW].second - options.selections[SUB_VIEW].first + 1;
-	}
+template <typename T>
+bool readSections(CacheReader& reader, std::vector<T>& sections)
+{
+	uint32_t count;
 
-	if (options.oldFileViewId == MAIN_VIEW)
-	{
-		doc1.blockDiffMask = MARKER_MASK_REMOVED;
-		doc2.blockDiffMask = MARKER_MASK_ADDED;
-	}
-	else
-	{
-		doc1.blockDiffMask = MARKER_MASK_ADDED;
-		doc2.blockDiffMask = MARKER_MASK_REMOVED;
-	}
+	if (!reader.get(count) || !reader.has(count, sizeof(T)))
+		return false;
 
-	getLines(doc1, options);
+	sections.resize(count);
 
-	if (progress && !progress->NextPhase())
-		return CompareResult::COMPARE_CANCELLED;
+	for (auto& sec: sections)
+		reader.get(sec);
 
-	getLines(doc2, options);
+	return true;
+}
 
-	if (progress && !progress->NextPhase())
-		return CompareResult::COMPARE_CANCELLED;
 
-	std::unordered_map<uint64_t, std::vector<int>> doc1UniqueLines;
+void storeCompareResult(const CacheKey& key, const CompareInfo& cmpInfo)
+{
+	TRACE_SPAN("storeCompareResult");
 
-	for (const auto& line: doc1.lines)
-	{
-		auto insertPair = doc1UniqueLines.emplace(line.hash, std::vector<int>{line.line});
-		if (!insertPair.second)
-			insertPair.first->second.emplace_back(line.line);
-	}
+	CacheWriter writer;
 
-	doc1.lines.clear();
+	writer.put(static_cast<uint8_t>(cmpInfo.doc1.view));
 
-	if (progress && !progress->NextPhase())
-		return CompareResult::COMPARE_CANCELLED;
+	writeDocResult(writer, cmpInfo.doc1);
+	writeDocResult(writer, cmpInfo.doc2);
 
-	std::unordered_map<uint64_t, std::vector<int>> doc2UniqueLines;
+	writer.put(static_cast<uint32_t>(cmpInfo.blockDiffs.size()));
 
-	for (const auto& line: doc2.lines)
+	for (const auto& bd: cmpInfo.blockDiffs)
 	{
-		auto insertPair = doc2UniqueLines.emplace(line.hash, std::vector<int>{line.line});
-		if (!insertPair.second)
-			insertPair.first->second.emplace_back(line.line);
-	}
-
-	doc2.lines.clear();
+		writer.put(static_cast<uint8_t>(bd.type));
+		writer.put(bd.off);
+		writer.put(bd.len);
 
-	if (progress && !progress->NextPhase())
-		return CompareResult::COMPARE_CANCELLED;
-
-	int doc1UniqueLinesCount = 0;
+		writeSections(writer, bd.info.moves);
 
-	for (const auto& uniqueLine: doc1UniqueLines)
-	{
-		auto doc2it = doc2UniqueLines.find(uniqueLine.first);
+		writer.put(static_cast<uint32_t>(bd.info.changedLines.size()));
 
-		if (doc2it != doc2UniqueLines.end())
-		{
-			doc2UniqueLines.erase(doc2it);
-		}
-		else
+		for (const auto& changedLine: bd.info.changedLines)
 		{
-			for (const auto& line: uniqueLine.second)
-			{
-				CallScintilla(doc1.view, SCI_MARKERADDSET, line, doc1.blockDiffMask);
-				++doc1UniqueLinesCount;
-			}
+			writer.put(changedLine.line);
+			writeSections(writer, changedLine.changes);
 		}
 	}
 
-	if (doc1UniqueLinesCount == 0 && doc2UniqueLines.empty())
-		return CompareResult::COMPARE_MATCH;
+	// Failing to cache is not an error - the result is simply computed again next time
+	storeCacheEntry(key, writer.buffer());
+}
 
-	for (const auto& uniqueLine: doc2UniqueLines)
-	{
-		for (const auto& line: uniqueLine.second)
-		{
-			CallScintilla(doc2.view, SCI_MARKERADDSET, line, doc2.blockDiffMask);
-		}
-	}
 
-	AlignmentPair align;
-	align.main.line	= doc1.section.off;
-	align.sub.line	= doc2.section.off;
+bool readCompareResult(CacheReader& reader, CompareInfo& cmpInfo)
+{
+	uint8_t doc1View;
 
-	alignmentInfo.push_back(align);
+	if (!reader.get(doc1View) || (doc1View != MAIN_VIEW && doc1View != SUB_VIEW))
+		return false;
 
-	return CompareResult::COMPARE_MISMATCH;
-}
+	if (doc1View != cmpInfo.doc1.view)
+		swap(cmpInfo.doc1, cmpInfo.doc2);
 
-}
+	if (!readDocResult(reader, cmpInfo.doc1) || !readDocResult(reader, cmpInfo.doc2))
+		return false;
 
+	uint32_t count;
 
-CompareResult compareViews(const CompareOptions& options, const TCHAR* progressInfo, AlignmentInfo_t& alignmentInfo)
-{
-	CompareResult result = CompareResult::COMPARE_ERROR;
+	if (!reader.get(count) || !reader.has(count, sizeof(uint8_t) + 2 * sizeof(int)))
+		return false;
 
-	if (progressInfo)
-		ProgressDlg::Open(progressInfo);
+	cmpInfo.blockDiffs.resize(count);
 
-	try
+	for (auto& bd: cmpInfo.blockDiffs)
 	{
-		if (options.findUniqueMode)
-			result = runFindUnique(options, alignmentInfo);
+		uint8_t type;
+
+		if (!reader.get(type) || type > static_cast<uint8_t>(diff_type::DIFF_IN_2))
+			return false;
+
+		bd.type = static_cast<diff_type>(type);
+
+		reader.get(bd.off);
+		reader.get(bd.len);
+
+		const DocCmpInfo& doc = (bd.type == diff_type::DIFF_IN_2) ? cmpInfo.doc2 : cmpInfo.doc1;
+
+		if (bd.off < 0 || bd.len < 0 || bd.off + bd.len > static_cast<int>(doc.lines.size()))
+			return false;
+
+		if (!readSections(reader, bd.info.moves) || !reader.get(count) || !reader.has(count, sizeof(int)))
+			return false;
+
+		bd.info.changedLines.reserve(count);
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			int line;
+			reader.get(line);
+
+			bd.info.changedLines.emplace_back(line);
+
+			if (!readSections(reader, bd.info.changedLines.back().changes))
+				return false;
+		}
+	}
+
+	if (!reader.atEnd())
+		return false;
+
+	// Re-link the changed blocks pairs exactly as runDiffs() does
+	for (size_t i = 1; i < cmpInfo.blockDiffs.size(); ++i)
+	{
+		if ((cmpInfo.blockDiffs[i].type == diff_type::DIFF_IN_2) &&
+			(cmpInfo.blockDiffs[i - 1].type == diff_type::DIFF_IN_1))
+		{
+			if (cmpInfo.blockDiffs[i - 1].info.changedLines.size() != cmpInfo.blockDiffs[i].info.changedLines.size())
+				return false;
+
+			cmpInfo.blockDiffs[i - 1].info.matchBlock	= &cmpInfo.blockDiffs[i];
+			cmpInfo.blockDiffs[i].info.matchBlock		= &cmpInfo.blockDiffs[i - 1];
+		}
+	}
+
+	return true;
+}
+
+
+bool loadCompareResult(const CacheKey& key, CompareInfo& cmpInfo)
+{
+	TRACE_SPAN("loadCompareResult");
+
+	CacheEntryView entry;
+
+	if (!entry.open(key))
+		return false;
+
+	CacheReader reader(entry.data(), entry.size());
+
+	if (readCompareResult(reader, cmpInfo))
+		return true;
+
+	// Corrupted entry - drop it and restore the compare info to its initial state
+	entry.close();
+	removeCacheEntry(key);
+
+	if (cmpInfo.doc1.view != MAIN_VIEW)
+		swap(cmpInfo.doc1, cmpInfo.doc2);
+
+	cmpInfo.doc1.lines.clear();
+	cmpInfo.doc1.nonUniqueLines.clear();
+	cmpInfo.doc2.lines.clear();
+	cmpInfo.doc2.nonUniqueLines.clear();
+	cmpInfo.blockDiffs.clear();
+
+	return false;
+}
+
+
+CompareResult runDiffs(CompareInfo& cmpInfo, const CompareOptions& options)
+{
+	progress_ptr& progress = ProgressDlg::Get();
+
+	{
+		STATS_PHASE(GET_LINES);
+
+		getLines(cmpInfo.doc1, options);
+	}
+
+	if (progress && !progress->NextPhase())
+		return CompareResult::COMPARE_CANCELLED;
+
+	{
+		STATS_PHASE(GET_LINES);
+
+		getLines(cmpInfo.doc2, options);
+	}
+
+	if (progress && !progress->NextPhase())
+		return CompareResult::COMPARE_CANCELLED;
+
+	LineCharsCache charsCache;
+
+	{
+		STATS_PHASE(DIFF_LINES);
+
+		auto diffRes = diffLines(cmpInfo.doc1.lines, cmpInfo.doc2.lines, true, nullptr,
+				progressCancelCheck(progress.get()));
+
+		if (progress && progress->IsCancelled())
+			return CompareResult::COMPARE_CANCELLED;
+
+		cmpInfo.blockDiffs = std::move(diffRes.first);
+
+		if (diffRes.second)
+			swap(cmpInfo.doc1, cmpInfo.doc2);
+	}
+
+	PRINT_DIFFS("LINE DIFFS", cmpInfo.blockDiffs);
+
+	if (isMatch(cmpInfo.blockDiffs))
+		return CompareResult::COMPARE_MATCH;
+
+	const int blockDiffsSize = static_cast<int>(cmpInfo.blockDiffs.size());
+
+	findUniqueLines(cmpInfo);
+
+	if (options.detectMoves)
+	{
+		STATS_PHASE(FIND_MOVES);
+
+		findMoves(cmpInfo);
+	}
+
+	if (progress && !progress->NextPhase())
+		return CompareResult::COMPARE_CANCELLED;
+
+	if (progress)
+		progress->SetMaxCount(blockDiffsSize - 1);
+
+	STATS_PHASE(COMPARE_BLOCKS);
+
+	// Do block compares
+	for (int i = 1; i < blockDiffsSize; ++i)
+	{
+		// Check if the DIFF_IN_1 / DIFF_IN_2 pair includes changed lines or it's a completely replaced block
+		if ((cmpInfo.blockDiffs[i].type == diff_type::DIFF_IN_2) &&
+			(cmpInfo.blockDiffs[i - 1].type == diff_type::DIFF_IN_1))
+		{
+			diffInfo& blockDiff1 = cmpInfo.blockDiffs[i - 1];
+			diffInfo& blockDiff2 = cmpInfo.blockDiffs[i];
+
+			blockDiff1.info.matchBlock = &blockDiff2;
+			blockDiff2.info.matchBlock = &blockDiff1;
+
+			compareBlocks(cmpInfo.doc1, cmpInfo.doc2, blockDiff1, blockDiff2, options, charsCache);
+		}
+
+		if (progress && !progress->Advance())
+			return CompareResult::COMPARE_CANCELLED;
+	}
+
+	if (progress && !progress->NextPhase())
+		return CompareResult::COMPARE_CANCELLED;
+
+	return CompareResult::COMPARE_MISMATCH;
+}
+
+
+CompareResult runCompare(const CompareOptions& options, AlignmentInfo_t& alignmentInfo, DiffMap& diffMap)
+{
+	TRACE_SPAN("runCompare");
+
+	progress_ptr& progress = ProgressDlg::Get();
+
+	CompareInfo cmpInfo;
+
+	cmpInfo.doc1.view	= MAIN_VIEW;
+	cmpInfo.doc2.view	= SUB_VIEW;
+
+	cmpInfo.doc1.diffMap	= &diffMap.runs[MAIN_VIEW];
+	cmpInfo.doc2.diffMap	= &diffMap.runs[SUB_VIEW];
+
+	cmpInfo.selectionCompare	= options.selectionCompare;
+
+	if (options.selectionCompare)
+	{
+		cmpInfo.doc1.section.off	= options.selections[MAIN_VIEW].first;
+		cmpInfo.doc1.section.len	= options.selections[MAIN_VIEW].second - options.selections[MAIN_VIEW].first + 1;
+
+		cmpInfo.doc2.section.off	= options.selections[SUB_VIEW].first;
+		cmpInfo.doc2.section.len	= options.selections[SUB_VIEW].second - options.selections[SUB_VIEW].first + 1;
+	}
+
+	cmpInfo.doc1.blockDiffMask = (options.oldFileViewId == MAIN_VIEW) ? MARKER_MASK_REMOVED : MARKER_MASK_ADDED;
+	cmpInfo.doc2.blockDiffMask = (options.oldFileViewId == MAIN_VIEW) ? MARKER_MASK_ADDED : MARKER_MASK_REMOVED;
+
+	const bool useCache = (CallScintilla(MAIN_VIEW, SCI_GETLINECOUNT, 0, 0) +
+			CallScintilla(SUB_VIEW, SCI_GETLINECOUNT, 0, 0) >= cCacheMinLines);
+
+	CacheKey cacheKey;
+
+	if (useCache)
+		cacheKey = getCompareCacheKey(options);
+
+	if (useCache && loadCompareResult(cacheKey, cmpInfo))
+	{
+		LOGD("Compare result loaded from cache\n");
+
+		// Skip straight to the markers phase
+		if (progress && !progress->LastPhase())
+			return CompareResult::COMPARE_CANCELLED;
+	}
+	else
+	{
+		const CompareResult result = runDiffs(cmpInfo, options);
+
+		if (result == CompareResult::COMPARE_CANCELLED)
+			return result;
+
+		if (useCache)
+			storeCompareResult(cacheKey, cmpInfo);
+	}
+
+	if (isMatch(cmpInfo.blockDiffs))
+		return CompareResult::COMPARE_MATCH;
+
+	{
+		STATS_PHASE(MARK_ALL_DIFFS);
+
+		if (!markAllDiffs(cmpInfo, alignmentInfo))
+			return CompareResult::COMPARE_CANCELLED;
+	}
+
+	publishDiffMap(diffMap);
+
+	return CompareResult::COMPARE_MISMATCH;
+}
+
+
+CompareResult runFindUnique(const CompareOptions& options, AlignmentInfo_t& alignmentInfo, DiffMap& diffMap)
+{
+	TRACE_SPAN("runFindUnique");
+
+	progress_ptr& progress = ProgressDlg::Get();
+
+	alignmentInfo.clear();
+
+	DocCmpInfo doc1;
+	DocCmpInfo doc2;
+
+	doc1.view	= MAIN_VIEW;
+	doc2.view	= SUB_VIEW;
+
+	if (options.selectionCompare)
+	{
+		doc1.section.off	= options.selections[MAIN_VIEW].first;
+		doc1.section.len	= options.selections[MAIN_VIEW].second - options.selections[MAIN_VIEW].first + 1;
+
+		doc2.section.off	= options.selections[SUB_VIEW].first;
+		doc2.section.len	= options.selections[SUB_VIEW].second - options.selections[SUB_VIEW].first + 1;
+	}
+
+	if (options.oldFileViewId == MAIN_VIEW)
+	{
+		doc1.blockDiffMask = MARKER_MASK_REMOVED;
+		doc2.blockDiffMask = MARKER_MASK_ADDED;
+	}
+	else
+	{
+		doc1.blockDiffMask = MARKER_MASK_ADDED;
+		doc2.blockDiffMask = MARKER_MASK_REMOVED;
+	}
+
+	{
+		STATS_PHASE(GET_LINES);
+
+		getLines(doc1, options);
+	}
+
+	if (progress && !progress->NextPhase())
+		return CompareResult::COMPARE_CANCELLED;
+
+	{
+		STATS_PHASE(GET_LINES);
+
+		getLines(doc2, options);
+	}
+
+	if (progress && !progress->NextPhase())
+		return CompareResult::COMPARE_CANCELLED;
+
+	std::unordered_map<uint64_t, std::vector<int>> doc1UniqueLines;
+
+	for (const auto& line: doc1.lines)
+	{
+		auto insertPair = doc1UniqueLines.emplace(line.hash, std::vector<int>{line.line});
+		if (!insertPair.second)
+			insertPair.first->second.emplace_back(line.line);
+	}
+
+	doc1.lines.clear();
+
+	if (progress && !progress->NextPhase())
+		return CompareResult::COMPARE_CANCELLED;
+
+	std::unordered_map<uint64_t, std::vector<int>> doc2UniqueLines;
+
+	for (const auto& line: doc2.lines)
+	{
+		auto insertPair = doc2UniqueLines.emplace(line.hash, std::vector<int>{line.line});
+		if (!insertPair.second)
+			insertPair.first->second.emplace_back(line.line);
+	}
+
+	doc2.lines.clear();
+
+	if (progress && !progress->NextPhase())
+		return CompareResult::COMPARE_CANCELLED;
+
+	int doc1UniqueLinesCount = 0;
+
+	for (const auto& uniqueLine: doc1UniqueLines)
+	{
+		auto doc2it = doc2UniqueLines.find(uniqueLine.first);
+
+		if (doc2it != doc2UniqueLines.end())
+		{
+			doc2UniqueLines.erase(doc2it);
+		}
 		else
-			result = runCompare(options, alignmentInfo);
+		{
+			for (const auto& line: uniqueLine.second)
+			{
+				add_map_run(diffMap.runs[doc1.view], line, 1, toMapType(doc1.blockDiffMask));
+
+				CallScintilla(doc1.view, SCI_MARKERADDSET, line, doc1.blockDiffMask);
+				++doc1UniqueLinesCount;
+			}
+		}
+	}
+
+	if (doc1UniqueLinesCount == 0 && doc2UniqueLines.empty())
+		return CompareResult::COMPARE_MATCH;
+
+	for (const auto& uniqueLine: doc2UniqueLines)
+	{
+		for (const auto& line: uniqueLine.second)
+		{
+			add_map_run(diffMap.runs[doc2.view], line, 1, toMapType(doc2.blockDiffMask));
+
+			CallScintilla(doc2.view, SCI_MARKERADDSET, line, doc2.blockDiffMask);
+		}
+	}
+
+	publishDiffMap(diffMap);
+
+	AlignmentPair align;
+	align.main.line	= doc1.section.off;
+	align.sub.line	= doc2.section.off;
+
+	alignmentInfo.push_back(align);
+
+	return CompareResult::COMPARE_MISMATCH;
+}
+
+
+// Changed ranges of lines indexes - blockDiffs are regarding the swapped lines if swapped is set
+std::vector<FileDiffHunk> getDiffHunks(const std::vector<diffInfo>& blockDiffs, bool swapped)
+{
+	std::vector<FileDiffHunk> hunks;
+
+	int idx1 = 0;
+	int idx2 = 0;
+
+	const int blockDiffsSize = static_cast<int>(blockDiffs.size());
+
+	for (int i = 0; i < blockDiffsSize; ++i)
+	{
+		if (blockDiffs[i].type == diff_type::DIFF_MATCH)
+		{
+			idx1 += blockDiffs[i].len;
+			idx2 += blockDiffs[i].len;
+			continue;
+		}
+
+		int len1 = 0;
+		int len2 = 0;
+
+		for (; i < blockDiffsSize && blockDiffs[i].type != diff_type::DIFF_MATCH; ++i)
+		{
+			if (blockDiffs[i].type == diff_type::DIFF_IN_1)
+				len1 += blockDiffs[i].len;
+			else
+				len2 += blockDiffs[i].len;
+		}
+
+		--i;
+
+		FileDiffHunk hunk;
+
+		hunk.lines1 = section_t(idx1, len1);
+		hunk.lines2 = section_t(idx2, len2);
+
+		if (swapped)
+			std::swap(hunk.lines1, hunk.lines2);
+
+		hunks.emplace_back(hunk);
+
+		idx1 += len1;
+		idx2 += len2;
+	}
+
+	return hunks;
+}
+
+
+// File line number at lines index (the line after the last one if index is past the end)
+inline int fileLine(const std::vector<Line>& lines, int idx)
+{
+	return (idx < static_cast<int>(lines.size())) ? lines[idx].line : (lines.empty() ? 0 : lines.back().line + 1);
+}
+
+
+inline int fileLine(const SpilledFileLines& lines, int idx)
+{
+	if (!lines.lineNumsKept)
+		return idx;
+
+	const int linesCount = static_cast<int>(lines.lineNums.size());
+
+	return (idx < linesCount) ? lines.lineNums[idx] : (linesCount ? lines.lineNums[linesCount - 1] + 1 : 0);
+}
+
+
+// Lines indexes range to file lines range - empty range position is the file line at its index
+template <typename Lines>
+inline section_t toFileLines(const Lines& lines, const section_t& idxs)
+{
+	const int off = fileLine(lines, idxs.off);
+
+	return section_t(off, idxs.len ? fileLine(lines, idxs.off + idxs.len - 1) - off + 1 : 0);
+}
+
+
+// Progress must be null if not run on the main thread - the lines diff is then stopped by isCancelled (if given)
+CompareResult runCompareFiles(const TCHAR* file1, const TCHAR* file2, const CompareOptions& options,
+		FilesCompareSummary& summary, ProgressDlg* progress, const std::function<bool()>& isCancelled = nullptr)
+{
+	TRACE_SPAN("runCompareFiles");
+
+	// Lines hashes of big files are spilled to mapped temp files and diffed in place
+	SpilledFileLines lines1;
+	SpilledFileLines lines2;
+
+	{
+		FileLinesReader reader1;
+
+		if (!reader1.open(file1))
+			return CompareResult::COMPARE_ERROR;
+
+		if (!lines1.read(reader1, summary.linesCount1, options, progress) || (progress && !progress->NextPhase()))
+			return CompareResult::COMPARE_CANCELLED;
+	}
+
+	{
+		FileLinesReader reader2;
+
+		if (!reader2.open(file2))
+			return CompareResult::COMPARE_ERROR;
+
+		if (!lines2.read(reader2, summary.linesCount2, options, progress) || (progress && !progress->NextPhase()))
+			return CompareResult::COMPARE_CANCELLED;
+	}
+
+	const std::function<bool()> cancelCheck = progress ? progressCancelCheck(progress) : isCancelled;
+
+	const auto diffRes = diffLines(lines1.hashes.view(), lines2.hashes.view(), progress != nullptr, nullptr,
+			cancelCheck, cHugeLinesMaxCost);
+
+	if ((progress && !progress->NextPhase()) || (cancelCheck && cancelCheck()))
+		return CompareResult::COMPARE_CANCELLED;
+
+	summary.hunks = getDiffHunks(diffRes.first, diffRes.second);
+
+	for (auto& hunk: summary.hunks)
+	{
+		hunk.lines1 = toFileLines(lines1, hunk.lines1);
+		hunk.lines2 = toFileLines(lines2, hunk.lines2);
+
+		summary.removedLines	+= hunk.lines1.len;
+		summary.addedLines		+= hunk.lines2.len;
+	}
+
+	return summary.hunks.empty() ? CompareResult::COMPARE_MATCH : CompareResult::COMPARE_MISMATCH;
+}
+
+
+// Sorted unique line hashes of a file (according to the compare options) - empty if the file can't be read
+std::vector<uint64_t> getFileLinesSet(const std::wstring& file, const CompareOptions& options)
+{
+	std::vector<uint64_t> linesSet;
+
+	FileLinesReader reader;
+	std::vector<Line> lines;
+	int linesCount;
+
+	if (!reader.open(file.c_str()) || !getFileLines(reader, lines, linesCount, options, nullptr))
+		return linesSet;
+
+	linesSet.reserve(lines.size());
+
+	for (const auto& line: lines)
+		linesSet.emplace_back(line.hash);
+
+	std::sort(linesSet.begin(), linesSet.end());
+	linesSet.erase(std::unique(linesSet.begin(), linesSet.end()), linesSet.end());
+
+	return linesSet;
+}
+
+
+/**
+ *  \class  FoldersCompareJob
+ *  \brief  Files pairs compares of a folders compare - their loads are the files pairs sizes. Finished tasks are
+ *          queued by the workers and passed on to taskDone on the thread that runs the job.
+ */
+class FoldersCompareJob : public WorkersJob
+{
+public:
+	FoldersCompareJob(const std::vector<uint64_t>& loads, const std::function<void(size_t task)>& runTask,
+			const std::function<void(size_t task)>& taskDone) :
+		WorkersJob(static_cast<int>(loads.size()), cFoldersCompareMaxLoad), _loads(loads), _runTask(runTask),
+		_taskDone(taskDone)
+	{
+		::InitializeCriticalSection(&_doneLock);
+	}
+
+	virtual ~FoldersCompareJob()
+	{
+		::DeleteCriticalSection(&_doneLock);
+	}
+
+	using WorkersJob::isCancelled;
+
+protected:
+	virtual void runTask(int task)
+	{
+		_runTask(static_cast<size_t>(task));
+
+		::EnterCriticalSection(&_doneLock);
+		_doneTasks.emplace_back(static_cast<size_t>(task));
+		::LeaveCriticalSection(&_doneLock);
+	}
+
+	virtual uint64_t taskLoad(int task) const
+	{
+		return _loads[task];
+	}
+
+	virtual void onRunWait()
+	{
+		std::vector<size_t> doneTasks;
+
+		::EnterCriticalSection(&_doneLock);
+		doneTasks.swap(_doneTasks);
+		::LeaveCriticalSection(&_doneLock);
+
+		for (size_t task: doneTasks)
+			_taskDone(task);
+	}
+
+private:
+	const std::vector<uint64_t>&					_loads;
+	const std::function<void(size_t task)>&		_runTask;
+	const std::function<void(size_t task)>&		_taskDone;
+
+	CRITICAL_SECTION	_doneLock;
+	std::vector<size_t>	_doneTasks;
+};
+
+
+/**
+ *  \class  FoldersComparePlatform
+ *  \brief  Win32 file system, engine files compares, worker threads and progress dialog of the folders compare
+ */
+class FoldersComparePlatform : public folder_compare_platform
+{
+public:
+	FoldersComparePlatform(const CompareOptions& options, ProgressDlg* progress) :
+		_options(options), _progress(progress) {}
+
+	virtual bool list_files(const std::wstring& dir, std::vector<folder_file>& files)
+	{
+		return listFolderFiles(dir, files);
+	}
+
+	virtual bool file_hash(const std::wstring& file, uint64_t& hash)
+	{
+		return getFileHash(file, hash);
+	}
+
+	virtual std::vector<uint64_t> file_lines_set(const std::wstring& file)
+	{
+		return getFileLinesSet(file, _options);
+	}
+
+	virtual void compare_file_lines(const std::wstring& file1, const std::wstring& file2, FolderCompareItem& item);
+
+	virtual bool run_tasks(const std::vector<uint64_t>& loads, const std::function<void(size_t task)>& runTask,
+			const std::function<void(size_t task)>& taskDone);
+
+	virtual bool next_phase()
+	{
+		return (!_progress || _progress->NextPhase());
+	}
+
+	virtual void set_progress_max(unsigned max)
+	{
+		if (_progress)
+			_progress->SetMaxCount(max);
+	}
+
+	virtual bool advance_progress()
+	{
+		return (!_progress || _progress->Advance());
+	}
+
+	virtual bool is_cancelled()
+	{
+		return (_progress && _progress->IsCancelled());
+	}
+
+private:
+	const CompareOptions&	_options;
+	ProgressDlg*			_progress;
+
+	// Job of the running tasks - its cancel stops their lines diffs
+	const FoldersCompareJob*	_job {nullptr};
+};
+
+
+// Runs on the worker threads
+void FoldersComparePlatform::compare_file_lines(const std::wstring& file1, const std::wstring& file2,
+		FolderCompareItem& item)
+{
+	FilesCompareSummary summary;
+
+	const CompareResult result = runCompareFiles(file1.c_str(), file2.c_str(), _options, summary, nullptr,
+			[this]() { return (_job && _job->isCancelled()); });
+
+	if (result == CompareResult::COMPARE_MATCH)
+		item.state = FolderItemState::MATCH;
+	else if (result == CompareResult::COMPARE_MISMATCH)
+		item.state = FolderItemState::MISMATCH;
+	else
+		item.state = FolderItemState::COMPARE_ERROR;
+
+	item.removedLines	= summary.removedLines;
+	item.addedLines		= summary.addedLines;
+}
+
+
+bool FoldersComparePlatform::run_tasks(const std::vector<uint64_t>& loads,
+		const std::function<void(size_t task)>& runTask, const std::function<void(size_t task)>& taskDone)
+{
+	FoldersCompareJob job(loads, runTask, taskDone);
+
+	_job = &job;
+
+	const bool done = job.run(_progress);
+
+	_job = nullptr;
+
+	return done;
+}
+
+
+CompareResult runCompareFolders(const TCHAR* folder1, const TCHAR* folder2, const CompareOptions& options,
+		FoldersCompareSummary& summary, const std::function<void(const FolderCompareItem& item)>& itemDone)
+{
+	TRACE_SPAN("runCompareFolders");
+
+	std::wstring dir1 = folder1;
+	std::wstring dir2 = folder2;
+
+	if (dir1.empty() || dir1.back() != L'\\')
+		dir1 += L'\\';
+
+	if (dir2.empty() || dir2.back() != L'\\')
+		dir2 += L'\\';
+
+	FoldersComparePlatform platform(options, ProgressDlg::Get().get());
+
+	// Renames are file moves between paths - detected with the moves
+	const folders_compare_result result =
+			compare_folders(dir1, dir2, options.detectMoves, options.matchPercentThreshold, platform, summary,
+					itemDone);
+
+	if (result == folders_compare_result::MATCH)
+		return CompareResult::COMPARE_MATCH;
+
+	if (result == folders_compare_result::MISMATCH)
+		return CompareResult::COMPARE_MISMATCH;
+
+	if (result == folders_compare_result::CANCELLED)
+		return CompareResult::COMPARE_CANCELLED;
+
+	return CompareResult::COMPARE_ERROR;
+}
+
+
+/**
+ *  \struct
+ *  \brief  Our or their side of a three-way compare - reads the side file lines and diffs them against the base
+ *          lines. Both sides share the base lines read and hashed once. Each side stops when the compare is
+ *          cancelled or when the other side fails (the shared stop flag is set).
+ */
+struct ThreeWaySide
+{
+	ThreeWaySide(const TCHAR* f, const std::vector<Line>& base, const CompareOptions& opt, ProgressDlg* p,
+			const ProgressDlg* dlg, volatile LONG& s) :
+		file(f), baseLines(base), options(opt), progress(p), cancelDlg(dlg), stop(s) {}
+
+	static DWORD WINAPI threadFunc(LPVOID data);
+
+	// Progress must be null if not run on the main thread - cancelDlg is only checked for cancel on any thread
+	void run();
+
+	inline bool isCancelled() const
+	{
+		return (stop != 0 || (cancelDlg && cancelDlg->IsCancelled()));
+	}
+
+	const TCHAR*				file;
+	const std::vector<Line>&	baseLines;
+	const CompareOptions&		options;
+	ProgressDlg*				progress;
+	const ProgressDlg*			cancelDlg;
+	volatile LONG&				stop;
+
+	std::vector<Line>	lines;
+	int					linesCount {0};
+
+	// Changes as lines indexes
+	std::vector<merge_hunk>	hunks;
+
+	CompareResult	result {CompareResult::COMPARE_ERROR};
+
+private:
+	void compare();
+};
+
+
+DWORD WINAPI ThreeWaySide::threadFunc(LPVOID data)
+{
+	static_cast<ThreeWaySide*>(data)->run();
+
+	return 0;
+}
+
+
+void ThreeWaySide::run()
+{
+	compare();
+
+	// The other side's result is of no use any more
+	if (result == CompareResult::COMPARE_ERROR || result == CompareResult::COMPARE_CANCELLED)
+		::InterlockedExchange(&stop, 1);
+}
+
+
+void ThreeWaySide::compare()
+{
+	TRACE_SPAN("threeWaySide");
+
+	// Exceptions are not propagated - the other side might still be using the base lines
+	try
+	{
+		FileLinesReader reader;
+
+		if (!reader.open(file))
+			return;
+
+		if (!getFileLines(reader, lines, linesCount, options, progress) || isCancelled())
+		{
+			result = CompareResult::COMPARE_CANCELLED;
+			return;
+		}
+
+		const auto diffRes = diffLines(baseLines, lines, progress != nullptr, nullptr,
+				[this]() { return isCancelled(); });
+
+		if (isCancelled())
+		{
+			result = CompareResult::COMPARE_CANCELLED;
+			return;
+		}
+
+		for (const auto& diffHunk: getDiffHunks(diffRes.first, diffRes.second))
+		{
+			merge_hunk hunk;
+
+			hunk.base = merge_range(diffHunk.lines1.off, diffHunk.lines1.len);
+			hunk.side = merge_range(diffHunk.lines2.off, diffHunk.lines2.len);
+
+			hunks.emplace_back(hunk);
+		}
+
+		result = hunks.empty() ? CompareResult::COMPARE_MATCH : CompareResult::COMPARE_MISMATCH;
+	}
+	catch (...)
+	{
+		result = CompareResult::COMPARE_ERROR;
+	}
+}
+
+
+inline bool areSameLines(const std::vector<Line>& lines1, const merge_range& range1, const std::vector<Line>& lines2,
+		const merge_range& range2)
+{
+	return (range1.len == range2.len &&
+			std::equal(lines1.begin() + range1.off, lines1.begin() + range1.off + range1.len,
+					lines2.begin() + range2.off));
+}
+
+
+// Merge region lines indexes to file lines
+inline section_t toFileLines(const std::vector<Line>& lines, const merge_range& idxs)
+{
+	return toFileLines(lines, section_t(idxs.off, idxs.len));
+}
+
+
+CompareResult runCompareThreeWay(const TCHAR* baseFile, const TCHAR* oursFile, const TCHAR* theirsFile,
+		const CompareOptions& options, ThreeWayCompareSummary& summary)
+{
+	TRACE_SPAN("runCompareThreeWay");
+
+	progress_ptr& progress = ProgressDlg::Get();
+
+	std::vector<Line> baseLines;
+
+	{
+		FileLinesReader reader;
+
+		if (!reader.open(baseFile))
+			return CompareResult::COMPARE_ERROR;
+
+		if (!getFileLines(reader, baseLines, summary.linesCountBase, options, progress.get()) ||
+				(progress && !progress->NextPhase()))
+			return CompareResult::COMPARE_CANCELLED;
+	}
+
+	volatile LONG stop = 0;
+
+	ThreeWaySide ours(oursFile, baseLines, options, progress.get(), progress.get(), stop);
+	ThreeWaySide theirs(theirsFile, baseLines, options, nullptr, progress.get(), stop);
+
+	// Their side is diffed on a worker thread while ours is on this one (progress is shown for our side only).
+	// The worker stops on cancel or our side failure so the wait below ends soon after either.
+	HANDLE hWorker = ::CreateThread(NULL, 0, ThreeWaySide::threadFunc, &theirs, 0, NULL);
+
+	ours.run();
+
+	if (hWorker)
+	{
+		::WaitForSingleObject(hWorker, INFINITE);
+		::CloseHandle(hWorker);
+	}
+	else if (ours.result != CompareResult::COMPARE_ERROR && ours.result != CompareResult::COMPARE_CANCELLED)
+	{
+		theirs.run();
+	}
+
+	if (ours.result == CompareResult::COMPARE_ERROR || theirs.result == CompareResult::COMPARE_ERROR)
+		return CompareResult::COMPARE_ERROR;
+
+	if (ours.result == CompareResult::COMPARE_CANCELLED || theirs.result == CompareResult::COMPARE_CANCELLED ||
+			(progress && !progress->NextPhase()))
+		return CompareResult::COMPARE_CANCELLED;
+
+	summary.linesCountOurs		= ours.linesCount;
+	summary.linesCountTheirs	= theirs.linesCount;
+
+	const std::vector<merge_region> regions = merge_changes(ours.hunks, theirs.hunks,
+			static_cast<int>(baseLines.size()),
+			[&](const merge_range& oursLines, const merge_range& theirsLines)
+			{
+				return areSameLines(ours.lines, oursLines, theirs.lines, theirsLines);
+			});
+
+	bool match = true;
+
+	summary.regions.reserve(regions.size());
+
+	for (const auto& mr: regions)
+	{
+		MergeRegion region;
+
+		region.type		= mr.type;
+		region.base		= toFileLines(baseLines, mr.base);
+		region.ours		= toFileLines(ours.lines, mr.ours);
+		region.theirs	= toFileLines(theirs.lines, mr.theirs);
+
+		summary.regions.emplace_back(region);
+
+		if (region.type == MergeRegionType::CONFLICT)
+			++summary.conflicts;
+
+		if (region.type != MergeRegionType::STABLE)
+			match = false;
+	}
+
+	return match ? CompareResult::COMPARE_MATCH : CompareResult::COMPARE_MISMATCH;
+}
+
+
+// Counts changed blocks lines (ignored lines are not counted). Lines removed in one block and added in another are
+// moved (if detectMoves is set), the rest of the block lines are changed in pairs and the left ones are removed or
+// added.
+void countLinesChanges(const std::vector<Line>& lines1, const std::vector<Line>& lines2,
+		const std::vector<FileDiffHunk>& hunks, bool detectMoves, BaselineVariantSummary& variant)
+{
+	const int hunksCount = static_cast<int>(hunks.size());
+
+	std::vector<int> moved1(hunksCount, 0);
+	std::vector<int> moved2(hunksCount, 0);
+
+	if (detectMoves)
+	{
+		// Removed lines hash to the blocks they are removed from
+		std::unordered_map<uint64_t, std::vector<int>> removedLines;
+
+		for (int h = 0; h < hunksCount; ++h)
+		{
+			const section_t& sec = hunks[h].lines1;
+
+			for (int i = sec.off; i < sec.off + sec.len; ++i)
+			{
+				// Empty lines are not moved, they are just everywhere
+				if (lines1[i].hash != cHashSeed)
+					removedLines[lines1[i].hash].emplace_back(h);
+			}
+		}
+
+		for (int h = 0; h < hunksCount; ++h)
+		{
+			const section_t& sec = hunks[h].lines2;
+
+			for (int i = sec.off; i < sec.off + sec.len; ++i)
+			{
+				auto removed = removedLines.find(lines2[i].hash);
+
+				if (removed == removedLines.end() || removed->second.empty())
+					continue;
+
+				++moved1[removed->second.back()];
+				++moved2[h];
+				++variant.movedLines;
+
+				removed->second.pop_back();
+			}
+		}
+	}
+
+	for (int h = 0; h < hunksCount; ++h)
+	{
+		const int removed	= hunks[h].lines1.len - moved1[h];
+		const int added		= hunks[h].lines2.len - moved2[h];
+		const int changed	= std::min(removed, added);
+
+		variant.changedLines	+= changed;
+		variant.removedLines	+= removed - changed;
+		variant.addedLines		+= added - changed;
+	}
+}
+
+
+/**
+ *  \class  BaselineCompareJob
+ *  \brief  Compares of files to the baseline lines - the baseline lines and chunks index are shared by all workers
+ */
+class BaselineCompareJob : public WorkersJob
+{
+public:
+	BaselineCompareJob(const std::vector<Line>& baseLines, const seq_chunks_index* baseIndex,
+			const std::vector<std::wstring>& files, const CompareOptions& options,
+			std::vector<BaselineVariantSummary>& variants) :
+		WorkersJob(static_cast<int>(files.size())),
+		_baseLines(baseLines), _baseIndex(baseIndex), _files(files), _options(options), _variants(variants) {}
+
+protected:
+	virtual void runTask(int task);
+
+private:
+	const std::vector<Line>&			_baseLines;
+	const seq_chunks_index*				_baseIndex;
+	const std::vector<std::wstring>&	_files;
+	const CompareOptions&				_options;
+
+	std::vector<BaselineVariantSummary>&	_variants;
+};
+
+
+// Runs on the worker threads
+void BaselineCompareJob::runTask(int task)
+{
+	BaselineVariantSummary& variant = _variants[task];
+
+	variant.result = CompareResult::COMPARE_ERROR;
+
+	try
+	{
+		FileLinesReader reader;
+		std::vector<Line> lines;
+
+		if (!reader.open(_files[task].c_str()) || !getFileLines(reader, lines, variant.linesCount, _options, nullptr))
+			return;
+
+		const auto diffRes = diffLines(_baseLines, lines, false, _baseIndex, [this]() { return isCancelled(); });
+
+		if (isCancelled())
+			return;
+		const std::vector<FileDiffHunk> hunks = getDiffHunks(diffRes.first, diffRes.second);
+
+		countLinesChanges(_baseLines, lines, hunks, _options.detectMoves, variant);
+
+		variant.result = hunks.empty() ? CompareResult::COMPARE_MATCH : CompareResult::COMPARE_MISMATCH;
+	}
+	catch (...)
+	{
+		variant.result = CompareResult::COMPARE_ERROR;
+	}
+}
+
+
+CompareResult runCompareToBaseline(const TCHAR* baselineFile, const std::vector<std::wstring>& files,
+		const CompareOptions& options, BaselineCompareSummary& summary)
+{
+	TRACE_SPAN("runCompareToBaseline");
+
+	progress_ptr& progress = ProgressDlg::Get();
+
+	std::vector<Line> baseLines;
+
+	{
+		FileLinesReader reader;
+
+		if (!reader.open(baselineFile))
+			return CompareResult::COMPARE_ERROR;
+
+		if (!getFileLines(reader, baseLines, summary.baselineLinesCount, options, progress.get()) ||
+				(progress && !progress->NextPhase()))
+			return CompareResult::COMPARE_CANCELLED;
+	}
+
+	// Only huge baselines are pre-aligned to the compared files - their chunks index is built once for all
+	std::unique_ptr<seq_chunks_index> baseIndex;
 
+	if (static_cast<int>(baseLines.size()) >= cPreAlignMinLines)
+		baseIndex.reset(new seq_chunks_index(get_chunks_index(baseLines)));
+
+	summary.variants.resize(files.size());
+
+	// Files compares are the longest - give them the biggest progress phase
+	if (progress && (!progress->NextPhase() || !progress->NextPhase()))
+		return CompareResult::COMPARE_CANCELLED;
+
+	{
+		BaselineCompareJob job(baseLines, baseIndex.get(), files, options, summary.variants);
+
+		if (!job.run(progress.get()))
+			return CompareResult::COMPARE_CANCELLED;
+	}
+
+	for (const auto& variant: summary.variants)
+	{
+		if (variant.result != CompareResult::COMPARE_MATCH)
+			return CompareResult::COMPARE_MISMATCH;
+	}
+
+	return CompareResult::COMPARE_MATCH;
+}
+
+
+/**
+ *  \brief  Runs a compare entry point - opens the progress dialog (if progressInfo is given) and traces the run.
+ *          Exceptions are reported to the user. outOfMemoryMsg, if given, replaces the generic out of memory message.
+ */
+template <typename CompareFunc>
+CompareResult guardedCompare(const TCHAR* progressInfo, const TCHAR* outOfMemoryMsg, CompareFunc compareFunc)
+{
+	CompareResult result = CompareResult::COMPARE_ERROR;
+
+	TRACE_START();
+
+	if (progressInfo)
+		ProgressDlg::Open(progressInfo);
+
+	try
+	{
+		result = compareFunc();
+
+		ProgressDlg::Close();
+	}
+	catch (std::bad_alloc&)
+	{
 		ProgressDlg::Close();
+
+		::MessageBox(nppData._nppHandle, outOfMemoryMsg ? outOfMemoryMsg :
+				TEXT("Not enough memory to complete the compare."), TEXT("Compare"), MB_OK | MB_ICONWARNING);
+
+		// Already reported - the caller should not report a failure as well
+		result = CompareResult::COMPARE_CANCELLED;
 	}
 	catch (std::exception& e)
 	{
@@ -1467,5 +3581,208 @@ CompareResult compareViews(const CompareOptions& options, const TCHAR* progressI
 		::MessageBoxA(nppData._nppHandle, "Unknown exception occurred.", "Compare", MB_OK | MB_ICONWARNING);
 	}
 
+	TRACE_DUMP();
+
+	return result;
+}
+
+}
+
+
+void updateLinesHashCache(HWND hSci, const SCNotification* notifyCode)
+{
+	if (linesHashCache.empty())
+		return;
+
+	auto docHashes = findDocLinesHashes(static_cast<int>(::SendMessage(hSci, SCI_GETDOCPOINTER, 0, 0)));
+
+	if (docHashes == linesHashCache.end())
+		return;
+
+	const int lengthChange = (notifyCode->modificationType & SC_MOD_INSERTTEXT) ?
+			notifyCode->length : -notifyCode->length;
+
+	const int length	= static_cast<int>(::SendMessage(hSci, SCI_GETLENGTH, 0, 0));
+	const int line		= static_cast<int>(::SendMessage(hSci, SCI_LINEFROMPOSITION, notifyCode->position, 0));
+
+	// Some modification has been missed or the document id is reused - the cache can't be updated
+	if (docHashes->length + lengthChange != length ||
+			line + 1 - std::min(notifyCode->linesAdded, 0) > docHashes->linesCount)
+	{
+		linesHashCache.erase(docHashes);
+		return;
+	}
+
+	docHashes->length		= length;
+	docHashes->linesCount	+= notifyCode->linesAdded;
+	docHashes->contentId	= 0;
+	docHashes->edited		= true;
+
+	if (docHashes->valid.empty())
+		return;
+
+	// Inserted lines follow the changed one while the deleted ones are joined to it
+	if (notifyCode->linesAdded > 0)
+	{
+		for (auto& hashes: docHashes->hashes)
+			hashes.insert(hashes.begin() + line + 1, notifyCode->linesAdded, cHashSeed);
+
+		docHashes->valid.insert(docHashes->valid.begin() + line + 1, notifyCode->linesAdded, 0);
+	}
+	else if (notifyCode->linesAdded < 0)
+	{
+		for (auto& hashes: docHashes->hashes)
+			hashes.erase(hashes.begin() + line + 1, hashes.begin() + line + 1 - notifyCode->linesAdded);
+
+		docHashes->valid.erase(docHashes->valid.begin() + line + 1,
+				docHashes->valid.begin() + line + 1 - notifyCode->linesAdded);
+	}
+
+	docHashes->valid[line] = 0;
+}
+
+
+void invalidateLinesHashCache(LRESULT buffId)
+{
+	auto docHashes = std::find_if(linesHashCache.begin(), linesHashCache.end(),
+			[buffId](const DocLinesHashes& doc) { return (doc.buffId == buffId); });
+
+	if (docHashes != linesHashCache.end())
+		dropDocLinesHashes(docHashes);
+}
+
+
+void setDocContentId(int view, uint64_t contentId)
+{
+	const DocLinesHashes* contentHashes = contentLinesHashes.find(contentId);
+
+	if (contentHashes && contentHashes->length == CallScintilla(view, SCI_GETLENGTH, 0, 0) &&
+			contentHashes->linesCount == CallScintilla(view, SCI_GETLINECOUNT, 0, 0))
+	{
+		const int sciDoc = getDocId(view);
+
+		auto docHashes = findDocLinesHashes(sciDoc);
+
+		if (docHashes != linesHashCache.end())
+			linesHashCache.erase(docHashes);
+
+		linesHashCache.emplace_front(*contentHashes);
+
+		DocLinesHashes& reusedHashes = linesHashCache.front();
+
+		reusedHashes.sciDoc		= sciDoc;
+		reusedHashes.buffId		= getCurrentBuffId(view);
+		reusedHashes.modified	= (CallScintilla(view, SCI_GETMODIFY, 0, 0) != 0);
+		reusedHashes.fileTime	= getDocFileTime(view);
+		reusedHashes.edited		= false;
+
+		if (static_cast<int>(linesHashCache.size()) > cLinesHashCacheDocs)
+			dropDocLinesHashes(std::prev(linesHashCache.end()));
+
+		LOGD("Lines hashes of known content reused\n");
+
+		return;
+	}
+
+	getCachedLinesHashes(view).contentId = contentId;
+}
+
+
+#ifdef DLOG
+
+void getViewLinesHashes(int view, const CompareOptions& options, std::vector<uint64_t>& hashes,
+		std::vector<int>& lengths)
+{
+	hashes.clear();
+	lengths.clear();
+
+	if (CallScintilla(view, SCI_GETLENGTH, 0, 0) == 0)
+		return;
+
+	DocCmpInfo doc;
+	doc.view = view;
+
+	// Makes sure all lines are hashed
+	getLines(doc, options);
+
+	hashes = getCachedLinesHashes(view).hashes[hashVariant(options)];
+
+	const int linesCount = static_cast<int>(hashes.size());
+
+	lengths.resize(linesCount);
+
+	for (int line = 0; line < linesCount; ++line)
+		lengths[line] = (hashes[line] == cHashSeed) ? 0 : getLineEnd(view, line) - getLineStart(view, line);
+}
+
+#endif
+
+
+CompareResult compareViews(const CompareOptions& options, const TCHAR* progressInfo, AlignmentInfo_t& alignmentInfo,
+		DiffMap& diffMap)
+{
+	diffMap.clear();
+
+	// Collected until the views are aligned (compare mismatch) so the alignment is counted as well
+	STATS_START();
+
+	const CompareResult result = guardedCompare(progressInfo, nullptr,
+			[&]()
+			{
+				return options.findUniqueMode ? runFindUnique(options, alignmentInfo, diffMap) :
+						runCompare(options, alignmentInfo, diffMap);
+			});
+
+	if (result != CompareResult::COMPARE_MISMATCH)
+	{
+		diffMap.clear();
+
+		STATS_STOP();
+	}
+
 	return result;
 }
+
+
+CompareResult compareFiles(const TCHAR* file1, const TCHAR* file2, const CompareOptions& options,
+		const TCHAR* progressInfo, FilesCompareSummary& summary)
+{
+	summary = FilesCompareSummary();
+
+	// Lines hashes of both files are mapped whole - 8 bytes per line (12 if empty lines are ignored) of address space
+	return guardedCompare(progressInfo,
+			TEXT("Not enough address space to compare the files - about 8 bytes per line are mapped to compare ")
+			TEXT("files on disk (up to about 100 million lines of both files together in 32-bit Notepad++)."),
+			[&]() { return runCompareFiles(file1, file2, options, summary, ProgressDlg::Get().get()); });
+}
+
+
+CompareResult compareFolders(const TCHAR* dir1, const TCHAR* dir2, const CompareOptions& options,
+		const TCHAR* progressInfo, FoldersCompareSummary& summary,
+		const std::function<void(const FolderCompareItem& item)>& itemDone)
+{
+	summary = FoldersCompareSummary();
+
+	return guardedCompare(progressInfo, nullptr,
+			[&]() { return runCompareFolders(dir1, dir2, options, summary, itemDone); });
+}
+
+
+CompareResult compareFilesThreeWay(const TCHAR* baseFile, const TCHAR* oursFile, const TCHAR* theirsFile,
+		const CompareOptions& options, const TCHAR* progressInfo, ThreeWayCompareSummary& summary)
+{
+	summary = ThreeWayCompareSummary();
+
+	return guardedCompare(progressInfo, nullptr,
+			[&]() { return runCompareThreeWay(baseFile, oursFile, theirsFile, options, summary); });
+}
+
+
+CompareResult compareToBaseline(const TCHAR* baselineFile, const std::vector<std::wstring>& files,
+		const CompareOptions& options, const TCHAR* progressInfo, BaselineCompareSummary& summary)
+{
+	summary = BaselineCompareSummary();
+
+	return guardedCompare(progressInfo, nullptr,
+			[&]() { return runCompareToBaseline(baselineFile, files, options, summary); });
+}
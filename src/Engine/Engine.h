@@ -20,11 +20,17 @@
 #pragma once
 
 #include <windows.h>
+#include <cstdint>
+#include <string>
 #include <vector>
 #include <utility>
+#include <functional>
 
 #include "Compare.h"
 #include "NppHelpers.h"
+#include "diffmap.h"
+#include "folder_compare.h"
+#include "three_way_merge.h"
 
 
 enum class CompareResult
@@ -83,4 +89,143 @@ struct AlignmentPair
 using AlignmentInfo_t = std::vector<AlignmentPair>;
 
 
-CompareResult compareViews(const CompareOptions& options, const TCHAR* progressInfo, AlignmentInfo_t& alignmentInfo);
+// Run-length summary of the compare markers (indexed by view id) - lets the NavBar render without querying each line
+struct DiffMap
+{
+	void clear()
+	{
+		linesCount[MAIN_VIEW]	= 0;
+		linesCount[SUB_VIEW]	= 0;
+
+		runs[MAIN_VIEW].clear();
+		runs[SUB_VIEW].clear();
+	}
+
+	// Views lines count at the time of compare - map is valid only while they are unchanged
+	int			linesCount[2] {0, 0};
+	diff_map_t	runs[2];
+};
+
+
+inline map_type toMapType(int marker)
+{
+	if (marker & MARKER_MASK_CHANGED)	return map_type::MAP_CHANGED;
+	if (marker & MARKER_MASK_ADDED)		return map_type::MAP_ADDED;
+	if (marker & MARKER_MASK_REMOVED)	return map_type::MAP_REMOVED;
+	if (marker & MARKER_MASK_MOVED)		return map_type::MAP_MOVED;
+
+	return map_type::MAP_NONE;
+}
+
+
+// Changed lines range in files compared on disk (lines are 0-based, len can be 0 in one of the files)
+struct FileDiffHunk
+{
+	section_t	lines1;
+	section_t	lines2;
+};
+
+
+struct FilesCompareSummary
+{
+	int		linesCount1 {0};
+	int		linesCount2 {0};
+
+	int		removedLines {0};
+	int		addedLines {0};
+
+	std::vector<FileDiffHunk>	hunks;
+};
+
+
+// Lines changes of a file compared to the baseline file (ignored lines are not counted)
+struct BaselineVariantSummary
+{
+	CompareResult	result {CompareResult::COMPARE_ERROR};
+
+	int		linesCount {0};
+
+	int		removedLines {0};
+	int		addedLines {0};
+	int		changedLines {0};
+	int		movedLines {0};
+};
+
+
+struct BaselineCompareSummary
+{
+	int		baselineLinesCount {0};
+
+	// In the compared files order
+	std::vector<BaselineVariantSummary>	variants;
+};
+
+
+// Lines ranges of the three-way compared files (lines are 0-based, len can be 0)
+struct MergeRegion
+{
+	MergeRegionType	type;
+
+	section_t	base;
+	section_t	ours;
+	section_t	theirs;
+};
+
+
+struct ThreeWayCompareSummary
+{
+	int		linesCountBase {0};
+	int		linesCountOurs {0};
+	int		linesCountTheirs {0};
+
+	int		conflicts {0};
+
+	// All base lines are covered in order, stable regions included
+	std::vector<MergeRegion>	regions;
+};
+
+
+// Keeps the documents lines hash cache in sync with the text modifications (SC_MOD_INSERTTEXT / SC_MOD_DELETETEXT)
+void updateLinesHashCache(HWND hSci, const SCNotification* notifyCode);
+void invalidateLinesHashCache(LRESULT buffId);
+
+// Marks the view document content as known by id (like a Git blob id) until it is modified. Line hashes of such
+// documents are kept when they are closed so the same content loaded later in another document is not re-hashed.
+void setDocContentId(int view, uint64_t contentId);
+
+#ifdef DLOG
+
+// Gets the view document lines hashes (as compared with the given options) and lengths - lines that are empty with
+// the options applied have length 0. Used to record compare sessions without the documents text.
+void getViewLinesHashes(int view, const CompareOptions& options, std::vector<uint64_t>& hashes,
+		std::vector<int>& lengths);
+
+#endif
+
+CompareResult compareViews(const CompareOptions& options, const TCHAR* progressInfo, AlignmentInfo_t& alignmentInfo,
+		DiffMap& diffMap);
+
+// Compares files directly from disk without loading them in the editor
+CompareResult compareFiles(const TCHAR* file1, const TCHAR* file2, const CompareOptions& options,
+		const TCHAR* progressInfo, FilesCompareSummary& summary);
+
+/**
+ *  \brief  Compares all files of two folders (and their sub-folders) paired by relative path from disk. Files of equal
+ *          size are first checked for equal content by whole file hash. The others are compared by lines on a pool
+ *          of worker threads. If options.detectMoves is set, files found in only one of the folders are paired as
+ *          renamed by equal content or by lines similarity. The items are passed to itemDone (on the calling thread) in
+ *          path order while the other files are still compared.
+ */
+CompareResult compareFolders(const TCHAR* dir1, const TCHAR* dir2, const CompareOptions& options,
+		const TCHAR* progressInfo, FoldersCompareSummary& summary,
+		const std::function<void(const FolderCompareItem& item)>& itemDone);
+
+// Three-way compares files directly from disk - base lines are hashed once and diffed against our and their lines
+// concurrently. The changes of both are then merged into stable, changed and conflicting regions.
+CompareResult compareFilesThreeWay(const TCHAR* baseFile, const TCHAR* oursFile, const TCHAR* theirsFile,
+		const CompareOptions& options, const TCHAR* progressInfo, ThreeWayCompareSummary& summary);
+
+// Compares many files from disk to one baseline file - the baseline lines are read and hashed once and the files are
+// compared to them in parallel. Moved lines are counted only if options.detectMoves is set.
+CompareResult compareToBaseline(const TCHAR* baselineFile, const std::vector<std::wstring>& files,
+		const CompareOptions& options, const TCHAR* progressInfo, BaselineCompareSummary& summary);
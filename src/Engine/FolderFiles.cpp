@@ -0,0 +1,111 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <windows.h>
+#include <cstdint>
+#include <cwchar>
+#include <string>
+#include <vector>
+
+#include "FolderFiles.h"
+#include "CompareCache.h"
+
+
+namespace {
+
+const uint64_t	cFileHashSeed		= 0x84222325;
+const DWORD		cFileHashBufSize	= 1024 * 1024;
+
+
+bool listSubFolderFiles(const std::wstring& dir, const std::wstring& subDir, std::vector<folder_file>& files)
+{
+	WIN32_FIND_DATA fd;
+
+	HANDLE hFind = ::FindFirstFile((dir + subDir + L"*").c_str(), &fd);
+
+	if (hFind == INVALID_HANDLE_VALUE)
+		return (::GetLastError() == ERROR_FILE_NOT_FOUND);
+
+	do
+	{
+		if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			if ((fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) ||
+					!wcscmp(fd.cFileName, L".") || !wcscmp(fd.cFileName, L".."))
+				continue;
+
+			// Unreadable sub-folders are simply skipped
+			listSubFolderFiles(dir, subDir + fd.cFileName + L"\\", files);
+		}
+		else
+		{
+			files.emplace_back(subDir + fd.cFileName,
+					(static_cast<uint64_t>(fd.nFileSizeHigh) << 32) | fd.nFileSizeLow);
+		}
+	}
+	while (::FindNextFile(hFind, &fd));
+
+	::FindClose(hFind);
+
+	return true;
+}
+
+} // anonymous namespace
+
+
+bool listFolderFiles(const std::wstring& dir, std::vector<folder_file>& files)
+{
+	return listSubFolderFiles(dir, std::wstring(), files);
+}
+
+
+bool getFileHash(const std::wstring& file, uint64_t& hash)
+{
+	HANDLE hFile = ::CreateFile(file.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+			FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	std::vector<char> buf(cFileHashBufSize);
+
+	bool ok = true;
+
+	hash = cFileHashSeed;
+
+	for (;;)
+	{
+		DWORD read = 0;
+
+		if (!::ReadFile(hFile, buf.data(), cFileHashBufSize, &read, NULL))
+		{
+			ok = false;
+			break;
+		}
+
+		if (read == 0)
+			break;
+
+		hash = hashBlock(buf.data(), read, hash);
+	}
+
+	::CloseHandle(hFile);
+
+	return ok;
+}
@@ -0,0 +1,32 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "folder_compare.h"
+
+
+// Lists folder files recursively (dir must end with a backslash) - folder links are not followed to avoid loops
+bool listFolderFiles(const std::wstring& dir, std::vector<folder_file>& files);
+
+// Whole file content hash - the file is read in blocks, each block hash seeds the next one
+bool getFileHash(const std::wstring& file, uint64_t& hash);
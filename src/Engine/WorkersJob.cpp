@@ -0,0 +1,185 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <windows.h>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+
+#include "WorkersJob.h"
+#include "CompareTrace.h"
+
+
+namespace {
+
+// As many workers as there are CPUs but no more than that
+const unsigned	cWorkersMaxCount			= 8;
+const DWORD		cWorkersProgressPeriod_ms	= 100;
+
+} // anonymous namespace
+
+
+WorkersJob::WorkersJob(int tasksCount, uint64_t maxLoad) : _tasksCount(tasksCount), _maxLoad(maxLoad)
+{
+	if (!_maxLoad)
+		return;
+
+	_loadFreed = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+
+	if (!_loadFreed)
+		throw std::runtime_error("Failed to create workers job event");
+
+	::InitializeCriticalSection(&_loadLock);
+}
+
+
+WorkersJob::~WorkersJob()
+{
+	if (!_maxLoad)
+		return;
+
+	::CloseHandle(_loadFreed);
+	::DeleteCriticalSection(&_loadLock);
+}
+
+
+bool WorkersJob::run(ProgressDlg* progress)
+{
+	if (_tasksCount == 0)
+		return true;
+
+	SYSTEM_INFO si;
+	::GetSystemInfo(&si);
+
+	const unsigned workersCount = std::min(std::min<unsigned>(si.dwNumberOfProcessors, cWorkersMaxCount),
+			static_cast<unsigned>(_tasksCount));
+
+	std::vector<HANDLE> workers;
+
+	for (unsigned i = 0; i < workersCount; ++i)
+	{
+		HANDLE hWorker = ::CreateThread(NULL, 0, workerFunc, this, 0, NULL);
+
+		if (hWorker)
+			workers.emplace_back(hWorker);
+	}
+
+	// No worker threads - run the tasks sequentially without cancel monitoring
+	if (workers.empty())
+	{
+		work();
+		onRunWait();
+
+		return true;
+	}
+
+	if (progress)
+		progress->SetMaxCount(static_cast<unsigned>(_tasksCount));
+
+	DWORD waitRes;
+
+	while ((waitRes = ::WaitForMultipleObjects(static_cast<DWORD>(workers.size()), workers.data(), TRUE,
+			cWorkersProgressPeriod_ms)) == WAIT_TIMEOUT)
+	{
+		if (progress && !progress->SetCount(static_cast<unsigned>(_doneTasks)))
+			::InterlockedExchange(&_cancelled, 1);
+
+		onRunWait();
+	}
+
+	// Workers must never outlive the job
+	if (waitRes == WAIT_FAILED)
+	{
+		for (HANDLE hWorker: workers)
+			::WaitForSingleObject(hWorker, INFINITE);
+	}
+
+	for (HANDLE hWorker: workers)
+		::CloseHandle(hWorker);
+
+	onRunWait();
+
+	return !isCancelled();
+}
+
+
+DWORD WINAPI WorkersJob::workerFunc(LPVOID data)
+{
+	static_cast<WorkersJob*>(data)->work();
+
+	return 0;
+}
+
+
+void WorkersJob::work()
+{
+	for (LONG task = ::InterlockedIncrement(&_nextTask) - 1; task < _tasksCount && !isCancelled();
+			task = ::InterlockedIncrement(&_nextTask) - 1)
+	{
+		TRACE_SPAN_ARG("workerTask", static_cast<int>(task));
+
+		const uint64_t load = _maxLoad ? taskLoad(static_cast<int>(task)) : 0;
+
+		if (_maxLoad)
+			acquireLoad(load);
+
+		if (!isCancelled())
+			runTask(static_cast<int>(task));
+
+		if (_maxLoad)
+			releaseLoad(load);
+
+		::InterlockedIncrement(&_doneTasks);
+	}
+}
+
+
+void WorkersJob::acquireLoad(uint64_t load)
+{
+	for (;;)
+	{
+		::EnterCriticalSection(&_loadLock);
+
+		// A task is always run if no other one is, whatever its load
+		if (_load == 0 || _load + load <= _maxLoad || isCancelled())
+		{
+			_load += load;
+			::LeaveCriticalSection(&_loadLock);
+
+			return;
+		}
+
+		::ResetEvent(_loadFreed);
+		::LeaveCriticalSection(&_loadLock);
+
+		::WaitForSingleObject(_loadFreed, INFINITE);
+	}
+}
+
+
+void WorkersJob::releaseLoad(uint64_t load)
+{
+	::EnterCriticalSection(&_loadLock);
+
+	_load -= load;
+	::SetEvent(_loadFreed);
+
+	::LeaveCriticalSection(&_loadLock);
+}
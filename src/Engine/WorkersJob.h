@@ -0,0 +1,81 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <windows.h>
+#include <cstdint>
+
+#include "ProgressDlg.h"
+
+
+/**
+ *  \class  WorkersJob
+ *  \brief  Runs the job tasks on a pool of worker threads - as many as there are CPUs but at most cWorkersMaxCount.
+ *          Each worker takes the next task in turn. Tasks must not use the progress dialog, the debug log or
+ *          Notepad++ messages. If a max load is given, each worker waits before running its task while the tasks
+ *          already run by the others load too much all together (a single bigger task is still run alone).
+ */
+class WorkersJob
+{
+public:
+	explicit WorkersJob(int tasksCount, uint64_t maxLoad = 0);
+	virtual ~WorkersJob();
+
+	// Runs all tasks and waits for them - returns false if cancelled
+	bool run(ProgressDlg* progress);
+
+	WorkersJob(const WorkersJob&) = delete;
+	const WorkersJob& operator=(const WorkersJob&) = delete;
+
+protected:
+	virtual void runTask(int task) = 0;
+
+	// Task load (like its memory use) - used only if the job has a max load
+	virtual uint64_t taskLoad(int) const
+	{
+		return 0;
+	}
+
+	// Called on the thread that runs the job - periodically while the tasks run and once more after they all end
+	virtual void onRunWait() {}
+
+	inline bool isCancelled() const
+	{
+		return (_cancelled != 0);
+	}
+
+private:
+	static DWORD WINAPI workerFunc(LPVOID data);
+
+	void work();
+
+	void acquireLoad(uint64_t load);
+	void releaseLoad(uint64_t load);
+
+	const int		_tasksCount;
+	const uint64_t	_maxLoad;
+
+	volatile LONG	_nextTask	{0};
+	volatile LONG	_doneTasks	{0};
+	volatile LONG	_cancelled	{0};
+
+	CRITICAL_SECTION	_loadLock;
+	HANDLE				_loadFreed	{NULL};
+	uint64_t			_load		{0};
+};
@@ -0,0 +1,469 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Diff of sequences (of lines or words) pre-aligned on equal ranges found through content-defined chunks - the equal
+ * ranges are matched up front and only the differing windows in between are actually diffed.
+ *
+ * Has no platform dependencies. Sequences are std::vector or seq_view (elements in memory not owned, like mapped
+ * file arrays) of elements that have a hash member and are equal if their hashes are. The debug build counts the
+ * diffs work through ANCHORED_DIFF_DIAGONALS defined before this header is included.
+ */
+
+#pragma once
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <utility>
+#include <algorithm>
+
+#include "diff.h"
+
+
+#ifndef ANCHORED_DIFF_DIAGONALS
+	#define ANCHORED_DIFF_DIAGONALS(COUNT)
+#endif
+
+
+// Read-only sequence of elements owned elsewhere
+template <typename Elem>
+struct seq_view
+{
+	typedef Elem value_type;
+
+	seq_view(const Elem* elems, size_t count) : _elems(elems), _count(count) {}
+
+	inline const Elem* data() const
+	{
+		return _elems;
+	}
+
+	inline size_t size() const
+	{
+		return _count;
+	}
+
+	inline const Elem* begin() const
+	{
+		return _elems;
+	}
+
+	inline const Elem* end() const
+	{
+		return _elems + _count;
+	}
+
+	inline const Elem& operator[](size_t i) const
+	{
+		return _elems[i];
+	}
+
+private:
+	const Elem*	_elems;
+	size_t		_count;
+};
+
+
+// Range of elements (lines or words) known to be equal in both sequences before the actual diff is run
+struct seq_anchor
+{
+	seq_anchor(int o1, int o2, int l) : off1(o1), off2(o2), len(l) {}
+
+	int off1;
+	int off2;
+	int len;
+};
+
+
+// Content-defined chunking used to pre-align huge documents and huge lines - a chunk boundary is placed where
+// the rolling hash of the last 64 elements has its top chunk_boundary_bits bits clear (chunks are 1024 elements
+// on average)
+const int		chunk_boundary_bits	= 10;
+const int		chunk_min_len		= 64;
+const int		chunk_max_len		= 8192;
+const uint64_t	chunk_hash_base		= 0x100000001B3ULL;
+
+
+struct seq_chunk
+{
+	int			off;
+	int			len;
+	uint64_t	hash;
+};
+
+
+// Split sequence (of lines or words) into content-defined chunks - equal regions in both sequences are split the
+// same way regardless of their position in the sequences
+template <typename Seq>
+std::vector<seq_chunk> get_chunks(const Seq& seq)
+{
+	std::vector<seq_chunk> chunks;
+
+	const int seqLen = static_cast<int>(seq.size());
+
+	uint64_t rollingHash = 0;
+
+	seq_chunk chunk;
+	chunk.off	= 0;
+	chunk.len	= 0;
+	chunk.hash	= 0;
+
+	for (int i = 0; i < seqLen; ++i)
+	{
+		// Mix the element hash (splitmix64 finalizer) to get evenly distributed bits
+		uint64_t elemHash = seq[i].hash;
+
+		elemHash = (elemHash ^ (elemHash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		elemHash = (elemHash ^ (elemHash >> 27)) * 0x94D049BB133111EBULL;
+		elemHash ^= elemHash >> 31;
+
+		// Each element hash shifts out of the rolling hash after 64 elements
+		rollingHash = (rollingHash << 1) + elemHash;
+
+		chunk.hash = chunk.hash * chunk_hash_base + seq[i].hash;
+		++chunk.len;
+
+		if ((chunk.len >= chunk_min_len && (rollingHash >> (64 - chunk_boundary_bits)) == 0) ||
+				chunk.len == chunk_max_len || i == seqLen - 1)
+		{
+			chunks.emplace_back(chunk);
+
+			chunk.off	= i + 1;
+			chunk.len	= 0;
+			chunk.hash	= 0;
+		}
+	}
+
+	return chunks;
+}
+
+
+// Chunks hash to chunk index (-1 if the chunk is not unique)
+inline std::unordered_map<uint64_t, int> get_unique_chunks(const std::vector<seq_chunk>& chunks)
+{
+	std::unordered_map<uint64_t, int> uniqueChunks;
+
+	const int chunksCount = static_cast<int>(chunks.size());
+
+	for (int i = 0; i < chunksCount; ++i)
+	{
+		auto insertPair = uniqueChunks.emplace(chunks[i].hash, i);
+		if (!insertPair.second)
+			insertPair.first->second = -1;
+	}
+
+	return uniqueChunks;
+}
+
+
+// Sequence chunks and their unique chunks index - built once for a sequence that is anchored to many others
+struct seq_chunks_index
+{
+	std::vector<seq_chunk>				chunks;
+	std::unordered_map<uint64_t, int>	uniqueChunks;
+};
+
+
+template <typename Seq>
+seq_chunks_index get_chunks_index(const Seq& seq)
+{
+	seq_chunks_index index;
+
+	index.chunks		= get_chunks(seq);
+	index.uniqueChunks	= get_unique_chunks(index.chunks);
+
+	return index;
+}
+
+
+// Find the ranges of elements that are the same in both sequences - content-defined chunks unique in both
+// sequences are matched by hash, the longest (by elements count) ordered chain of those is taken by weighted LIS
+// and then each chain anchor is extended to the whole surrounding equal range
+template <typename Seq>
+std::vector<seq_anchor> find_anchors(const Seq& seq1, const seq_chunks_index& index1, const Seq& seq2)
+{
+	std::vector<seq_anchor> anchors;
+
+	const seq_chunks_index index2 = get_chunks_index(seq2);
+
+	const std::vector<seq_chunk>& chunks1 = index1.chunks;
+	const std::vector<seq_chunk>& chunks2 = index2.chunks;
+
+	const std::unordered_map<uint64_t, int>& uniqueChunks1 = index1.uniqueChunks;
+	const std::unordered_map<uint64_t, int>& uniqueChunks2 = index2.uniqueChunks;
+
+	// Candidate anchors in seq1 order
+	std::vector<seq_anchor> candidates;
+
+	for (const auto& chunk1: chunks1)
+	{
+		auto uc1 = uniqueChunks1.find(chunk1.hash);
+		auto uc2 = uniqueChunks2.find(chunk1.hash);
+
+		if (uc1->second < 0 || uc2 == uniqueChunks2.end() || uc2->second < 0)
+			continue;
+
+		const seq_chunk& chunk2 = chunks2[uc2->second];
+
+		if (chunk1.len != chunk2.len ||
+				!std::equal(seq1.begin() + chunk1.off, seq1.begin() + chunk1.off + chunk1.len,
+						seq2.begin() + chunk2.off))
+			continue;
+
+		candidates.emplace_back(chunk1.off, chunk2.off, chunk1.len);
+	}
+
+	const int candidatesCount = static_cast<int>(candidates.size());
+
+	if (candidatesCount == 0)
+		return anchors;
+
+	// Weighted LIS on seq2 offsets - Fenwick tree of the best chain (elements count, last candidate) by seq2 order
+	std::vector<int> order2(candidatesCount);
+
+	for (int i = 0; i < candidatesCount; ++i)
+		order2[i] = i;
+
+	std::sort(order2.begin(), order2.end(),
+			[&candidates](int lhs, int rhs) { return candidates[lhs].off2 < candidates[rhs].off2; });
+
+	std::vector<int> rank2(candidatesCount);
+
+	for (int i = 0; i < candidatesCount; ++i)
+		rank2[order2[i]] = i + 1;
+
+	std::vector<std::pair<int64_t, int>> bestChain(candidatesCount + 1, std::make_pair(0, -1));
+	std::vector<int> prevInChain(candidatesCount);
+
+	std::pair<int64_t, int> chainEnd(0, -1);
+
+	for (int i = 0; i < candidatesCount; ++i)
+	{
+		std::pair<int64_t, int> best(0, -1);
+
+		for (int r = rank2[i] - 1; r > 0; r -= (r & -r))
+		{
+			if (best.first < bestChain[r].first)
+				best = bestChain[r];
+		}
+
+		prevInChain[i] = best.second;
+
+		const std::pair<int64_t, int> chain(best.first + candidates[i].len, i);
+
+		for (int r = rank2[i]; r <= candidatesCount; r += (r & -r))
+		{
+			if (bestChain[r].first < chain.first)
+				bestChain[r] = chain;
+		}
+
+		if (chainEnd.first < chain.first)
+			chainEnd = chain;
+	}
+
+	for (int i = chainEnd.second; i >= 0; i = prevInChain[i])
+		anchors.emplace_back(candidates[i]);
+
+	std::reverse(anchors.begin(), anchors.end());
+
+	const int anchorsCount = static_cast<int>(anchors.size());
+
+	const int seqLen1 = static_cast<int>(seq1.size());
+	const int seqLen2 = static_cast<int>(seq2.size());
+
+	int end1 = 0;
+	int end2 = 0;
+
+	for (int i = 0; i < anchorsCount; ++i)
+	{
+		seq_anchor& anchor = anchors[i];
+
+		const int limit1 = (i + 1 < anchorsCount) ? anchors[i + 1].off1 : seqLen1;
+		const int limit2 = (i + 1 < anchorsCount) ? anchors[i + 1].off2 : seqLen2;
+
+		for (; anchor.off1 > end1 && anchor.off2 > end2 && seq1[anchor.off1 - 1] == seq2[anchor.off2 - 1];
+				--anchor.off1, --anchor.off2, ++anchor.len);
+
+		for (; anchor.off1 + anchor.len < limit1 && anchor.off2 + anchor.len < limit2 &&
+				seq1[anchor.off1 + anchor.len] == seq2[anchor.off2 + anchor.len]; ++anchor.len);
+
+		end1 = anchor.off1 + anchor.len;
+		end2 = anchor.off2 + anchor.len;
+	}
+
+	return anchors;
+}
+
+
+template <typename Seq>
+inline std::vector<seq_anchor> find_anchors(const Seq& seq1, const Seq& seq2)
+{
+	return find_anchors(seq1, get_chunks_index(seq1), seq2);
+}
+
+
+// Append diff to the diffs keeping DIFF_IN_1 before DIFF_IN_2 in changed blocks
+template <typename UserDataT>
+void add_diff(std::vector<diff_info<UserDataT>>& diffs, diff_type type, int off, int len)
+{
+	if (len == 0)
+		return;
+
+	const int diffsSize = static_cast<int>(diffs.size());
+
+	if (diffsSize && diffs.back().type == type)
+	{
+		diffs.back().len += len;
+		return;
+	}
+
+	diff_info<UserDataT> newDiff;
+
+	newDiff.type	= type;
+	newDiff.off		= off;
+	newDiff.len		= len;
+
+	if (type == diff_type::DIFF_IN_1 && diffsSize && diffs.back().type == diff_type::DIFF_IN_2)
+	{
+		if (diffsSize > 1 && diffs[diffsSize - 2].type == diff_type::DIFF_IN_1)
+			diffs[diffsSize - 2].len += len;
+		else
+			diffs.insert(diffs.end() - 1, newDiff);
+	}
+	else
+	{
+		diffs.emplace_back(newDiff);
+	}
+}
+
+
+// Diff window between anchors and append the results to the diffs. If the window edit cost exceeds maxCost its
+// diff is incomplete - the window is then appended as changed as a whole. Nothing is appended if cancelled.
+template <typename Seq, typename UserDataT>
+void diff_window(const Seq& seq1, int off1, int len1, const Seq& seq2, int off2, int len2,
+		std::vector<diff_info<UserDataT>>& diffs, int maxCost = INT_MAX,
+		const std::function<bool()>& isCancelled = nullptr)
+{
+	if (len1 == 0 || len2 == 0)
+	{
+		add_diff(diffs, diff_type::DIFF_IN_1, off1, len1);
+		add_diff(diffs, diff_type::DIFF_IN_2, off2, len2);
+		return;
+	}
+
+	DiffCalc<typename Seq::value_type> diffCalc(seq1.data() + off1, len1, seq2.data() + off2, len2, maxCost);
+
+	if (isCancelled)
+		diffCalc.setCancelCheck(isCancelled);
+
+	const auto diffRes = diffCalc();
+
+	ANCHORED_DIFF_DIAGONALS(diffCalc.diagonals());
+
+	if (diffCalc.cancelled())
+		return;
+
+	if (diffCalc.capped())
+	{
+		add_diff(diffs, diff_type::DIFF_IN_1, off1, len1);
+		add_diff(diffs, diff_type::DIFF_IN_2, off2, len2);
+		return;
+	}
+
+	// Window diffs might be swapped - orient them to seq1 / seq2
+	for (const auto& diff: diffRes.first)
+	{
+		if (diff.type == diff_type::DIFF_MATCH)
+		{
+			add_diff(diffs, diff_type::DIFF_MATCH, off1, diff.len);
+			off1 += diff.len;
+			off2 += diff.len;
+		}
+		else if ((diff.type == diff_type::DIFF_IN_1) != diffRes.second)
+		{
+			add_diff(diffs, diff_type::DIFF_IN_1, off1, diff.len);
+			off1 += diff.len;
+		}
+		else
+		{
+			add_diff(diffs, diff_type::DIFF_IN_2, off2, diff.len);
+			off2 += diff.len;
+		}
+	}
+}
+
+
+// Diff sequences aligned on the given anchors - only the windows in between are actually diffed
+template <typename Seq, typename UserDataT>
+void diff_anchored(const Seq& seq1, const Seq& seq2, const std::vector<seq_anchor>& anchors,
+		std::vector<diff_info<UserDataT>>& diffs, int windowMaxCost = INT_MAX,
+		const std::function<bool()>& isCancelled = nullptr)
+{
+	int off1 = 0;
+	int off2 = 0;
+
+	for (const auto& anchor: anchors)
+	{
+		if (isCancelled && isCancelled())
+			return;
+
+		diff_window(seq1, off1, anchor.off1 - off1, seq2, off2, anchor.off2 - off2, diffs, windowMaxCost,
+				isCancelled);
+		add_diff(diffs, diff_type::DIFF_MATCH, anchor.off1, anchor.len);
+
+		off1 = anchor.off1 + anchor.len;
+		off2 = anchor.off2 + anchor.len;
+	}
+
+	diff_window(seq1, off1, static_cast<int>(seq1.size()) - off1, seq2, off2, static_cast<int>(seq2.size()) - off2,
+			diffs, windowMaxCost, isCancelled);
+}
+
+
+// Diff sequences pre-aligned on the given anchors - diffed as a whole if there are none. Each diffed window of edit
+// cost over maxCost is marked changed as a whole. The diff is stopped as soon as isCancelled returns true - its
+// result is then incomplete and should be dropped.
+template <typename UserDataT, typename Seq>
+std::pair<std::vector<diff_info<UserDataT>>, bool> diff_pre_aligned(const Seq& seq1, const Seq& seq2,
+		const std::vector<seq_anchor>& anchors, int maxCost = INT_MAX,
+		const std::function<bool()>& isCancelled = nullptr)
+{
+	if (anchors.empty() && maxCost == INT_MAX)
+	{
+		DiffCalc<typename Seq::value_type, UserDataT> diffCalc(seq1.data(), static_cast<int>(seq1.size()),
+				seq2.data(), static_cast<int>(seq2.size()));
+
+		if (isCancelled)
+			diffCalc.setCancelCheck(isCancelled);
+
+		auto diffRes = diffCalc();
+
+		ANCHORED_DIFF_DIAGONALS(diffCalc.diagonals());
+
+		return diffRes;
+	}
+
+	std::vector<diff_info<UserDataT>> diffs;
+
+	diff_anchored(seq1, seq2, anchors, diffs, maxCost, isCancelled);
+
+	return std::make_pair(std::move(diffs), false);
+}
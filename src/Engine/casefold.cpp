@@ -0,0 +1,373 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <iterator>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CASEFOLD_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "casefold.h"
+
+
+namespace {
+
+/**
+ *  \struct fold_run
+ *  \brief  count code points starting at first and stride apart that all fold by adding delta
+ *          (stride 2 covers the alternating upper / lower case pairs blocks)
+ */
+struct fold_run
+{
+	uint32_t	first;
+	uint16_t	count;
+	uint8_t		stride;
+	int32_t		delta;
+};
+
+
+// Generated from the Unicode 14.0 simple case foldings - non-ASCII ones keeping the UTF-8 length
+const fold_run fold_runs[] =
+{
+	{0x000B5,   1, 1,    775},
+	{0x000C0,  23, 1,     32},
+	{0x000D8,   7, 1,     32},
+	{0x00100,  24, 2,      1},
+	{0x00132,   3, 2,      1},
+	{0x00139,   8, 2,      1},
+	{0x0014A,  23, 2,      1},
+	{0x00178,   1, 1,   -121},
+	{0x00179,   3, 2,      1},
+	{0x00181,   1, 1,    210},
+	{0x00182,   2, 2,      1},
+	{0x00186,   1, 1,    206},
+	{0x00187,   1, 1,      1},
+	{0x00189,   2, 1,    205},
+	{0x0018B,   1, 1,      1},
+	{0x0018E,   1, 1,     79},
+	{0x0018F,   1, 1,    202},
+	{0x00190,   1, 1,    203},
+	{0x00191,   1, 1,      1},
+	{0x00193,   1, 1,    205},
+	{0x00194,   1, 1,    207},
+	{0x00196,   1, 1,    211},
+	{0x00197,   1, 1,    209},
+	{0x00198,   1, 1,      1},
+	{0x0019C,   1, 1,    211},
+	{0x0019D,   1, 1,    213},
+	{0x0019F,   1, 1,    214},
+	{0x001A0,   3, 2,      1},
+	{0x001A6,   1, 1,    218},
+	{0x001A7,   1, 1,      1},
+	{0x001A9,   1, 1,    218},
+	{0x001AC,   1, 1,      1},
+	{0x001AE,   1, 1,    218},
+	{0x001AF,   1, 1,      1},
+	{0x001B1,   2, 1,    217},
+	{0x001B3,   2, 2,      1},
+	{0x001B7,   1, 1,    219},
+	{0x001B8,   1, 1,      1},
+	{0x001BC,   1, 1,      1},
+	{0x001C4,   1, 1,      2},
+	{0x001C5,   1, 1,      1},
+	{0x001C7,   1, 1,      2},
+	{0x001C8,   1, 1,      1},
+	{0x001CA,   1, 1,      2},
+	{0x001CB,   9, 2,      1},
+	{0x001DE,   9, 2,      1},
+	{0x001F1,   1, 1,      2},
+	{0x001F2,   2, 2,      1},
+	{0x001F6,   1, 1,    -97},
+	{0x001F7,   1, 1,    -56},
+	{0x001F8,  20, 2,      1},
+	{0x00220,   1, 1,   -130},
+	{0x00222,   9, 2,      1},
+	{0x0023B,   1, 1,      1},
+	{0x0023D,   1, 1,   -163},
+	{0x00241,   1, 1,      1},
+	{0x00243,   1, 1,   -195},
+	{0x00244,   1, 1,     69},
+	{0x00245,   1, 1,     71},
+	{0x00246,   5, 2,      1},
+	{0x00345,   1, 1,    116},
+	{0x00370,   2, 2,      1},
+	{0x00376,   1, 1,      1},
+	{0x0037F,   1, 1,    116},
+	{0x00386,   1, 1,     38},
+	{0x00388,   3, 1,     37},
+	{0x0038C,   1, 1,     64},
+	{0x0038E,   2, 1,     63},
+	{0x00391,  17, 1,     32},
+	{0x003A3,   9, 1,     32},
+	{0x003C2,   1, 1,      1},
+	{0x003CF,   1, 1,      8},
+	{0x003D0,   1, 1,    -30},
+	{0x003D1,   1, 1,    -25},
+	{0x003D5,   1, 1,    -15},
+	{0x003D6,   1, 1,    -22},
+	{0x003D8,  12, 2,      1},
+	{0x003F0,   1, 1,    -54},
+	{0x003F1,   1, 1,    -48},
+	{0x003F4,   1, 1,    -60},
+	{0x003F5,   1, 1,    -64},
+	{0x003F7,   1, 1,      1},
+	{0x003F9,   1, 1,     -7},
+	{0x003FA,   1, 1,      1},
+	{0x003FD,   3, 1,   -130},
+	{0x00400,  16, 1,     80},
+	{0x00410,  32, 1,     32},
+	{0x00460,  17, 2,      1},
+	{0x0048A,  27, 2,      1},
+	{0x004C0,   1, 1,     15},
+	{0x004C1,   7, 2,      1},
+	{0x004D0,  48, 2,      1},
+	{0x00531,  38, 1,     48},
+	{0x010A0,  38, 1,   7264},
+	{0x010C7,   1, 1,   7264},
+	{0x010CD,   1, 1,   7264},
+	{0x013F8,   6, 1,     -8},
+	{0x01C88,   1, 1,  35267},
+	{0x01C90,  43, 1,  -3008},
+	{0x01CBD,   3, 1,  -3008},
+	{0x01E00,  75, 2,      1},
+	{0x01E9B,   1, 1,    -58},
+	{0x01EA0,  48, 2,      1},
+	{0x01F08,   8, 1,     -8},
+	{0x01F18,   6, 1,     -8},
+	{0x01F28,   8, 1,     -8},
+	{0x01F38,   8, 1,     -8},
+	{0x01F48,   6, 1,     -8},
+	{0x01F59,   4, 2,     -8},
+	{0x01F68,   8, 1,     -8},
+	{0x01F88,   8, 1,     -8},
+	{0x01F98,   8, 1,     -8},
+	{0x01FA8,   8, 1,     -8},
+	{0x01FB8,   2, 1,     -8},
+	{0x01FBA,   2, 1,    -74},
+	{0x01FBC,   1, 1,     -9},
+	{0x01FC8,   4, 1,    -86},
+	{0x01FCC,   1, 1,     -9},
+	{0x01FD8,   2, 1,     -8},
+	{0x01FDA,   2, 1,   -100},
+	{0x01FE8,   2, 1,     -8},
+	{0x01FEA,   2, 1,   -112},
+	{0x01FEC,   1, 1,     -7},
+	{0x01FF8,   2, 1,   -128},
+	{0x01FFA,   2, 1,   -126},
+	{0x01FFC,   1, 1,     -9},
+	{0x02132,   1, 1,     28},
+	{0x02160,  16, 1,     16},
+	{0x02183,   1, 1,      1},
+	{0x024B6,  26, 1,     26},
+	{0x02C00,  48, 1,     48},
+	{0x02C60,   1, 1,      1},
+	{0x02C63,   1, 1,  -3814},
+	{0x02C67,   3, 2,      1},
+	{0x02C72,   1, 1,      1},
+	{0x02C75,   1, 1,      1},
+	{0x02C80,  50, 2,      1},
+	{0x02CEB,   2, 2,      1},
+	{0x02CF2,   1, 1,      1},
+	{0x0A640,  23, 2,      1},
+	{0x0A680,  14, 2,      1},
+	{0x0A722,   7, 2,      1},
+	{0x0A732,  31, 2,      1},
+	{0x0A779,   2, 2,      1},
+	{0x0A77D,   1, 1, -35332},
+	{0x0A77E,   5, 2,      1},
+	{0x0A78B,   1, 1,      1},
+	{0x0A790,   2, 2,      1},
+	{0x0A796,  10, 2,      1},
+	{0x0A7B3,   1, 1,    928},
+	{0x0A7B4,   8, 2,      1},
+	{0x0A7C4,   1, 1,    -48},
+	{0x0A7C6,   1, 1, -35384},
+	{0x0A7C7,   2, 2,      1},
+	{0x0A7D0,   1, 1,      1},
+	{0x0A7D6,   2, 2,      1},
+	{0x0A7F5,   1, 1,      1},
+	{0x0AB70,  80, 1, -38864},
+	{0x0FF21,  26, 1,     32},
+	{0x10400,  40, 1,     40},
+	{0x104B0,  36, 1,     40},
+	{0x10570,  11, 1,     39},
+	{0x1057C,  15, 1,     39},
+	{0x1058C,   7, 1,     39},
+	{0x10594,   2, 1,     39},
+	{0x10C80,  51, 1,     64},
+	{0x118A0,  32, 1,     32},
+	{0x16E40,  32, 1,     32},
+	{0x1E900,  34, 1,     34},
+};
+
+
+inline int utf8_length(uint32_t cp)
+{
+	return (cp < 0x80) ? 1 : (cp < 0x800) ? 2 : (cp < 0x10000) ? 3 : 4;
+}
+
+
+inline bool is_continuation(char ch)
+{
+	return ((static_cast<unsigned char>(ch) & 0xC0) == 0x80);
+}
+
+} // anonymous namespace
+
+
+uint32_t fold_code_point(uint32_t cp)
+{
+	if (cp < 0x80)
+		return static_cast<uint32_t>(fold_ascii(static_cast<char>(cp)));
+
+	// Last run starting at or before cp
+	const fold_run* run = std::upper_bound(std::begin(fold_runs), std::end(fold_runs), cp,
+			[](uint32_t c, const fold_run& r) { return (c < r.first); });
+
+	if (run == std::begin(fold_runs))
+		return cp;
+
+	--run;
+
+	const uint32_t off = cp - run->first;
+
+	if (off % run->stride || off / run->stride >= run->count)
+		return cp;
+
+	return static_cast<uint32_t>(static_cast<int32_t>(cp) + run->delta);
+}
+
+
+int fold_utf8_char(const char* src, size_t len, char* dst)
+{
+	const unsigned char lead = static_cast<unsigned char>(src[0]);
+
+	int n = 1;
+	uint32_t cp = lead;
+
+	if (lead >= 0xC2 && lead < 0xE0)
+	{
+		n = 2;
+		cp = lead & 0x1F;
+	}
+	else if (lead >= 0xE0 && lead < 0xF0)
+	{
+		n = 3;
+		cp = lead & 0x0F;
+	}
+	else if (lead >= 0xF0 && lead < 0xF5)
+	{
+		n = 4;
+		cp = lead & 0x07;
+	}
+
+	if (n == 1 || static_cast<size_t>(n) > len)
+	{
+		dst[0] = (lead < 0x80) ? fold_ascii(src[0]) : src[0];
+		return 1;
+	}
+
+	for (int i = 1; i < n; ++i)
+	{
+		if (!is_continuation(src[i]))
+		{
+			dst[0] = src[0];
+			return 1;
+		}
+
+		cp = (cp << 6) | (static_cast<unsigned char>(src[i]) & 0x3F);
+	}
+
+	const uint32_t folded = fold_code_point(cp);
+
+	// Overlong sequences and foldings changing the length (none in the table) are left as they are
+	if (folded == cp || utf8_length(cp) != n || utf8_length(folded) != n)
+	{
+		std::copy(src, src + n, dst);
+		return n;
+	}
+
+	if (n == 2)
+	{
+		dst[0] = static_cast<char>(0xC0 | (folded >> 6));
+		dst[1] = static_cast<char>(0x80 | (folded & 0x3F));
+	}
+	else if (n == 3)
+	{
+		dst[0] = static_cast<char>(0xE0 | (folded >> 12));
+		dst[1] = static_cast<char>(0x80 | ((folded >> 6) & 0x3F));
+		dst[2] = static_cast<char>(0x80 | (folded & 0x3F));
+	}
+	else
+	{
+		dst[0] = static_cast<char>(0xF0 | (folded >> 18));
+		dst[1] = static_cast<char>(0x80 | ((folded >> 12) & 0x3F));
+		dst[2] = static_cast<char>(0x80 | ((folded >> 6) & 0x3F));
+		dst[3] = static_cast<char>(0x80 | (folded & 0x3F));
+	}
+
+	return n;
+}
+
+
+void fold_case_utf8(char* text, size_t len)
+{
+	size_t i = 0;
+
+	while (i < len)
+	{
+#ifdef CASEFOLD_USE_SSE2
+		if (len - i >= 16)
+		{
+			const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+
+			if (_mm_movemask_epi8(chunk) == 0)
+			{
+				// Pure ASCII chunk - bytes are non-negative so the signed compares select 'A' - 'Z'
+				const __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('A' - 1)),
+						_mm_cmplt_epi8(chunk, _mm_set1_epi8('Z' + 1)));
+
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(text + i),
+						_mm_add_epi8(chunk, _mm_and_si128(upper, _mm_set1_epi8('a' - 'A'))));
+
+				i += 16;
+				continue;
+			}
+		}
+#endif
+
+		if (!(text[i] & 0x80))
+		{
+			text[i] = fold_ascii(text[i]);
+			++i;
+		}
+		else
+		{
+			// Folded character has the same length so it can be written in place
+			char folded[4];
+			const int n = fold_utf8_char(text + i, len - i, folded);
+
+			std::copy(folded, folded + n, text + i);
+			i += n;
+		}
+	}
+}
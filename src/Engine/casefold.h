@@ -0,0 +1,49 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Unicode simple case folding of UTF-8 text.
+ *
+ * Has no platform dependencies. Folding never changes the UTF-8 length of a character (the few foldings that would,
+ * like KELVIN SIGN to 'k', are left out) so folded text keeps the byte offsets of the original one.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+
+inline char fold_ascii(char ch)
+{
+	return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch + ('a' - 'A')) : ch;
+}
+
+
+// Returns the simple case folding of a Unicode code point (the code point itself if it has none)
+uint32_t fold_code_point(uint32_t cp);
+
+
+/**
+ *  \brief  Case folds the UTF-8 character at src (of at most len bytes) to dst and returns its length in bytes.
+ *          Invalid UTF-8 sequences are copied as single bytes. dst must have room for 4 bytes.
+ */
+int fold_utf8_char(const char* src, size_t len, char* dst);
+
+
+// Case folds UTF-8 text in place - ASCII runs are folded 16 bytes at a time where SSE2 is available
+void fold_case_utf8(char* text, size_t len);
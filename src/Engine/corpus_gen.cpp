@@ -0,0 +1,412 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef DLOG
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "corpus_gen.h"
+
+
+// Fields order: name, seed, pattern, lines, min / max line length, edits density, moved blocks count and length,
+// reordered sections, whitespace-only and case-only changes density
+const corpus_spec corpus_specs[] =
+{
+	{ "small_code",		1001, corpus_pattern::TEXT,				2000,	0, 80,		20,		2, 20,		1,	5, 5 },
+	{ "large_code",		1002, corpus_pattern::TEXT,				200000,	0, 120,		5,		10, 50,		4,	2, 2 },
+	{ "dense_edits",	1003, corpus_pattern::TEXT,				20000,	0, 80,		300,	0, 0,		0,	0, 0 },
+	{ "many_moves",		1004, corpus_pattern::TEXT,				50000,	0, 80,		2,		200, 10,	0,	0, 0 },
+	{ "reordered",		1005, corpus_pattern::TEXT,				20000,	0, 80,		2,		0, 0,		40,	0, 0 },
+	{ "ws_and_case",	1006, corpus_pattern::TEXT,				20000,	0, 80,		0,		0, 0,		0,	100, 100 },
+	{ "long_lines",		1007, corpus_pattern::TEXT,				2000,	500, 5000,	50,		2, 10,		0,	10, 10 },
+	{ "repeated_lines",	1008, corpus_pattern::REPEATED_LINES,	50000,	0, 40,		20,		0, 0,		0,	0, 0 },
+	{ "all_different",	1009, corpus_pattern::ALL_DIFFERENT,	20000,	0, 80,		0,		0, 0,		0,	0, 0 },
+	{ "giant_line",		1010, corpus_pattern::GIANT_LINE,		20000,	0, 80,		10,		0, 0,		0,	0, 0 }
+};
+
+const size_t corpus_specs_count = sizeof(corpus_specs) / sizeof(corpus_specs[0]);
+
+
+namespace {
+
+const char* const cWords[] =
+{
+	"if", "else", "for", "while", "return", "int", "const", "auto", "std::vector", "size_t", "count", "value",
+	"index", "result", "buffer", "line", "text", "view", "diff", "offset", "length", "match", "hash", "begin",
+	"end", "=", "==", "!=", "+", "-", "*", "(", ")", "{", "}", ";", ",", "->", "0", "1", "nullptr", "true", "false",
+	"CompareOptions", "getLineStart", "section", "options", "lines", "Notepad", "Scintilla", "//", "TODO"
+};
+
+const size_t cWordsCount = sizeof(cWords) / sizeof(cWords[0]);
+
+// Distinct lines of the REPEATED_LINES pattern
+const int cRepeatedLinesCount = 4;
+
+
+/**
+ *  \class  corpus_rng
+ *  \brief  SplitMix64 generator - the same sequence on all platforms for the same seed
+ */
+class corpus_rng
+{
+public:
+	explicit corpus_rng(uint64_t seed) : _state(seed) {}
+
+	uint64_t next()
+	{
+		uint64_t z = (_state += 0x9E3779B97F4A7C15ULL);
+
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+		return z ^ (z >> 31);
+	}
+
+	// Returns a number in [0, n)
+	int below(int n)
+	{
+		return (n > 0) ? static_cast<int>(next() % static_cast<uint64_t>(n)) : 0;
+	}
+
+	bool chance(int per1000)
+	{
+		return (below(1000) < per1000);
+	}
+
+private:
+	uint64_t _state;
+};
+
+
+inline const char* random_word(corpus_rng& rng)
+{
+	return cWords[rng.below(static_cast<int>(cWordsCount))];
+}
+
+
+// Line lengths are skewed towards the short ones like in real code
+std::string make_line(corpus_rng& rng, const corpus_spec& spec)
+{
+	const int span = spec.max_line_len - spec.min_line_len;
+	const int len = spec.min_line_len + static_cast<int>(static_cast<int64_t>(span) * rng.below(1000) *
+			rng.below(1000) / 1000000);
+
+	std::string line(static_cast<size_t>(std::min(rng.below(5), len)), '\t');
+
+	while (static_cast<int>(line.size()) < len)
+	{
+		if (!line.empty() && line.back() != '\t')
+			line += ' ';
+
+		line += random_word(rng);
+	}
+
+	if (static_cast<int>(line.size()) > len)
+		line.resize(len);
+
+	return line;
+}
+
+
+void change_word(corpus_rng& rng, std::string& line)
+{
+	const size_t pos = line.empty() ? 0 : static_cast<size_t>(rng.below(static_cast<int>(line.size())));
+
+	line.insert(pos, std::string(random_word(rng)) + ' ');
+}
+
+
+void change_whitespace(corpus_rng& rng, std::string& line)
+{
+	switch (rng.below(3))
+	{
+		case 0:
+			line += "  ";
+		break;
+
+		case 1:
+			line.insert(0, 1, '\t');
+		break;
+
+		default:
+		{
+			const size_t pos = line.find(' ');
+
+			if (pos != std::string::npos)
+				line.insert(pos, 1, ' ');
+			else
+				line += ' ';
+		}
+	}
+}
+
+
+void change_case(corpus_rng& rng, std::string& line)
+{
+	if (line.empty())
+		return;
+
+	size_t pos = static_cast<size_t>(rng.below(static_cast<int>(line.size())));
+
+	for (int changed = 0; pos < line.size() && changed < 8; ++pos)
+	{
+		const char ch = line[pos];
+
+		if (ch >= 'a' && ch <= 'z')
+			line[pos] = static_cast<char>(ch - ('a' - 'A'));
+		else if (ch >= 'A' && ch <= 'Z')
+			line[pos] = static_cast<char>(ch + ('a' - 'A'));
+		else
+			continue;
+
+		++changed;
+	}
+}
+
+
+void reorder_sections(corpus_rng& rng, const corpus_spec& spec, std::vector<std::string>& lines)
+{
+	const int sectionLen = std::max(1, static_cast<int>(lines.size()) / (4 * (spec.reordered_sections + 1)));
+
+	for (int i = 0; i < spec.reordered_sections && static_cast<int>(lines.size()) >= 2 * sectionLen; ++i)
+	{
+		const int pos = rng.below(static_cast<int>(lines.size()) - 2 * sectionLen + 1);
+
+		std::rotate(lines.begin() + pos, lines.begin() + pos + sectionLen, lines.begin() + pos + 2 * sectionLen);
+	}
+}
+
+
+void move_blocks(corpus_rng& rng, const corpus_spec& spec, std::vector<std::string>& lines)
+{
+	for (int i = 0; i < spec.moved_blocks; ++i)
+	{
+		const int len = std::min(spec.moved_block_len, static_cast<int>(lines.size()));
+
+		if (len <= 0)
+			return;
+
+		const int from = rng.below(static_cast<int>(lines.size()) - len + 1);
+
+		std::vector<std::string> block(lines.begin() + from, lines.begin() + from + len);
+		lines.erase(lines.begin() + from, lines.begin() + from + len);
+
+		const int to = rng.below(static_cast<int>(lines.size()) + 1);
+
+		lines.insert(lines.begin() + to, block.begin(), block.end());
+	}
+}
+
+
+std::vector<std::string> edit_lines(corpus_rng& rng, const corpus_spec& spec, const std::vector<std::string>& lines)
+{
+	std::vector<std::string> edited;
+	edited.reserve(lines.size() + lines.size() / 8);
+
+	for (const auto& line: lines)
+	{
+		if (rng.chance(spec.edits_density))
+		{
+			switch (rng.below(3))
+			{
+				case 0:
+					edited.emplace_back(line);
+					change_word(rng, edited.back());
+				break;
+
+				case 1:
+					// Line removed
+				break;
+
+				default:
+					edited.emplace_back(make_line(rng, spec));
+					edited.emplace_back(line);
+			}
+		}
+		else if (rng.chance(spec.whitespace_density))
+		{
+			edited.emplace_back(line);
+			change_whitespace(rng, edited.back());
+		}
+		else if (rng.chance(spec.case_density))
+		{
+			edited.emplace_back(line);
+			change_case(rng, edited.back());
+		}
+		else
+		{
+			edited.emplace_back(line);
+		}
+	}
+
+	return edited;
+}
+
+
+std::string join_lines(const std::vector<std::string>& lines)
+{
+	std::string text;
+
+	for (size_t i = 0; i < lines.size(); ++i)
+	{
+		if (i)
+			text += "\r\n";
+
+		text += lines[i];
+	}
+
+	return text;
+}
+
+
+void generate_giant_line(corpus_rng& rng, const corpus_spec& spec, std::string& text1, std::string& text2)
+{
+	const int64_t len = static_cast<int64_t>(spec.lines) * (spec.min_line_len + spec.max_line_len) / 2;
+
+	std::vector<const char*> words;
+
+	for (int64_t wordsLen = 0; wordsLen < len; )
+	{
+		words.emplace_back(random_word(rng));
+		wordsLen += static_cast<int64_t>(std::char_traits<char>::length(words.back())) + 1;
+	}
+
+	text1.clear();
+	text2.clear();
+
+	for (const char* word: words)
+	{
+		text1 += word;
+		text1 += ' ';
+
+		if (rng.chance(spec.edits_density))
+		{
+			switch (rng.below(3))
+			{
+				case 0:
+					text2 += random_word(rng);
+					text2 += ' ';
+				break;
+
+				case 1:
+					// Word removed
+				break;
+
+				default:
+					text2 += random_word(rng);
+					text2 += ' ';
+					text2 += word;
+					text2 += ' ';
+			}
+		}
+		else
+		{
+			text2 += word;
+			text2 += ' ';
+		}
+	}
+}
+
+
+std::vector<std::string> generate_lines(corpus_rng& rng, const corpus_spec& spec)
+{
+	std::vector<std::string> lines;
+	lines.reserve(spec.lines);
+
+	if (spec.pattern == corpus_pattern::REPEATED_LINES)
+	{
+		std::vector<std::string> repeated;
+
+		for (int i = 0; i < cRepeatedLinesCount; ++i)
+			repeated.emplace_back(make_line(rng, spec));
+
+		for (int i = 0; i < spec.lines; ++i)
+			lines.emplace_back(repeated[rng.below(cRepeatedLinesCount)]);
+	}
+	else
+	{
+		for (int i = 0; i < spec.lines; ++i)
+			lines.emplace_back(make_line(rng, spec));
+	}
+
+	return lines;
+}
+
+
+std::vector<std::string> generate_variant(corpus_rng& rng, const corpus_spec& spec,
+		const std::vector<std::string>& lines)
+{
+	std::vector<std::string> variant = lines;
+
+	reorder_sections(rng, spec, variant);
+	move_blocks(rng, spec, variant);
+
+	return edit_lines(rng, spec, variant);
+}
+
+} // anonymous namespace
+
+
+void generate_corpus_pair(const corpus_spec& spec, std::string& text1, std::string& text2)
+{
+	corpus_rng rng(spec.seed);
+
+	if (spec.pattern == corpus_pattern::GIANT_LINE)
+	{
+		generate_giant_line(rng, spec, text1, text2);
+		return;
+	}
+
+	const std::vector<std::string> lines1 = generate_lines(rng, spec);
+
+	std::vector<std::string> lines2;
+
+	if (spec.pattern == corpus_pattern::ALL_DIFFERENT)
+	{
+		// Generated lines never start with '#' so none of these can match
+		lines2.reserve(spec.lines);
+
+		for (int i = 0; i < spec.lines; ++i)
+			lines2.emplace_back("#" + make_line(rng, spec));
+	}
+	else
+	{
+		lines2 = generate_variant(rng, spec, lines1);
+	}
+
+	text1 = join_lines(lines1);
+	text2 = join_lines(lines2);
+}
+
+
+void generate_corpus_three_way(const corpus_spec& spec, std::string& base, std::string& ours, std::string& theirs)
+{
+	corpus_rng rng(spec.seed);
+
+	const std::vector<std::string> baseLines = generate_lines(rng, spec);
+
+	ours	= join_lines(generate_variant(rng, spec, baseLines));
+	theirs	= join_lines(generate_variant(rng, spec, baseLines));
+	base	= join_lines(baseLines);
+}
+
+#endif
@@ -0,0 +1,81 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Synthetic compare corpus generation - pairs of texts with controlled size, line lengths, edits density, moved
+ * blocks, reordered sections, whitespace-only and case-only changes, and pathological patterns.
+ *
+ * Has no platform dependencies. Generation uses its own fixed-seed PRNG (standard library distributions are
+ * implementation defined) so the same corpus is produced on every machine and by every build.
+ */
+
+#pragma once
+
+#ifdef DLOG
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+
+enum class corpus_pattern
+{
+	TEXT,			// code-like lines
+	REPEATED_LINES,	// few distinct lines repeated all over
+	ALL_DIFFERENT,	// second text shares no lines with the first
+	GIANT_LINE		// the whole text is a single line
+};
+
+
+struct corpus_spec
+{
+	const char*		name;
+	uint64_t		seed;
+	corpus_pattern	pattern;
+
+	int	lines;
+	int	min_line_len;
+	int	max_line_len;
+
+	// Changed, removed or added lines per 1000 lines (words per 1000 words for GIANT_LINE)
+	int	edits_density;
+
+	int	moved_blocks;
+	int	moved_block_len;
+
+	// Pairs of adjacent sections swapped in the second text
+	int	reordered_sections;
+
+	// Lines per 1000 lines changed only in whitespace / only in letters case
+	int	whitespace_density;
+	int	case_density;
+};
+
+
+// Predefined corpus - each pair is generated from its fixed seed
+extern const corpus_spec corpus_specs[];
+extern const size_t corpus_specs_count;
+
+
+// Generates the texts pair (CRLF line endings) of the spec
+void generate_corpus_pair(const corpus_spec& spec, std::string& text1, std::string& text2);
+
+// Generates the base text and our and their texts edited from it independently (CRLF line endings) - the spec
+// pattern must be TEXT or REPEATED_LINES
+void generate_corpus_three_way(const corpus_spec& spec, std::string& base, std::string& ours, std::string& theirs);
+
+#endif
@@ -40,9 +40,19 @@
 
 #pragma once
 
+#include <cstdint>
 #include <cstdlib>
 #include <climits>
 #include <utility>
+#include <algorithm>
+#include <vector>
+#include <type_traits>
+#include <functional>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DIFF_USE_SSE2
+#include <emmintrin.h>
+#endif
 
 #include "varray.h"
 
@@ -75,6 +85,95 @@ struct diff_info<void>
 };
 
 
+/**
+ *  \struct diff_key
+ *  \brief  Element key traits - specialize with plain = true for elements whose equality is a plain
+ *          integer compare of a key (hash or char). DiffCalc then compares contiguous keys in bulk.
+ */
+template <typename Elem>
+struct diff_key
+{
+	static const bool plain = false;
+
+	typedef char type;
+
+	static inline type get(const Elem&)
+	{
+		return 0;
+	}
+};
+
+
+/**
+ *  \brief  Returns the length of the matching run of keys starting at a and b going forward
+ */
+template <typename Key>
+inline int diff_match_fwd(const Key* a, const Key* b, int maxLen)
+{
+	int len = 0;
+
+#ifdef DIFF_USE_SSE2
+	const int keysPerStep = static_cast<int>(16 / sizeof(Key));
+
+	for (; len + keysPerStep <= maxLen; len += keysPerStep)
+	{
+		const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + len));
+		const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + len));
+
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xFFFF)
+			break;
+	}
+#else
+	for (; len + 4 <= maxLen; len += 4)
+	{
+		if ((a[len] != b[len]) || (a[len + 1] != b[len + 1]) ||
+			(a[len + 2] != b[len + 2]) || (a[len + 3] != b[len + 3]))
+			break;
+	}
+#endif
+
+	while (len < maxLen && a[len] == b[len])
+		++len;
+
+	return len;
+}
+
+
+/**
+ *  \brief  Returns the length of the matching run of keys ending just before a and b going backward
+ */
+template <typename Key>
+inline int diff_match_bwd(const Key* a, const Key* b, int maxLen)
+{
+	int len = 0;
+
+#ifdef DIFF_USE_SSE2
+	const int keysPerStep = static_cast<int>(16 / sizeof(Key));
+
+	for (; len + keysPerStep <= maxLen; len += keysPerStep)
+	{
+		const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a - len - keysPerStep));
+		const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b - len - keysPerStep));
+
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xFFFF)
+			break;
+	}
+#else
+	for (; len + 4 <= maxLen; len += 4)
+	{
+		if ((a[-len - 1] != b[-len - 1]) || (a[-len - 2] != b[-len - 2]) ||
+			(a[-len - 3] != b[-len - 3]) || (a[-len - 4] != b[-len - 4]))
+			break;
+	}
+#endif
+
+	while (len < maxLen && a[-len - 1] == b[-len - 1])
+		++len;
+
+	return len;
+}
+
+
 /**
  *  \class  DiffCalc
  *  \brief  Compares and makes a differences list between two vectors (elements are template, must have operator==)
@@ -91,6 +190,33 @@ public:
 	// meaning that DIFF_IN_1 in the differences is regarding _b instead _a)
 	std::pair<std::vector<diff_info<UserDataT>>, bool> operator()(bool doBoundaryShift = true);
 
+	// True if the compare has been stopped on reaching the max edit cost - the differences are then incomplete
+	inline bool capped() const
+	{
+		return _capped;
+	}
+
+	// Sets a check called periodically by the compare - if it returns true the compare is stopped and its
+	// differences are empty
+	inline void setCancelCheck(const std::function<bool()>& isCancelled)
+	{
+		_isCancelled = isCancelled;
+	}
+
+	// True if the compare has been stopped by the cancel check
+	inline bool cancelled() const
+	{
+		return _cancelled;
+	}
+
+#ifdef DLOG
+	// Number of diagonals explored by the compare (the edit graph search work done)
+	inline uint64_t diagonals() const
+	{
+		return _diagonals;
+	}
+#endif
+
 	DiffCalc(const DiffCalc&) = delete;
 	const DiffCalc& operator=(const DiffCalc&) = delete;
 
@@ -99,7 +225,20 @@ private:
 		int x, y, u, v;
 	};
 
+	// Diagonals explored between cancel checks
+	static const int cCancelCheckPeriod = 1024 * 1024;
+
+	typedef std::integral_constant<bool, diff_key<Elem>::plain> plain_key;
+	typedef typename diff_key<Elem>::type key_type;
+
 	inline int& _v(int k, int r);
+	inline void _make_keys(std::true_type);
+	inline void _make_keys(std::false_type) {}
+	inline void _swap_seqs();
+	inline int _match_fwd(int aoff, int boff, int maxLen, std::true_type) const;
+	inline int _match_fwd(int aoff, int boff, int maxLen, std::false_type) const;
+	inline int _match_bwd(int aend, int bend, int maxLen, std::true_type) const;
+	inline int _match_bwd(int aend, int bend, int maxLen, std::false_type) const;
 	void _edit(diff_type type, int off, int len);
 	int _find_middle_snake(int aoff, int aend, int boff, int bend, middle_snake& ms);
 	int _ses(int aoff, int aend, int boff, int bend);
@@ -111,10 +250,23 @@ private:
 	const Elem*	_b;
 	int _b_size;
 
+	// Contiguous copies of the elements keys (used only if the key is plain)
+	std::vector<key_type>	_ka;
+	std::vector<key_type>	_kb;
+
 	std::vector<diff_info<UserDataT>>	_diff;
 
 	const int	_dmax;
+	bool		_capped {false};
 	varray<int>	_buf;
+
+	std::function<bool()>	_isCancelled;
+	bool					_cancelled {false};
+	int						_cancelCheckCountdown {cCancelCheckPeriod};
+
+#ifdef DLOG
+	uint64_t	_diagonals {0};
+#endif
 };
 
 
@@ -122,6 +274,7 @@ template <typename Elem, typename UserDataT>
 DiffCalc<Elem, UserDataT>::DiffCalc(const std::vector<Elem>& v1, const std::vector<Elem>& v2, int max) :
 	_a(v1.data()), _a_size(v1.size()), _b(v2.data()), _b_size(v2.size()), _dmax(max)
 {
+	_make_keys(plain_key());
 }
 
 
@@ -129,6 +282,7 @@ template <typename Elem, typename UserDataT>
 DiffCalc<Elem, UserDataT>::DiffCalc(const Elem v1[], int v1_size, const Elem v2[], int v2_size, int max) :
 	_a(v1), _a_size(v1_size), _b(v2), _b_size(v2_size), _dmax(max)
 {
+	_make_keys(plain_key());
 }
 
 
@@ -142,6 +296,67 @@ inline int& DiffCalc<Elem, UserDataT>::_v(int k, int r)
 }
 
 
+template <typename Elem, typename UserDataT>
+inline void DiffCalc<Elem, UserDataT>::_make_keys(std::true_type)
+{
+	_ka.reserve(_a_size);
+	_kb.reserve(_b_size);
+
+	for (int i = 0; i < _a_size; ++i)
+		_ka.push_back(diff_key<Elem>::get(_a[i]));
+
+	for (int i = 0; i < _b_size; ++i)
+		_kb.push_back(diff_key<Elem>::get(_b[i]));
+}
+
+
+template <typename Elem, typename UserDataT>
+inline void DiffCalc<Elem, UserDataT>::_swap_seqs()
+{
+	std::swap(_a, _b);
+	std::swap(_a_size, _b_size);
+	_ka.swap(_kb);
+}
+
+
+template <typename Elem, typename UserDataT>
+inline int DiffCalc<Elem, UserDataT>::_match_fwd(int aoff, int boff, int maxLen, std::true_type) const
+{
+	return diff_match_fwd(_ka.data() + aoff, _kb.data() + boff, maxLen);
+}
+
+
+template <typename Elem, typename UserDataT>
+inline int DiffCalc<Elem, UserDataT>::_match_fwd(int aoff, int boff, int maxLen, std::false_type) const
+{
+	int len = 0;
+
+	while (len < maxLen && _a[aoff + len] == _b[boff + len])
+		++len;
+
+	return len;
+}
+
+
+template <typename Elem, typename UserDataT>
+inline int DiffCalc<Elem, UserDataT>::_match_bwd(int aend, int bend, int maxLen, std::true_type) const
+{
+	return diff_match_bwd(_ka.data() + aend, _kb.data() + bend, maxLen);
+}
+
+
+template <typename Elem, typename UserDataT>
+inline int DiffCalc<Elem, UserDataT>::_match_bwd(int aend, int bend, int maxLen, std::false_type) const
+{
+	int len = 0;
+
+	while (len < maxLen && _a[aend - len - 1] == _b[bend - len - 1])
+		++len;
+
+	return len;
+}
+
+
 template <typename Elem, typename UserDataT>
 void DiffCalc<Elem, UserDataT>::_edit(diff_type type, int off, int len)
 {
@@ -187,6 +402,26 @@ int DiffCalc<Elem, UserDataT>::_find_middle_snake(int aoff, int aend, int boff,
 		if ((2 * d - 1) >= _dmax)
 			return _dmax;
 
+		if (_isCancelled)
+		{
+			_cancelCheckCountdown -= d + 1;
+
+			if (_cancelCheckCountdown <= 0)
+			{
+				_cancelCheckCountdown = cCancelCheckPeriod;
+
+				if (_isCancelled())
+				{
+					_cancelled = true;
+					return -1;
+				}
+			}
+		}
+
+#ifdef DLOG
+		_diagonals += 2 * (d + 1);
+#endif
+
 		for (k = d; k >= -d; k -= 2)
 		{
 			if (k == -d || (k != d && _v(k - 1, 0) < _v(k + 1, 0)))
@@ -199,10 +434,12 @@ int DiffCalc<Elem, UserDataT>::_find_middle_snake(int aoff, int aend, int boff,
 			ms.x = x;
 			ms.y = y;
 
-			while (x < aend && y < bend &&  _a[aoff + x] == _b[boff + y])
+			if (x < aend && y < bend)
 			{
-				++x;
-				++y;
+				const int len = _match_fwd(aoff + x, boff + y, std::min(aend - x, bend - y), plain_key());
+
+				x += len;
+				y += len;
 			}
 
 			_v(k, 0) = x;
@@ -236,10 +473,12 @@ int DiffCalc<Elem, UserDataT>::_find_middle_snake(int aoff, int aend, int boff,
 			ms.u = x;
 			ms.v = y;
 
-			while (x > 0 && y > 0 &&  _a[aoff + x - 1] == _b[boff + y - 1])
+			if (x > 0 && y > 0)
 			{
-				--x;
-				--y;
+				const int len = _match_bwd(aoff + x, boff + y, std::min(x, y), plain_key());
+
+				x -= len;
+				y -= len;
 			}
 
 			_v(kr, 1) = x;
@@ -287,7 +526,10 @@ int DiffCalc<Elem, UserDataT>::_ses(int aoff, int aend, int boff, int bend)
 			return -1;
 
 		if (d >= _dmax)
+		{
+			_capped = true;
 			return _dmax;
+		}
 
 		if (d > 1)
 		{
@@ -475,21 +717,15 @@ std::pair<std::vector<diff_info<UserDataT>>, bool> DiffCalc<Elem, UserDataT>::op
 	bool swapped = (_a_size < _b_size);
 
 	if (swapped)
-	{
-		std::swap(_a, _b);
-		std::swap(_a_size, _b_size);
-	}
+		_swap_seqs();
 
 	/* The _ses function assumes we begin with a diff. The following ensures this is true by skipping any matches
 	 * in the beginning. This also helps to quickly process sequences that match entirely.
 	 */
-	int off = 0;
-
 	int asize = _a_size;
 	int bsize = _b_size;
 
-	while (off < asize && off < bsize && _a[off] == _b[off])
-		++off;
+	const int off = _match_fwd(0, 0, std::min(asize, bsize), plain_key());
 
 	_edit(diff_type::DIFF_MATCH, 0, off);
 
@@ -508,6 +744,10 @@ std::pair<std::vector<diff_info<UserDataT>>, bool> DiffCalc<Elem, UserDataT>::op
 	// Wipe temporal buffer to free memory
 	_buf.get().clear();
 
+	// Max edit cost reached - the differences are incomplete, there is nothing to optimize
+	if (_capped)
+		return std::make_pair(_diff, swapped);
+
 	// Swap compared sequences and re-compare to see if result is more optimal
 	if (_a_size == _b_size)
 	{
@@ -516,10 +756,11 @@ std::pair<std::vector<diff_info<UserDataT>>, bool> DiffCalc<Elem, UserDataT>::op
 		// Store current compare result
 		std::vector<diff_info<UserDataT>> storedDiff = std::move(_diff);
 		std::swap(_a, _b);
+		_ka.swap(_kb);
 		swapped = !swapped;
 
 		// Restore first matching block before continuing
-		if (storedDiff[0].type == diff_type::DIFF_MATCH)
+		if (!storedDiff.empty() && storedDiff[0].type == diff_type::DIFF_MATCH)
 			_diff.push_back(storedDiff[0]);
 
 		int newReplacesCount = _ses(off, asize, off, bsize);
@@ -527,18 +768,29 @@ std::pair<std::vector<diff_info<UserDataT>>, bool> DiffCalc<Elem, UserDataT>::op
 		// Wipe temporal buffer to free memory
 		_buf.get().clear();
 
-		if (newReplacesCount != -1)
+		if (newReplacesCount != -1 && !_capped)
 			newReplacesCount = _count_replaces();
+		else
+			newReplacesCount = -1;
 
 		// If re-compare result is not more optimal - restore the previous state
 		if (newReplacesCount < replacesCount)
 		{
+			_capped = false;
 			_diff = std::move(storedDiff);
 			std::swap(_a, _b);
+			_ka.swap(_kb);
 			swapped = !swapped;
 		}
 	}
 
+	// Cancelled during the re-compare
+	if (_cancelled)
+	{
+		_diff.clear();
+		return std::make_pair(_diff, swapped);
+	}
+
 	if (doBoundaryShift)
 		_shift_boundaries();
 
@@ -0,0 +1,179 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Run-length map of the compare result lines and its rasterization to a column of pixels.
+ *
+ * Has no platform dependencies - the engine publishes the map with each compare and the NavBar renders it.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+
+// Ordered by drawing priority - when several lines share one pixel the highest type wins
+enum class map_type : uint8_t
+{
+	MAP_NONE = 0,
+	MAP_MOVED,
+	MAP_REMOVED,
+	MAP_ADDED,
+	MAP_CHANGED
+};
+
+
+const int map_types_count = static_cast<int>(map_type::MAP_CHANGED) + 1;
+
+
+struct map_run
+{
+	map_run(int l, int n, map_type t) : line(l), len(n), type(t) {}
+
+	int			line;
+	int			len;
+	map_type	type;
+};
+
+
+using diff_map_t = std::vector<map_run>;
+
+
+// Appends run to the map merging it with the last one if they are adjacent and of the same type
+inline void add_map_run(diff_map_t& map, int line, int len, map_type type)
+{
+	if (len <= 0 || type == map_type::MAP_NONE)
+		return;
+
+	if (!map.empty())
+	{
+		map_run& last = map.back();
+
+		if (last.type == type && last.line + last.len == line)
+		{
+			last.len += len;
+			return;
+		}
+	}
+
+	map.emplace_back(line, len, type);
+}
+
+
+// Sorts map runs by line, clips overlapping ones and merges the adjacent runs of the same type
+inline void normalize_diff_map(diff_map_t& map)
+{
+	if (map.empty())
+		return;
+
+	std::stable_sort(map.begin(), map.end(),
+			[](const map_run& lhs, const map_run& rhs) { return lhs.line < rhs.line; });
+
+	diff_map_t norm;
+	norm.reserve(map.size());
+
+	for (const auto& run: map)
+	{
+		int line	= run.line;
+		int len		= run.len;
+
+		if (!norm.empty())
+		{
+			const int prevEnd = norm.back().line + norm.back().len;
+
+			if (line < prevEnd)
+			{
+				len -= prevEnd - line;
+				line = prevEnd;
+			}
+		}
+
+		add_map_run(norm, line, len, run.type);
+	}
+
+	map.swap(norm);
+}
+
+
+// Map is valid only while the document lines count is the one at the time of compare - lineOffset is the count of
+// lines inserted before the map lines since (like the alignment first blank line)
+inline bool is_diff_map_valid(int mapLinesCount, int docLinesCount, int lineOffset = 0)
+{
+	return (mapLinesCount + lineOffset == docLinesCount);
+}
+
+
+/**
+ *  \brief  Rasterizes normalized map to a column of pixels - one pixel per row, each row covering linesPerRow lines.
+ *          A row gets the color of the highest priority type among its lines so no diff is lost on downscaling.
+ *          Done in a single pass over the map and the pixels. lineOffset is added to all map lines.
+ */
+inline void rasterize_diff_map(const diff_map_t& map, int linesCount, int linesPerRow,
+		const uint32_t (&palette)[map_types_count], std::vector<uint32_t>& pixels, int lineOffset = 0)
+{
+	if (linesPerRow < 1)
+		linesPerRow = 1;
+
+	const int rows = (linesCount > 0) ? (linesCount + linesPerRow - 1) / linesPerRow : 0;
+
+	pixels.assign(rows, palette[static_cast<int>(map_type::MAP_NONE)]);
+
+	if (rows == 0)
+		return;
+
+	// Priority of the type already put in the last touched row - runs are sorted so only that row can be shared
+	int lastRow = -1;
+	map_type lastType = map_type::MAP_NONE;
+
+	for (const auto& run: map)
+	{
+		const int line = run.line + lineOffset;
+
+		if (line >= linesCount)
+			break;
+
+		if (line < 0)
+			continue;
+
+		const int firstRow	= line / linesPerRow;
+		const int endRow	= (std::min(line + run.len, linesCount) - 1) / linesPerRow + 1;
+		const uint32_t clr	= palette[static_cast<int>(run.type)];
+
+		int row = firstRow;
+
+		if (row == lastRow)
+		{
+			if (run.type > lastType)
+			{
+				pixels[row] = clr;
+				lastType = run.type;
+			}
+
+			++row;
+		}
+
+		if (row < endRow)
+		{
+			std::fill(pixels.begin() + row, pixels.begin() + endRow, clr);
+
+			lastRow		= endRow - 1;
+			lastType	= run.type;
+		}
+	}
+}
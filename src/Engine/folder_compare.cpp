@@ -0,0 +1,463 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <utility>
+
+#include "folder_compare.h"
+#include "casefold.h"
+
+
+namespace {
+
+// Max count of unpaired files of each folder whose lines are loaded to detect renamed (and changed) files
+const size_t cRenameDetectMaxFiles = 256;
+
+
+size_t addFolderItem(std::vector<FolderCompareItem>& items, const folder_file* file1, const folder_file* file2,
+		FolderItemState state)
+{
+	items.emplace_back();
+
+	FolderCompareItem& item = items.back();
+
+	if (file1)
+	{
+		item.path1 = file1->path;
+		item.size1 = file1->size;
+	}
+
+	if (file2)
+	{
+		item.path2 = file2->path;
+		item.size2 = file2->size;
+	}
+
+	item.state = state;
+
+	return items.size() - 1;
+}
+
+
+// Items are listed by their first folder path (by the second one if only in the second folder)
+inline const std::wstring& itemPath(const FolderCompareItem& item)
+{
+	return item.path1.empty() ? item.path2 : item.path1;
+}
+
+
+// Runs in the platform tasks
+void compareItem(folder_compare_platform& platform, const std::wstring& dir1, const std::wstring& dir2,
+		FolderCompareItem& item)
+{
+	const std::wstring file1 = dir1 + item.path1;
+	const std::wstring file2 = dir2 + item.path2;
+
+	item.state = FolderItemState::COMPARE_ERROR;
+
+	try
+	{
+		// Equal contents match whatever the compare options are - there is no need to compare their lines
+		if (item.size1 == item.size2)
+		{
+			uint64_t hash1, hash2;
+
+			if (!platform.file_hash(file1, hash1) || !platform.file_hash(file2, hash2))
+				return;
+
+			if (hash1 == hash2)
+			{
+				item.state = FolderItemState::MATCH;
+				return;
+			}
+		}
+
+		platform.compare_file_lines(file1, file2, item);
+	}
+	catch (...)
+	{
+		item.state = FolderItemState::COMPARE_ERROR;
+	}
+}
+
+
+/**
+ *  \brief  Pairs the files found only in one of the folders as renamed - by equal content first (size and whole
+ *          file hash) then by lines similarity at least the match percent. Renamed files with equal content are
+ *          added as matching, the others are added to the compare tasks. Returns false if cancelled.
+ */
+bool pairRenamedFiles(folder_compare_platform& platform, const std::wstring& dir1, const std::wstring& dir2,
+		const std::vector<folder_file>& only1, const std::vector<folder_file>& only2, int matchPercent,
+		std::vector<FolderCompareItem>& items, std::vector<size_t>& tasks, std::vector<bool>& paired1,
+		std::vector<bool>& paired2)
+{
+	paired1.assign(only1.size(), false);
+	paired2.assign(only2.size(), false);
+
+	std::unordered_multimap<uint64_t, size_t> sizes2;
+
+	for (size_t i = 0; i < only2.size(); ++i)
+	{
+		// Empty files would all be paired to each other
+		if (only2[i].size)
+			sizes2.emplace(only2[i].size, i);
+	}
+
+	std::unordered_map<size_t, uint64_t> hashes2;
+
+	for (size_t i = 0; i < only1.size(); ++i)
+	{
+		auto sameSize = sizes2.equal_range(only1[i].size);
+
+		if (sameSize.first == sameSize.second)
+			continue;
+
+		uint64_t hash1;
+
+		if (!platform.file_hash(dir1 + only1[i].path, hash1))
+			continue;
+
+		for (auto it = sameSize.first; it != sameSize.second; ++it)
+		{
+			const size_t j = it->second;
+
+			if (paired2[j])
+				continue;
+
+			auto hash2 = hashes2.find(j);
+
+			if (hash2 == hashes2.end())
+			{
+				uint64_t hash;
+
+				if (!platform.file_hash(dir2 + only2[j].path, hash))
+					continue;
+
+				hash2 = hashes2.emplace(j, hash).first;
+			}
+
+			if (hash2->second == hash1)
+			{
+				paired1[i] = true;
+				paired2[j] = true;
+
+				addFolderItem(items, &only1[i], &only2[j], FolderItemState::MATCH);
+				break;
+			}
+		}
+
+		if (platform.is_cancelled())
+			return false;
+	}
+
+	std::vector<size_t> unpaired1;
+	std::vector<size_t> unpaired2;
+
+	for (size_t i = 0; i < only1.size(); ++i)
+		if (!paired1[i])
+			unpaired1.emplace_back(i);
+
+	for (size_t i = 0; i < only2.size(); ++i)
+		if (!paired2[i])
+			unpaired2.emplace_back(i);
+
+	if (unpaired1.empty() || unpaired2.empty() ||
+			unpaired1.size() > cRenameDetectMaxFiles || unpaired2.size() > cRenameDetectMaxFiles)
+		return true;
+
+	platform.set_progress_max(static_cast<unsigned>(unpaired1.size() + unpaired2.size()));
+
+	std::vector<std::vector<uint64_t>> linesSets1;
+	std::vector<std::vector<uint64_t>> linesSets2;
+
+	for (size_t i: unpaired1)
+	{
+		linesSets1.emplace_back(platform.file_lines_set(dir1 + only1[i].path));
+
+		if (!platform.advance_progress())
+			return false;
+	}
+
+	for (size_t j: unpaired2)
+	{
+		linesSets2.emplace_back(platform.file_lines_set(dir2 + only2[j].path));
+
+		if (!platform.advance_progress())
+			return false;
+	}
+
+	struct RenameCandidate
+	{
+		int		similarity;
+		size_t	idx1;
+		size_t	idx2;
+	};
+
+	std::vector<RenameCandidate> candidates;
+
+	for (size_t i = 0; i < linesSets1.size(); ++i)
+	{
+		if (linesSets1[i].empty())
+			continue;
+
+		for (size_t j = 0; j < linesSets2.size(); ++j)
+		{
+			if (linesSets2[j].empty())
+				continue;
+
+			const int similarity = lines_sets_similarity(linesSets1[i], linesSets2[j]);
+
+			if (similarity >= matchPercent)
+				candidates.push_back({ similarity, unpaired1[i], unpaired2[j] });
+		}
+	}
+
+	// Most similar files are paired first
+	std::stable_sort(candidates.begin(), candidates.end(),
+			[](const RenameCandidate& lhs, const RenameCandidate& rhs)
+			{
+				return (lhs.similarity > rhs.similarity);
+			});
+
+	for (const auto& candidate: candidates)
+	{
+		if (paired1[candidate.idx1] || paired2[candidate.idx2])
+			continue;
+
+		paired1[candidate.idx1] = true;
+		paired2[candidate.idx2] = true;
+
+		tasks.emplace_back(addFolderItem(items, &only1[candidate.idx1], &only2[candidate.idx2],
+				FolderItemState::COMPARE_ERROR));
+	}
+
+	return true;
+}
+
+} // anonymous namespace
+
+
+int compare_paths_nocase(const std::wstring& path1, const std::wstring& path2)
+{
+	const size_t len = std::min(path1.size(), path2.size());
+
+	for (size_t i = 0; i < len; ++i)
+	{
+		const uint32_t ch1 = fold_code_point(static_cast<uint32_t>(path1[i]));
+		const uint32_t ch2 = fold_code_point(static_cast<uint32_t>(path2[i]));
+
+		if (ch1 != ch2)
+			return (ch1 < ch2) ? -1 : 1;
+	}
+
+	return (path1.size() < path2.size()) ? -1 : (path1.size() > path2.size()) ? 1 : 0;
+}
+
+
+int lines_sets_similarity(const std::vector<uint64_t>& linesSet1, const std::vector<uint64_t>& linesSet2)
+{
+	const size_t maxSize = std::max(linesSet1.size(), linesSet2.size());
+
+	if (maxSize == 0)
+		return 0;
+
+	size_t common = 0;
+
+	for (auto it1 = linesSet1.begin(), it2 = linesSet2.begin(); it1 != linesSet1.end() && it2 != linesSet2.end();)
+	{
+		if (*it1 < *it2)
+		{
+			++it1;
+		}
+		else if (*it2 < *it1)
+		{
+			++it2;
+		}
+		else
+		{
+			++common;
+			++it1;
+			++it2;
+		}
+	}
+
+	return static_cast<int>(common * 100 / maxSize);
+}
+
+
+folders_compare_result compare_folders(const std::wstring& dir1, const std::wstring& dir2, bool detectRenames,
+		int renameMatchPercent, folder_compare_platform& platform, FoldersCompareSummary& summary,
+		const std::function<void(const FolderCompareItem& item)>& itemDone)
+{
+	std::vector<folder_file> files1;
+	std::vector<folder_file> files2;
+
+	if (!platform.list_files(dir1, files1) || !platform.list_files(dir2, files2))
+		return folders_compare_result::FAILED;
+
+	summary.filesCount1 = static_cast<int>(files1.size());
+	summary.filesCount2 = static_cast<int>(files2.size());
+
+	auto fileLess = [](const folder_file& lhs, const folder_file& rhs)
+	{
+		return (compare_paths_nocase(lhs.path, rhs.path) < 0);
+	};
+
+	std::sort(files1.begin(), files1.end(), fileLess);
+	std::sort(files2.begin(), files2.end(), fileLess);
+
+	std::vector<FolderCompareItem>& items = summary.items;
+
+	// Indexes of the items whose files are to be compared
+	std::vector<size_t> tasks;
+
+	std::vector<folder_file> only1;
+	std::vector<folder_file> only2;
+
+	// Pair files by their relative paths
+	for (auto f1 = files1.begin(), f2 = files2.begin(); f1 != files1.end() || f2 != files2.end();)
+	{
+		const int cmp = (f1 == files1.end()) ? 1 : (f2 == files2.end()) ? -1 :
+				compare_paths_nocase(f1->path, f2->path);
+
+		if (cmp < 0)
+		{
+			only1.emplace_back(std::move(*f1++));
+		}
+		else if (cmp > 0)
+		{
+			only2.emplace_back(std::move(*f2++));
+		}
+		else
+		{
+			tasks.emplace_back(addFolderItem(items, &(*f1), &(*f2), FolderItemState::COMPARE_ERROR));
+			++f1;
+			++f2;
+		}
+	}
+
+	if (!platform.next_phase())
+		return folders_compare_result::CANCELLED;
+
+	std::vector<bool> paired1;
+	std::vector<bool> paired2;
+
+	if (detectRenames && !only1.empty() && !only2.empty())
+	{
+		if (!pairRenamedFiles(platform, dir1, dir2, only1, only2, renameMatchPercent, items, tasks,
+				paired1, paired2))
+			return folders_compare_result::CANCELLED;
+	}
+
+	for (size_t i = 0; i < only1.size(); ++i)
+		if (paired1.empty() || !paired1[i])
+			addFolderItem(items, &only1[i], nullptr, FolderItemState::ONLY_IN_1);
+
+	for (size_t i = 0; i < only2.size(); ++i)
+		if (paired2.empty() || !paired2[i])
+			addFolderItem(items, nullptr, &only2[i], FolderItemState::ONLY_IN_2);
+
+	// Listing order - the files are compared in that order too so the items are final about in order
+	std::vector<size_t> order(items.size());
+
+	for (size_t i = 0; i < order.size(); ++i)
+		order[i] = i;
+
+	std::stable_sort(order.begin(), order.end(),
+			[&](size_t lhs, size_t rhs)
+			{
+				return (compare_paths_nocase(itemPath(items[lhs]), itemPath(items[rhs])) < 0);
+			});
+
+	std::vector<size_t> listPos(items.size());
+
+	for (size_t i = 0; i < order.size(); ++i)
+		listPos[order[i]] = i;
+
+	std::sort(tasks.begin(), tasks.end(),
+			[&](size_t lhs, size_t rhs)
+			{
+				return (listPos[lhs] < listPos[rhs]);
+			});
+
+	std::vector<bool> isFinal(items.size(), true);
+
+	for (size_t task: tasks)
+		isFinal[task] = false;
+
+	size_t passedItems = 0;
+
+	// Passes on the items in listing order up to the first one whose files are still compared
+	auto passFinalItems = [&]()
+	{
+		for (; passedItems < order.size() && isFinal[order[passedItems]]; ++passedItems)
+		{
+			if (itemDone)
+				itemDone(items[order[passedItems]]);
+		}
+	};
+
+	// Files compares are the longest - give them the biggest progress phase
+	if (!platform.next_phase() || !platform.next_phase())
+		return folders_compare_result::CANCELLED;
+
+	passFinalItems();
+
+	std::vector<uint64_t> loads;
+
+	loads.reserve(tasks.size());
+
+	for (size_t task: tasks)
+		loads.emplace_back(items[task].size1 + items[task].size2);
+
+	if (!platform.run_tasks(loads,
+			[&](size_t task) { compareItem(platform, dir1, dir2, items[tasks[task]]); },
+			[&](size_t task)
+			{
+				isFinal[tasks[task]] = true;
+				passFinalItems();
+			}))
+		return folders_compare_result::CANCELLED;
+
+	passFinalItems();
+
+	if (!platform.next_phase())
+		return folders_compare_result::CANCELLED;
+
+	std::vector<FolderCompareItem> listedItems;
+
+	listedItems.reserve(items.size());
+
+	for (size_t i: order)
+		listedItems.emplace_back(std::move(items[i]));
+
+	items.swap(listedItems);
+
+	for (const auto& item: items)
+	{
+		if (item.state != FolderItemState::MATCH || compare_paths_nocase(item.path1, item.path2))
+			return folders_compare_result::MISMATCH;
+	}
+
+	return folders_compare_result::MATCH;
+}
@@ -0,0 +1,141 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Folders compare - files listing, pairing by path, renames detection and the files pairs compares scheduling.
+ *
+ * Has no platform dependencies. The file system access, the files lines compares, the worker threads and the
+ * progress are provided by a folder_compare_platform implementation.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <functional>
+#include <utility>
+
+
+enum class FolderItemState
+{
+	MATCH,
+	MISMATCH,
+	ONLY_IN_1,
+	ONLY_IN_2,
+	COMPARE_ERROR
+};
+
+
+// Files pair of compared folders - paths differ if the file is renamed, one of them is empty if it is missing
+struct FolderCompareItem
+{
+	std::wstring	path1; // Relative to the first folder
+	std::wstring	path2; // Relative to the second folder
+
+	uint64_t		size1 {0};
+	uint64_t		size2 {0};
+
+	FolderItemState	state {FolderItemState::COMPARE_ERROR};
+
+	int		removedLines {0};
+	int		addedLines {0};
+};
+
+
+struct FoldersCompareSummary
+{
+	int		filesCount1 {0};
+	int		filesCount2 {0};
+
+	// Sorted by path
+	std::vector<FolderCompareItem>	items;
+};
+
+
+struct folder_file
+{
+	folder_file(std::wstring&& p, uint64_t s) : path(std::move(p)), size(s) {}
+
+	std::wstring	path; // Relative to the listed folder
+	uint64_t		size;
+};
+
+
+/**
+ *  \class  folder_compare_platform
+ *  \brief  Services a folders compare runs on. file_hash() and compare_file_lines() are also called from the tasks
+ *          run by run_tasks() (possibly on worker threads), all other methods only from the compare thread.
+ */
+class folder_compare_platform
+{
+public:
+	virtual ~folder_compare_platform() = default;
+
+	// Lists the files of dir and its sub-folders (dir ends with a path separator) - false if dir can't be read
+	virtual bool list_files(const std::wstring& dir, std::vector<folder_file>& files) = 0;
+
+	// Whole file content hash - false if the file can't be read
+	virtual bool file_hash(const std::wstring& file, uint64_t& hash) = 0;
+
+	// Sorted unique lines hashes of the file as compared - empty if the file can't be read
+	virtual std::vector<uint64_t> file_lines_set(const std::wstring& file) = 0;
+
+	// Compares the files lines setting the item state (MATCH, MISMATCH or COMPARE_ERROR) and lines counts
+	virtual void compare_file_lines(const std::wstring& file1, const std::wstring& file2,
+			FolderCompareItem& item) = 0;
+
+	// Runs all tasks and waits for them - loads are the tasks memory use estimates. taskDone is called on the calling
+	// thread for each finished task (in any order) while the others still run. Returns false if cancelled.
+	virtual bool run_tasks(const std::vector<uint64_t>& loads, const std::function<void(size_t task)>& runTask,
+			const std::function<void(size_t task)>& taskDone) = 0;
+
+	// Progress - next_phase() and advance_progress() return false if the compare is cancelled
+	virtual bool next_phase() = 0;
+	virtual void set_progress_max(unsigned max) = 0;
+	virtual bool advance_progress() = 0;
+	virtual bool is_cancelled() = 0;
+};
+
+
+enum class folders_compare_result
+{
+	FAILED,
+	CANCELLED,
+	MATCH,
+	MISMATCH
+};
+
+
+// Case insensitive paths order (simple Unicode case folding) - negative, zero or positive like wcscmp
+int compare_paths_nocase(const std::wstring& path1, const std::wstring& path2);
+
+// Percentage of the lines common to both sorted sets out of the bigger set lines
+int lines_sets_similarity(const std::vector<uint64_t>& linesSet1, const std::vector<uint64_t>& linesSet2);
+
+/**
+ *  \brief  Compares all files of two folders (dirs end with a path separator) paired by relative path. Files of equal
+ *          size are first checked for equal content by whole file hash, the others are compared by lines. If
+ *          detectRenames is set, files found in only one of the folders are paired as renamed by equal content or
+ *          by lines similarity at least renameMatchPercent. Uses 4 progress phases. Each item is also passed to
+ *          itemDone (if given) in path order as soon as it and all items before it are final - while the other
+ *          files are still compared.
+ */
+folders_compare_result compare_folders(const std::wstring& dir1, const std::wstring& dir2, bool detectRenames,
+		int renameMatchPercent, folder_compare_platform& platform, FoldersCompareSummary& summary,
+		const std::function<void(const FolderCompareItem& item)>& itemDone = nullptr);
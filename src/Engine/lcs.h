@@ -0,0 +1,152 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Bit-parallel computation of the Longest Common Subsequence length as described in:
+ *
+ *   L. Allison, T.I. Dix, "A bit-string longest-common-subsequence algorithm",
+ *   Information Processing Letters 23 (1986), 305-310.
+ *
+ *   H. Hyyro, "Bit-parallel LCS-length computation revisited",
+ *   Proc. 15th Australasian Workshop on Combinatorial Algorithms (2004).
+ *
+ * Complexity is O(n * ceil(m / 64)) with no edit script produced - meant for fast similarity scoring only.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+
+/**
+ *  \class  LcsCalc
+ *  \brief  Computes LCS length between a fixed pattern and arbitrary sequences
+ *          (elements are template, must have char member 'ch' used as alphabet symbol)
+ */
+template <typename Elem>
+class LcsCalc
+{
+public:
+	LcsCalc(const std::vector<Elem>& pattern);
+
+	// Returns the length of the longest common subsequence between the pattern and the given sequence
+	int operator()(const std::vector<Elem>& seq) const;
+
+	inline int patternSize() const
+	{
+		return _m;
+	}
+
+	LcsCalc(const LcsCalc&) = delete;
+	const LcsCalc& operator=(const LcsCalc&) = delete;
+
+private:
+	static inline unsigned symbol(const Elem& e)
+	{
+		return static_cast<unsigned char>(e.ch);
+	}
+
+	static inline int popCount(uint64_t w)
+	{
+		w = w - ((w >> 1) & 0x5555555555555555ULL);
+		w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+		w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+
+		return static_cast<int>((w * 0x0101010101010101ULL) >> 56);
+	}
+
+	const int	_m;
+	const int	_words;
+
+	// Match bit-vectors - for each symbol a bit is set at every pattern position where it occurs
+	std::vector<uint64_t>	_peq;
+
+	mutable std::vector<uint64_t>	_v;
+};
+
+
+template <typename Elem>
+LcsCalc<Elem>::LcsCalc(const std::vector<Elem>& pattern) :
+	_m(static_cast<int>(pattern.size())), _words((_m + 63) / 64), _peq(256 * _words, 0), _v(_words)
+{
+	for (int i = 0; i < _m; ++i)
+		_peq[symbol(pattern[i]) * _words + (i / 64)] |= (1ULL << (i % 64));
+}
+
+
+template <typename Elem>
+int LcsCalc<Elem>::operator()(const std::vector<Elem>& seq) const
+{
+	if (_m == 0 || seq.empty())
+		return 0;
+
+	const int seqSize = static_cast<int>(seq.size());
+
+	// Single word fast path - lines up to 64 symbols
+	if (_words == 1)
+	{
+		uint64_t v = ~0ULL;
+
+		for (int j = 0; j < seqSize; ++j)
+		{
+			const uint64_t u = v & _peq[symbol(seq[j])];
+			v = (v + u) | (v - u);
+		}
+
+		if (_m < 64)
+			v |= (~0ULL << _m);
+
+		return 64 - popCount(v);
+	}
+
+	_v.assign(_words, ~0ULL);
+
+	for (int j = 0; j < seqSize; ++j)
+	{
+		const uint64_t* peq = &_peq[symbol(seq[j]) * _words];
+		uint64_t carry = 0;
+
+		for (int w = 0; w < _words; ++w)
+		{
+			const uint64_t v = _v[w];
+			const uint64_t u = v & peq[w];
+
+			// Multi-word (v + u) with carry propagation, (v - u) never borrows as u is a subset of v
+			const uint64_t sum = v + u;
+			const uint64_t res = sum + carry;
+
+			carry = (sum < v) || (res < sum);
+
+			_v[w] = res | (v - u);
+		}
+	}
+
+	int zeroBits = 0;
+
+	for (int w = 0; w < _words; ++w)
+	{
+		uint64_t v = _v[w];
+
+		if (w == _words - 1 && (_m % 64))
+			v |= (~0ULL << (_m % 64));
+
+		zeroBits += 64 - popCount(v);
+	}
+
+	return zeroBits;
+}
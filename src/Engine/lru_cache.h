@@ -0,0 +1,97 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+
+/**
+ *  \class  lru_cache
+ *  \brief  Map of at most capacity entries - when full the least recently used (found or put) entry is dropped
+ */
+template <typename Key, typename Value, typename KeyHash = std::hash<Key>>
+class lru_cache
+{
+public:
+	explicit lru_cache(size_t capacity) : _capacity(capacity) {}
+
+	// Returns the cached value (making it the most recently used) or nullptr if key is not cached
+	const Value* find(const Key& key)
+	{
+		auto found = _index.find(key);
+
+		if (found == _index.end())
+			return nullptr;
+
+		if (found->second != _entries.begin())
+			_entries.splice(_entries.begin(), _entries, found->second);
+
+		return &found->second->second;
+	}
+
+	void put(const Key& key, Value value)
+	{
+		if (_capacity == 0)
+			return;
+
+		auto found = _index.find(key);
+
+		if (found != _index.end())
+		{
+			found->second->second = std::move(value);
+
+			if (found->second != _entries.begin())
+				_entries.splice(_entries.begin(), _entries, found->second);
+
+			return;
+		}
+
+		if (_entries.size() >= _capacity)
+		{
+			_index.erase(_entries.back().first);
+			_entries.pop_back();
+		}
+
+		_entries.emplace_front(key, std::move(value));
+		_index.emplace(key, _entries.begin());
+	}
+
+	void clear()
+	{
+		_index.clear();
+		_entries.clear();
+	}
+
+	inline size_t size() const
+	{
+		return _entries.size();
+	}
+
+private:
+	using entry_t = std::pair<Key, Value>;
+
+	const size_t _capacity;
+
+	// Most recently used first
+	std::list<entry_t> _entries;
+	std::unordered_map<Key, typename std::list<entry_t>::iterator, KeyHash> _index;
+};
@@ -0,0 +1,114 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <vector>
+#include <functional>
+#include <algorithm>
+
+#include "three_way_merge.h"
+
+
+std::vector<merge_region> merge_changes(const std::vector<merge_hunk>& ours, const std::vector<merge_hunk>& theirs,
+		int baseLinesCount, const std::function<bool(const merge_range& ours, const merge_range& theirs)>& sameLines)
+{
+	std::vector<merge_region> regions;
+
+	// Side line index minus base line index after the already merged changes
+	int delta1 = 0;
+	int delta2 = 0;
+
+	int basePos = 0;
+
+	auto addRegion = [&](MergeRegionType type, int baseOff, int baseEnd, int groupDelta1, int groupDelta2)
+	{
+		merge_region region;
+
+		region.type		= type;
+		region.base		= merge_range(baseOff, baseEnd - baseOff);
+		region.ours		= merge_range(baseOff + delta1, baseEnd - baseOff + groupDelta1);
+		region.theirs	= merge_range(baseOff + delta2, baseEnd - baseOff + groupDelta2);
+
+		regions.emplace_back(region);
+	};
+
+	size_t i1 = 0;
+	size_t i2 = 0;
+
+	while (i1 < ours.size() || i2 < theirs.size())
+	{
+		const int groupOff = (i2 == theirs.size() || (i1 < ours.size() && ours[i1].base.off <= theirs[i2].base.off)) ?
+				ours[i1].base.off : theirs[i2].base.off;
+
+		if (groupOff > basePos)
+			addRegion(MergeRegionType::STABLE, basePos, groupOff, 0, 0);
+
+		int groupEnd = groupOff;
+
+		int groupDelta1 = 0;
+		int groupDelta2 = 0;
+
+		bool changed1 = false;
+		bool changed2 = false;
+
+		for (;;)
+		{
+			const merge_hunk* hunk;
+
+			if (i1 < ours.size() && ours[i1].base.off <= groupEnd)
+			{
+				hunk = &ours[i1++];
+				groupDelta1 += hunk->side.len - hunk->base.len;
+				changed1 = true;
+			}
+			else if (i2 < theirs.size() && theirs[i2].base.off <= groupEnd)
+			{
+				hunk = &theirs[i2++];
+				groupDelta2 += hunk->side.len - hunk->base.len;
+				changed2 = true;
+			}
+			else
+			{
+				break;
+			}
+
+			groupEnd = std::max(groupEnd, hunk->base.off + hunk->base.len);
+		}
+
+		MergeRegionType type = changed1 ? MergeRegionType::CHANGED_OURS : MergeRegionType::CHANGED_THEIRS;
+
+		if (changed1 && changed2)
+		{
+			const merge_range lines1(groupOff + delta1, groupEnd - groupOff + groupDelta1);
+			const merge_range lines2(groupOff + delta2, groupEnd - groupOff + groupDelta2);
+
+			type = sameLines(lines1, lines2) ? MergeRegionType::CHANGED_BOTH : MergeRegionType::CONFLICT;
+		}
+
+		addRegion(type, groupOff, groupEnd, groupDelta1, groupDelta2);
+
+		delta1 += groupDelta1;
+		delta2 += groupDelta2;
+
+		basePos = groupEnd;
+	}
+
+	if (basePos < baseLinesCount)
+		addRegion(MergeRegionType::STABLE, basePos, baseLinesCount, 0, 0);
+
+	return regions;
+}
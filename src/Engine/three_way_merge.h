@@ -0,0 +1,77 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Three-way merge of our and their changes against the common base - groups the changes of both sides in a single
+ * sweep over the base lines into stable, changed and conflict regions.
+ *
+ * Has no platform dependencies. The sides changes come from the base to side lines diffs, lines equality is checked
+ * through the given callback.
+ */
+
+#pragma once
+
+#include <vector>
+#include <functional>
+
+
+enum class MergeRegionType
+{
+	STABLE,
+	CHANGED_OURS,
+	CHANGED_THEIRS,
+	CHANGED_BOTH, // The same way in both
+	CONFLICT
+};
+
+
+// Lines indexes range (len can be 0)
+struct merge_range
+{
+	merge_range() : off(0), len(0) {}
+	merge_range(int o, int l) : off(o), len(l) {}
+
+	int off;
+	int len;
+};
+
+
+// Side change - base lines replaced by side lines
+struct merge_hunk
+{
+	merge_range	base;
+	merge_range	side;
+};
+
+
+struct merge_region
+{
+	MergeRegionType	type;
+
+	merge_range	base;
+	merge_range	ours;
+	merge_range	theirs;
+};
+
+
+/**
+ *  \brief  Merges our and their changes (hunks in base order) into regions covering all base lines in order.
+ *          Changes overlapping or touching in base are grouped in one region - a conflict unless sameLines returns
+ *          true for the region ours and theirs lines.
+ */
+std::vector<merge_region> merge_changes(const std::vector<merge_hunk>& ours, const std::vector<merge_hunk>& theirs,
+		int baseLinesCount, const std::function<bool(const merge_range& ours, const merge_range& theirs)>& sameLines);
@@ -0,0 +1,168 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <string>
+#include <unordered_set>
+#include <utility>
+
+
+/**
+ *  \class  session_mru
+ *  \brief  Version control sessions (open repositories / working copies) kept between diffs, most recently used
+ *          first. Each session remembers the dirs already resolved to it. Sessions over max count or not used for
+ *          the idle timeout are closed with the given free function. Times are in ms (wrap around is fine).
+ */
+template <typename Session, typename Key = std::string>
+class session_mru
+{
+public:
+	struct entry
+	{
+		Key							root;
+		std::unordered_set<Key>		dirs;
+		uint32_t					lastUsed;
+		Session						session;
+	};
+
+	session_mru(size_t maxCount, uint32_t idleTimeout, std::function<void(Session&)> freeSession) :
+			_maxCount(maxCount), _idleTimeout(idleTimeout), _free(std::move(freeSession)) {}
+
+	session_mru(const session_mru&) = delete;
+	session_mru& operator=(const session_mru&) = delete;
+
+	// Returns the session dir is already known to be in (nullptr if none)
+	entry* find_dir(const Key& dir, uint32_t now)
+	{
+		for (auto it = _entries.begin(); it != _entries.end(); ++it)
+		{
+			if (it->dirs.count(dir))
+				return touch(it, now);
+		}
+
+		return nullptr;
+	}
+
+	// Returns the session of the given root adding dir to its known dirs (nullptr if none)
+	entry* find_root(const Key& root, const Key& dir, uint32_t now)
+	{
+		for (auto it = _entries.begin(); it != _entries.end(); ++it)
+		{
+			if (it->root == root)
+			{
+				it->dirs.emplace(dir);
+				return touch(it, now);
+			}
+		}
+
+		return nullptr;
+	}
+
+	// Adds a new most recently used session closing the least recently used one if over max count
+	entry& add(const Key& root, const Key& dir, Session session, uint32_t now)
+	{
+		_entries.emplace_front();
+
+		entry& e = _entries.front();
+
+		e.root		= root;
+		e.lastUsed	= now;
+		e.session	= std::move(session);
+
+		e.dirs.emplace(dir);
+
+		while (_entries.size() > _maxCount)
+		{
+			_free(_entries.back().session);
+			_entries.pop_back();
+		}
+
+		return _entries.front();
+	}
+
+	// Closes the sessions not used for the idle timeout - returns the count of the sessions still open
+	size_t release_idle(uint32_t now)
+	{
+		while (!_entries.empty() && now - _entries.back().lastUsed >= _idleTimeout)
+		{
+			_free(_entries.back().session);
+			_entries.pop_back();
+		}
+
+		return _entries.size();
+	}
+
+	void clear()
+	{
+		for (auto& e: _entries)
+			_free(e.session);
+
+		_entries.clear();
+	}
+
+	inline bool empty() const
+	{
+		return _entries.empty();
+	}
+
+	inline size_t size() const
+	{
+		return _entries.size();
+	}
+
+private:
+	entry* touch(typename std::list<entry>::iterator it, uint32_t now)
+	{
+		it->lastUsed = now;
+
+		if (it != _entries.begin())
+			_entries.splice(_entries.begin(), _entries, it);
+
+		return &_entries.front();
+	}
+
+	const size_t	_maxCount;
+	const uint32_t	_idleTimeout;
+
+	const std::function<void(Session&)> _free;
+
+	std::list<entry> _entries;
+};
+
+
+// Key of a filtered blob content - content filters depend on the repository and the file path. The work dir is
+// NUL terminated so no two different (work dir, blob id, path) triplets give the same key.
+inline std::string git_blob_content_key(const std::string& workDir, const unsigned char* blobId, size_t idLen,
+		const std::string& path)
+{
+	std::string key;
+
+	key.reserve(workDir.size() + 1 + idLen + path.size());
+
+	key.append(workDir);
+	key.push_back('\0');
+	key.append(reinterpret_cast<const char*>(blobId), idLen);
+	key.append(path);
+
+	return key;
+}
@@ -0,0 +1,161 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Table driven characters classification and words segmentation of UTF-8 text.
+ *
+ * Has no platform dependencies. Multi-byte UTF-8 characters are classified as a whole so they are never split
+ * between words - they are word characters unless they are known punctuation or symbols (Latin-1 punctuation,
+ * general punctuation, currency, arrows, math and other symbols, CJK and fullwidth punctuation) which break words
+ * the same way ASCII punctuation does.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+
+enum class char_type : uint8_t
+{
+	SPACE,
+	ALNUM,
+	OTHER
+};
+
+
+constexpr char_type classify_char(unsigned ch)
+{
+	return (ch == ' ' || ch == '\t') ? char_type::SPACE :
+			((ch >= '0' && ch <= '9') || (ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z') || ch == '_' ||
+			ch >= 0x80) ? char_type::ALNUM : char_type::OTHER;
+}
+
+
+#define CHAR_TYPES_ROW(r) \
+	classify_char(r + 0x0), classify_char(r + 0x1), classify_char(r + 0x2), classify_char(r + 0x3), \
+	classify_char(r + 0x4), classify_char(r + 0x5), classify_char(r + 0x6), classify_char(r + 0x7), \
+	classify_char(r + 0x8), classify_char(r + 0x9), classify_char(r + 0xA), classify_char(r + 0xB), \
+	classify_char(r + 0xC), classify_char(r + 0xD), classify_char(r + 0xE), classify_char(r + 0xF)
+
+constexpr char_type char_types[256] =
+{
+	CHAR_TYPES_ROW(0x00), CHAR_TYPES_ROW(0x10), CHAR_TYPES_ROW(0x20), CHAR_TYPES_ROW(0x30),
+	CHAR_TYPES_ROW(0x40), CHAR_TYPES_ROW(0x50), CHAR_TYPES_ROW(0x60), CHAR_TYPES_ROW(0x70),
+	CHAR_TYPES_ROW(0x80), CHAR_TYPES_ROW(0x90), CHAR_TYPES_ROW(0xA0), CHAR_TYPES_ROW(0xB0),
+	CHAR_TYPES_ROW(0xC0), CHAR_TYPES_ROW(0xD0), CHAR_TYPES_ROW(0xE0), CHAR_TYPES_ROW(0xF0)
+};
+
+#undef CHAR_TYPES_ROW
+
+
+inline char_type get_char_type(char ch)
+{
+	return char_types[static_cast<unsigned char>(ch)];
+}
+
+
+// Type of the multi-byte UTF-8 char with the given lead and next two bytes (0 if missing)
+inline char_type get_utf8_char_type(unsigned char b0, unsigned char b1, unsigned char b2)
+{
+	switch (b0)
+	{
+		// U+0080 - U+00BF: C1 controls and Latin-1 punctuation and symbols but the letters and numbers among them
+		case 0xC2:
+			return (b1 == 0xAA || b1 == 0xB2 || b1 == 0xB3 || b1 == 0xB5 || b1 == 0xB9 || b1 == 0xBA ||
+					(b1 >= 0xBC && b1 <= 0xBE)) ? char_type::ALNUM : char_type::OTHER;
+
+		// U+00D7 and U+00F7: multiplication and division signs
+		case 0xC3:
+			return (b1 == 0x97 || b1 == 0xB7) ? char_type::OTHER : char_type::ALNUM;
+
+		// U+2000 - U+206F: general punctuation, U+20A0 - U+20CF: currency, U+2190 - U+2BFF: arrows, math and
+		// technical symbols, box drawing, shapes, dingbats
+		case 0xE2:
+			return (b1 == 0x80 || (b1 == 0x81 && b2 <= 0xAF) || (b1 == 0x82 && b2 >= 0xA0) ||
+					(b1 == 0x83 && b2 <= 0x8F) || (b1 >= 0x86 && b1 <= 0xAF)) ? char_type::OTHER : char_type::ALNUM;
+
+		// U+3000 - U+303F: CJK symbols and punctuation
+		case 0xE3:
+			return (b1 == 0x80) ? char_type::OTHER : char_type::ALNUM;
+
+		// U+FF00 - U+FF0F, U+FF1A - U+FF20, U+FF3B - U+FF40, U+FF5B - U+FF65: fullwidth and halfwidth punctuation
+		case 0xEF:
+			return ((b1 == 0xBC && (b2 <= 0x8F || (b2 >= 0x9A && b2 <= 0xA0) || b2 >= 0xBB)) ||
+					(b1 == 0xBD && (b2 == 0x80 || (b2 >= 0x9B && b2 <= 0xA5)))) ? char_type::OTHER : char_type::ALNUM;
+
+		default:
+			return char_type::ALNUM;
+	}
+}
+
+
+/**
+ *  \brief  Returns the type of the char starting at text[i] (len is the text length) and its length in bytes.
+ *          Stray UTF-8 continuation bytes and truncated chars are word chars.
+ */
+inline char_type get_char_type(const char* text, int i, int len, int& charLen)
+{
+	const unsigned char b0 = static_cast<unsigned char>(text[i]);
+
+	if (b0 < 0x80)
+	{
+		charLen = 1;
+		return char_types[b0];
+	}
+
+	charLen = (b0 >= 0xF0) ? 4 : (b0 >= 0xE0) ? 3 : (b0 >= 0xC0) ? 2 : 1;
+
+	if (charLen > len - i)
+		charLen = len - i;
+
+	const unsigned char b1 = (charLen > 1) ? static_cast<unsigned char>(text[i + 1]) : 0;
+	const unsigned char b2 = (charLen > 2) ? static_cast<unsigned char>(text[i + 2]) : 0;
+
+	return get_utf8_char_type(b0, b1, b2);
+}
+
+
+/**
+ *  \brief  Splits text to words - runs of chars of the same type - and calls onWord(pos, len, type) for each one
+ *          in text order. ASCII chars are classified by a table lookup each.
+ */
+template <typename WordHandler>
+void segment_words(const char* text, int len, WordHandler&& onWord)
+{
+	if (len <= 0)
+		return;
+
+	int charLen;
+
+	int wordStart = 0;
+	char_type wordType = get_char_type(text, 0, len, charLen);
+
+	for (int i = charLen; i < len; i += charLen)
+	{
+		const char_type type = get_char_type(text, i, len, charLen);
+
+		if (type != wordType)
+		{
+			onWord(wordStart, i - wordStart, wordType);
+
+			wordStart	= i;
+			wordType	= type;
+		}
+	}
+
+	onWord(wordStart, len - wordStart, wordType);
+}
@@ -0,0 +1,85 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <windows.h>
+#include <tchar.h>
+
+#include "GitRevisionDialog.h"
+#include "resource.h"
+#include "Window.h"
+
+
+UINT GitRevisionDialog::doDialog(TCHAR* revision, unsigned revisionSize)
+{
+	_revision		= revision;
+	_revisionSize	= revisionSize;
+
+	return (UINT)::DialogBoxParam(_hInst, MAKEINTRESOURCE(IDD_GIT_REVISION_DIALOG), _hParent,
+			(DLGPROC)dlgProc, (LPARAM)this);
+}
+
+
+INT_PTR CALLBACK GitRevisionDialog::run_dlgProc(UINT Message, WPARAM wParam, LPARAM /*lParam*/)
+{
+	switch (Message)
+	{
+		case WM_INITDIALOG :
+		{
+			goToCenter();
+
+			HWND hRevision = ::GetDlgItem(_hSelf, IDC_GIT_REVISION);
+
+			::SetWindowText(hRevision, _revision);
+			::SendMessage(hRevision, EM_SETSEL, 0, -1);
+			::SetFocus(hRevision);
+
+			// Focus is set to the revision edit box
+			return FALSE;
+		}
+		case WM_COMMAND :
+		{
+			switch (wParam)
+			{
+				case IDOK :
+				{
+					TCHAR revision[MAX_PATH];
+
+					::GetDlgItemText(_hSelf, IDC_GIT_REVISION, revision, _countof(revision));
+
+					// Empty revision would mean the index - that is what plain Git Diff is for
+					if (!revision[0])
+						return TRUE;
+
+					_tcscpy_s(_revision, _revisionSize, revision);
+
+					::EndDialog(_hSelf, IDOK);
+				}
+				return TRUE;
+
+				case IDCANCEL :
+					::EndDialog(_hSelf, IDCANCEL);
+				return TRUE;
+
+				default :
+				break;
+			}
+			break;
+		}
+	}
+	return FALSE;
+}
@@ -0,0 +1,55 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+
+#include "PluginInterface.h"
+#include "StaticDialog.h"
+
+
+/**
+ *  \class  GitRevisionDialog
+ *  \brief  Asks for the Git revision (commit, branch, tag, HEAD~N...) to diff the current file against
+ */
+class GitRevisionDialog : public StaticDialog
+{
+
+public:
+	GitRevisionDialog(HINSTANCE hInst, NppData nppDataParam) : StaticDialog()
+	{
+		Window::init(hInst, nppDataParam._nppHandle);
+	};
+
+	~GitRevisionDialog()
+	{
+		destroy();
+	}
+
+	// revision holds the initially shown revision and receives the entered one on IDOK
+	UINT doDialog(TCHAR* revision, unsigned revisionSize);
+
+	virtual void destroy() {};
+
+protected :
+	virtual INT_PTR CALLBACK run_dlgProc(UINT message, WPARAM wParam, LPARAM lParam);
+
+private:
+	TCHAR*		_revision {nullptr};
+	unsigned	_revisionSize {0};
+};
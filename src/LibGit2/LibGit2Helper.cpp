@@ -59,18 +59,45 @@ std::unique_ptr<LibGit>& LibGit::load()
 	Inst->repository_workdir = (PGITREPOSITORYWORKDIR)::GetProcAddress(libGit2, "git_repository_workdir");
 	if (!Inst->repository_workdir)
 		Inst->_isInit = false;
+	Inst->repository_path = (PGITREPOSITORYPATH)::GetProcAddress(libGit2, "git_repository_path");
+	if (!Inst->repository_path)
+		Inst->_isInit = false;
 	Inst->repository_index = (PGITREPOSITORYINDEX)::GetProcAddress(libGit2, "git_repository_index");
 	if (!Inst->repository_index)
 		Inst->_isInit = false;
 	Inst->index_get_bypath = (PGITINDEXGETBYPATH)::GetProcAddress(libGit2, "git_index_get_bypath");
 	if (!Inst->index_get_bypath)
 		Inst->_isInit = false;
+	Inst->index_read = (PGITINDEXREAD)::GetProcAddress(libGit2, "git_index_read");
+	if (!Inst->index_read)
+		Inst->_isInit = false;
 	Inst->blob_lookup = (PGITBLOBLOOKUP)::GetProcAddress(libGit2, "git_blob_lookup");
 	if (!Inst->blob_lookup)
 		Inst->_isInit = false;
 	Inst->blob_filtered_content = (PGITBLOBFILTERCONTENT)::GetProcAddress(libGit2, "git_blob_filtered_content");
 	if (!Inst->blob_filtered_content)
 		Inst->_isInit = false;
+	Inst->revparse_single = (PGITREVPARSESINGLE)::GetProcAddress(libGit2, "git_revparse_single");
+	if (!Inst->revparse_single)
+		Inst->_isInit = false;
+	Inst->object_peel = (PGITOBJECTPEEL)::GetProcAddress(libGit2, "git_object_peel");
+	if (!Inst->object_peel)
+		Inst->_isInit = false;
+	Inst->tree_entry_bypath = (PGITTREEENTRYBYPATH)::GetProcAddress(libGit2, "git_tree_entry_bypath");
+	if (!Inst->tree_entry_bypath)
+		Inst->_isInit = false;
+	Inst->tree_entry_id = (PGITTREEENTRYID)::GetProcAddress(libGit2, "git_tree_entry_id");
+	if (!Inst->tree_entry_id)
+		Inst->_isInit = false;
+	Inst->odb_hash = (PGITODBHASH)::GetProcAddress(libGit2, "git_odb_hash");
+	if (!Inst->odb_hash)
+		Inst->_isInit = false;
+	Inst->tree_entry_free = (PGITTREEENTRYFREE)::GetProcAddress(libGit2, "git_tree_entry_free");
+	if (!Inst->tree_entry_free)
+		Inst->_isInit = false;
+	Inst->object_free = (PGITOBJECTFREE)::GetProcAddress(libGit2, "git_object_free");
+	if (!Inst->object_free)
+		Inst->_isInit = false;
 	Inst->buf_free = (PGITBUFFREE)::GetProcAddress(libGit2, "git_buf_free");
 	if (!Inst->buf_free)
 		Inst->_isInit = false;
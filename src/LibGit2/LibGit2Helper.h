@@ -25,6 +25,19 @@
 typedef struct git_repository git_repository;
 typedef struct git_index git_index;
 typedef struct git_blob git_blob;
+typedef struct git_object git_object;
+typedef struct git_tree git_tree;
+typedef struct git_tree_entry git_tree_entry;
+
+
+typedef enum {
+	GIT_OBJ_ANY = -2,
+	GIT_OBJ_BAD = -1,
+	GIT_OBJ_COMMIT = 1,
+	GIT_OBJ_TREE = 2,
+	GIT_OBJ_BLOB = 3,
+	GIT_OBJ_TAG = 4
+} git_otype;
 
 
 typedef struct {
@@ -81,10 +94,19 @@ private:
 	typedef int (*PGITREPOSITORYOPENEXT) (git_repository **out, const char *path,
 			unsigned int flags, const char *ceiling_dirs);
 	typedef const char* (*PGITREPOSITORYWORKDIR) (git_repository *repo);
+	typedef const char* (*PGITREPOSITORYPATH) (git_repository *repo);
 	typedef int (*PGITREPOSITORYINDEX) (git_index **out, git_repository *repo);
+	typedef int (*PGITINDEXREAD) (git_index *index, int force);
 	typedef const git_index_entry* (*PGITINDEXGETBYPATH) (git_index *index, const char *path, int stage);
 	typedef int (*PGITBLOBLOOKUP) (git_blob **blob, git_repository *repo, const git_oid *id);
 	typedef int (*PGITBLOBFILTERCONTENT) (git_buf *out, git_blob *blob, const char *as_path, int check_for_bin_data);
+	typedef int (*PGITREVPARSESINGLE) (git_object **out, git_repository *repo, const char *spec);
+	typedef int (*PGITOBJECTPEEL) (git_object **peeled, const git_object *object, git_otype target_type);
+	typedef int (*PGITTREEENTRYBYPATH) (git_tree_entry **out, const git_tree *root, const char *path);
+	typedef const git_oid* (*PGITTREEENTRYID) (const git_tree_entry *entry);
+	typedef int (*PGITODBHASH) (git_oid *out, const void *data, size_t len, git_otype type);
+	typedef void (*PGITTREEENTRYFREE) (git_tree_entry *entry);
+	typedef void (*PGITOBJECTFREE) (git_object *object);
 	typedef void (*PGITBUFFREE) (git_buf *buf);
 	typedef void (*PGITBLOBFREE) (const git_blob *blob);
 	typedef void (*PGITINDEXFREE) (git_index *index);
@@ -107,10 +129,19 @@ public:
 
 	PGITREPOSITORYOPENEXT	repository_open_ext;
 	PGITREPOSITORYWORKDIR	repository_workdir;
+	PGITREPOSITORYPATH		repository_path;
 	PGITREPOSITORYINDEX		repository_index;
+	PGITINDEXREAD			index_read;
 	PGITINDEXGETBYPATH		index_get_bypath;
 	PGITBLOBLOOKUP			blob_lookup;
 	PGITBLOBFILTERCONTENT	blob_filtered_content;
+	PGITREVPARSESINGLE		revparse_single;
+	PGITOBJECTPEEL			object_peel;
+	PGITTREEENTRYBYPATH		tree_entry_bypath;
+	PGITTREEENTRYID			tree_entry_id;
+	PGITODBHASH				odb_hash;
+	PGITTREEENTRYFREE		tree_entry_free;
+	PGITOBJECTFREE			object_free;
 	PGITBUFFREE				buf_free;
 	PGITBLOBFREE			blob_free;
 	PGITINDEXFREE			index_free;
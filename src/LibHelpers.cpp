@@ -20,16 +20,102 @@
 #include <stdlib.h>
 #include <shlwapi.h>
 #include <cstring>
+#include <string>
+#include <unordered_map>
+#include <memory>
 
 #include "Compare.h"
 #include "LibHelpers.h"
 #include "SQLite/SqliteHelper.h"
 #include "LibGit2/LibGit2Helper.h"
+#include "Engine/lru_cache.h"
+#include "Engine/vcs_sessions.h"
+#include "Tools.h"
 
 
 namespace // anonymous namespace
 {
 
+// Max number of Git repositories kept open between Git diffs
+const int cGitSessionsMaxCount = 4;
+
+// Max number of Git blobs contents kept between Git diffs
+const size_t cGitContentsCacheSize = 8;
+
+// Max number of SVN working copies databases kept open between SVN diffs
+const int cSvnSessionsMaxCount = 4;
+
+// Git repositories and SVN databases not used for that long are closed (releasing their pack / db files)
+const uint32_t cSessionsIdleTimeout_ms = 60000;
+
+
+// Git repository and its index kept open between Git diffs - the index is re-read only when its file changes
+struct GitSession
+{
+	git_repository*	repo;
+	git_index*		index;
+
+	std::string		indexPath;
+	FILETIME		indexTime;
+	uint64_t		indexSize;
+};
+
+
+void freeGitSession(GitSession& session);
+
+// Keyed by repository work dir
+session_mru<GitSession> gitSessions(cGitSessionsMaxCount, cSessionsIdleTimeout_ms, freeGitSession);
+
+// Filtered blobs contents keyed by repository work dir, blob id and file path (filters depend on the path)
+lru_cache<std::string, std::shared_ptr<const GitBlobContent>> gitContentsCache(cGitContentsCacheSize);
+
+
+// SVN 1.7+ working copy database kept open with its prepared pristine checksum query between SVN diffs.
+// Looked up checksums are cached until wc.db changes.
+struct SvnSession
+{
+	sqlite3*		db;
+	sqlite3_stmt*	checksumQuery;
+
+	std::wstring	dbPath;
+	FILETIME		dbTime;
+	uint64_t		dbSize;
+
+	// Relative path to pristine checksum (empty if the path is not versioned)
+	std::unordered_map<std::wstring, std::wstring>	checksums;
+};
+
+
+void freeSvnSession(SvnSession& session);
+
+// Keyed by working copy root
+session_mru<SvnSession, std::wstring> svnSessions(cSvnSessionsMaxCount, cSessionsIdleTimeout_ms, freeSvnSession);
+
+
+/**
+ *  \class
+ *  \brief  Closes the version control sessions that went idle
+ */
+class DelayedSessionsRelease : public DelayedWork
+{
+public:
+	DelayedSessionsRelease() : DelayedWork() {}
+	virtual ~DelayedSessionsRelease() = default;
+
+	virtual void operator()();
+};
+
+
+DelayedSessionsRelease delayedSessionsRelease;
+
+
+// Marks a session use - idle sessions are checked for a bit after the idle timeout since the last use
+inline void sessionUsed()
+{
+	delayedSessionsRelease.post(cSessionsIdleTimeout_ms + 1000);
+}
+
+
 void TCharToChar(const wchar_t* src, char* dest, int destCharsCount)
 {
 	::WideCharToMultiByte(CP_ACP, 0, src, -1, dest, destCharsCount, NULL, NULL);
@@ -125,23 +211,302 @@ bool LocateDirUp(const TCHAR* dirName, const TCHAR* currentDir, TCHAR* fullDirPa
 	return false;
 }
 
+
+bool getFileStamp(const char* file, FILETIME& time, uint64_t& size)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attr;
+
+	if (!::GetFileAttributesExA(file, GetFileExInfoStandard, &attr))
+		return false;
+
+	time = attr.ftLastWriteTime;
+	size = (static_cast<uint64_t>(attr.nFileSizeHigh) << 32) | attr.nFileSizeLow;
+
+	return true;
+}
+
+
+bool getFileStamp(const wchar_t* file, FILETIME& time, uint64_t& size)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attr;
+
+	if (!::GetFileAttributesExW(file, GetFileExInfoStandard, &attr))
+		return false;
+
+	time = attr.ftLastWriteTime;
+	size = (static_cast<uint64_t>(attr.nFileSizeHigh) << 32) | attr.nFileSizeLow;
+
+	return true;
+}
+
+
+void freeSvnSession(SvnSession& session)
+{
+	sqlite3_finalize(session.checksumQuery);
+	sqlite3_close(session.db);
+}
+
+
+session_mru<SvnSession, std::wstring>::entry* openSvnSession(const TCHAR* wcRoot, const TCHAR* dbPath,
+		const TCHAR* dir)
+{
+	auto* known = svnSessions.find_root(wcRoot, dir, ::GetTickCount());
+
+	if (known)
+		return known;
+
+	SvnSession session;
+
+	if (sqlite3_open16(dbPath, &session.db) != SQLITE_OK)
+		return nullptr;
+
+	if (sqlite3_prepare16_v2(session.db, TEXT("SELECT checksum FROM nodes_current WHERE local_relpath=?1;"), -1,
+			&session.checksumQuery, NULL) != SQLITE_OK)
+	{
+		sqlite3_close(session.db);
+		return nullptr;
+	}
+
+	session.dbPath = dbPath;
+
+	if (!getFileStamp(dbPath, session.dbTime, session.dbSize))
+	{
+		session.dbTime.dwLowDateTime	= 0;
+		session.dbTime.dwHighDateTime	= 0;
+		session.dbSize					= 0;
+	}
+
+	return &svnSessions.add(wcRoot, dir, std::move(session), ::GetTickCount());
+}
+
+
+// Returns the pristine checksum of the working copy relative path (empty if not versioned)
+const std::wstring& getSvnChecksum(SvnSession& session, const std::wstring& relPath)
+{
+	FILETIME time;
+	uint64_t size;
+
+	// Working copy changed (update, commit, revert...) - checksums might be outdated
+	if (getFileStamp(session.dbPath.c_str(), time, size) &&
+			(::CompareFileTime(&time, &session.dbTime) || size != session.dbSize))
+	{
+		session.checksums.clear();
+
+		session.dbTime = time;
+		session.dbSize = size;
+	}
+
+	auto cached = session.checksums.find(relPath);
+
+	if (cached != session.checksums.end())
+		return cached->second;
+
+	std::wstring checksum;
+
+	if (sqlite3_bind_text16(session.checksumQuery, 1, relPath.c_str(), -1, SQLITE_TRANSIENT) == SQLITE_OK &&
+			sqlite3_step(session.checksumQuery) == SQLITE_ROW)
+	{
+		const TCHAR* text = (const TCHAR*)sqlite3_column_text16(session.checksumQuery, 0);
+
+		if (text)
+			checksum = text;
+	}
+
+	// Reset right away to release the database read lock
+	sqlite3_reset(session.checksumQuery);
+
+	return session.checksums.emplace(relPath, std::move(checksum)).first->second;
+}
+
+
+// Cached blobs contents are dropped as well as they must not outlive their repository
+void freeGitSession(GitSession& session)
+{
+	gitContentsCache.clear();
+
+	std::unique_ptr<LibGit>& gitLib = LibGit::load();
+
+	if (gitLib)
+	{
+		gitLib->index_free(session.index);
+		gitLib->repository_free(session.repo);
+	}
+}
+
+
+void refreshGitIndex(LibGit& gitLib, GitSession& session)
+{
+	FILETIME time;
+	uint64_t size;
+
+	if (!getFileStamp(session.indexPath.c_str(), time, size))
+		return;
+
+	if (::CompareFileTime(&time, &session.indexTime) || size != session.indexSize)
+	{
+		gitLib.index_read(session.index, 1);
+
+		session.indexTime = time;
+		session.indexSize = size;
+	}
+}
+
+
+// Returns the session of the repository containing dir opening the repository if needed (nullptr if not in a repo)
+session_mru<GitSession>::entry* getGitSession(LibGit& gitLib, const char* dir)
+{
+	auto* known = gitSessions.find_dir(dir, ::GetTickCount());
+
+	if (known)
+	{
+		refreshGitIndex(gitLib, known->session);
+		return known;
+	}
+
+	git_repository* repo = NULL;
+
+	if (gitLib.repository_open_ext(&repo, dir, 0, NULL))
+		return nullptr;
+
+	const char* workDir = gitLib.repository_workdir(repo);
+
+	// Bare repository - there is no working file to compare to
+	if (!workDir)
+	{
+		gitLib.repository_free(repo);
+		return nullptr;
+	}
+
+	// New dir of an already open repository
+	known = gitSessions.find_root(workDir, dir, ::GetTickCount());
+
+	if (known)
+	{
+		gitLib.repository_free(repo);
+
+		refreshGitIndex(gitLib, known->session);
+		return known;
+	}
+
+	GitSession session;
+
+	if (gitLib.repository_index(&session.index, repo))
+	{
+		gitLib.repository_free(repo);
+		return nullptr;
+	}
+
+	session.repo		= repo;
+	session.indexPath	= std::string(gitLib.repository_path(repo)) + "index";
+
+	if (!getFileStamp(session.indexPath.c_str(), session.indexTime, session.indexSize))
+	{
+		session.indexTime.dwLowDateTime		= 0;
+		session.indexTime.dwHighDateTime	= 0;
+		session.indexSize					= 0;
+	}
+
+	return &gitSessions.add(workDir, dir, std::move(session), ::GetTickCount());
+}
+
+
+bool getRevisionBlobId(LibGit& gitLib, GitSession& session, const char* revision, const char* path, git_oid& id)
+{
+	git_object* rev = NULL;
+
+	if (gitLib.revparse_single(&rev, session.repo, revision))
+		return false;
+
+	git_object* tree = NULL;
+
+	const bool isPeeled = !gitLib.object_peel(&tree, rev, GIT_OBJ_TREE);
+
+	gitLib.object_free(rev);
+
+	if (!isPeeled)
+		return false;
+
+	git_tree_entry* entry = NULL;
+
+	const bool isFound = !gitLib.tree_entry_bypath(&entry, reinterpret_cast<git_tree*>(tree), path);
+
+	if (isFound)
+	{
+		id = *gitLib.tree_entry_id(entry);
+		gitLib.tree_entry_free(entry);
+	}
+
+	gitLib.object_free(tree);
+
+	return isFound;
+}
+
+
+std::shared_ptr<const GitBlobContent> getBlobContent(LibGit& gitLib, const session_mru<GitSession>::entry& session,
+		const git_oid& id, const char* path)
+{
+	const std::string key = git_blob_content_key(session.root, id.id, sizeof(id.id), path);
+
+	const std::shared_ptr<const GitBlobContent>* cached = gitContentsCache.find(key);
+
+	if (cached)
+		return *cached;
+
+	std::shared_ptr<GitBlobContent> content = std::make_shared<GitBlobContent>();
+
+	if (gitLib.blob_lookup(&content->blob, session.session.repo, &id) ||
+			gitLib.blob_filtered_content(&content->buf, content->blob, path, 1))
+		return nullptr;
+
+	gitContentsCache.put(key, content);
+
+	return content;
+}
+
+
+void DelayedSessionsRelease::operator()()
+{
+	const uint32_t now = ::GetTickCount();
+
+	const size_t openCount = gitSessions.release_idle(now) + svnSessions.release_idle(now);
+
+	if (openCount)
+		sessionUsed();
+}
+
 } // anonymous namespace
 
 
+GitBlobContent::~GitBlobContent()
+{
+	std::unique_ptr<LibGit>& gitLib = LibGit::load();
+
+	if (!gitLib)
+		return;
+
+	if (buf.ptr)
+		gitLib->buf_free(&buf);
+
+	if (blob)
+		gitLib->blob_free(blob);
+}
+
+
 bool GetSvnFile(const TCHAR* fullFilePath, TCHAR* svnFile, unsigned svnFileSize)
 {
 	TCHAR svnTop[MAX_PATH];
 	TCHAR svnBase[MAX_PATH];
+	TCHAR fileDir[MAX_PATH];
 
-	_tcscpy_s(svnBase, _countof(svnBase), fullFilePath);
-	::PathRemoveFileSpec(svnBase);
+	_tcscpy_s(fileDir, _countof(fileDir), fullFilePath);
+	::PathRemoveFileSpec(fileDir);
 
-	bool ret = LocateDirUp(TEXT(".svn"), svnBase, svnTop, _countof(svnTop));
+	bool ret = false;
 
-	if (ret)
-	{
-		ret = false;
+	auto* session = svnSessions.find_dir(fileDir, ::GetTickCount());
 
+	if (!session && LocateDirUp(TEXT(".svn"), fileDir, svnTop, _countof(svnTop)))
+	{
 		TCHAR dotSvnIdx[MAX_PATH];
 
 		::PathCombine(dotSvnIdx, svnTop, TEXT(".svn"));
@@ -157,62 +522,52 @@ bool GetSvnFile(const TCHAR* fullFilePath, TCHAR* svnFile, unsigned svnFileSize)
 				return false;
 			}
 
-			sqlite3* ppDb;
-
-			if (sqlite3_open16(svnBase, &ppDb) == SQLITE_OK)
-			{
-				RelativePath(fullFilePath, svnTop, svnBase, _countof(svnBase));
-
-				TCHAR sqlQuery[MAX_PATH + 64];
-				_sntprintf_s(sqlQuery, _countof(sqlQuery), _TRUNCATE,
-						TEXT("SELECT checksum FROM nodes_current WHERE local_relpath='%s';"), svnBase);
+			session = openSvnSession(svnTop, svnBase, fileDir);
+		}
+		else
+		{
+			::PathCombine(svnTop, dotSvnIdx, TEXT("text-base"));
 
-				sqlite3_stmt* pStmt;
+			const TCHAR* file = ::PathFindFileName(fullFilePath);
 
-				if (sqlite3_prepare16_v2(ppDb, sqlQuery, -1, &pStmt, NULL) == SQLITE_OK)
-				{
-					if (sqlite3_step(pStmt) == SQLITE_ROW)
-					{
-						const TCHAR* checksum = (const TCHAR*)sqlite3_column_text16(pStmt, 0);
+			::PathCombine(svnBase, svnTop, file);
+			_tcscat_s(svnBase, _countof(svnBase), TEXT(".svn-base"));
 
-						if (checksum[0] != 0)
-						{
-							TCHAR idx[128];
+			// Is it an old SVN version?
+			if (::PathFileExists(svnBase))
+			{
+				_tcscpy_s(svnFile, svnFileSize, svnBase);
+				ret = true;
+			}
+		}
+	}
 
-							_tcsncpy_s(idx, _countof(idx), checksum + 6, 2);
+	if (session)
+	{
+		sessionUsed();
 
-							::PathCombine(svnBase, dotSvnIdx, TEXT("pristine"));
-							::PathCombine(dotSvnIdx, svnBase, idx);
+		RelativePath(fullFilePath, session->root.c_str(), svnBase, _countof(svnBase));
 
-							_tcscpy_s(idx, _countof(idx), checksum + 6);
+		const std::wstring& checksum = getSvnChecksum(session->session, svnBase);
 
-							::PathCombine(svnBase, dotSvnIdx, idx);
-							_tcscat_s(svnBase, _countof(svnBase), TEXT(".svn-base"));
+		// Checksum is "$sha1$" followed by the pristine file name
+		if (checksum.size() > 8)
+		{
+			TCHAR dotSvnIdx[MAX_PATH];
+			TCHAR idx[128];
 
-							if (PathFileExists(svnBase))
-							{
-								_tcscpy_s(svnFile, svnFileSize, svnBase);
-								ret = true;
-							}
-						}
-					}
+			::PathCombine(dotSvnIdx, session->root.c_str(), TEXT(".svn"));
+			::PathCombine(svnTop, dotSvnIdx, TEXT("pristine"));
 
-					sqlite3_finalize(pStmt);
-				}
+			_tcsncpy_s(idx, _countof(idx), checksum.c_str() + 6, 2);
 
-				sqlite3_close(ppDb);
-			}
-		}
-		else
-		{
-			::PathCombine(svnTop, dotSvnIdx, TEXT("text-base"));
+			::PathCombine(dotSvnIdx, svnTop, idx);
 
-			const TCHAR* file = ::PathFindFileName(fullFilePath);
+			_tcscpy_s(idx, _countof(idx), checksum.c_str() + 6);
 
-			::PathCombine(svnBase, svnTop, file);
+			::PathCombine(svnBase, dotSvnIdx, idx);
 			_tcscat_s(svnBase, _countof(svnBase), TEXT(".svn-base"));
 
-			// Is it an old SVN version?
 			if (::PathFileExists(svnBase))
 			{
 				_tcscpy_s(svnFile, svnFileSize, svnBase);
@@ -228,9 +583,9 @@ bool GetSvnFile(const TCHAR* fullFilePath, TCHAR* svnFile, unsigned svnFileSize)
 }
 
 
-std::vector<char> GetGitFileContent(const TCHAR* fullFilePath)
+GitFileContent GetGitFileContent(const TCHAR* fullFilePath, const TCHAR* revision)
 {
-	std::vector<char> gitFileContent;
+	GitFileContent gitFileContent;
 
 	std::unique_ptr<LibGit>& gitLib = LibGit::load();
 	if (!gitLib)
@@ -240,63 +595,86 @@ std::vector<char> GetGitFileContent(const TCHAR* fullFilePath)
 		return gitFileContent;
 	}
 
-	git_repository* repo = NULL;
+	char ansiPath[MAX_PATH];
+	char ansiDir[MAX_PATH];
 
-	char ansiGitFilePath[MAX_PATH];
+	TCharToChar(fullFilePath, ansiPath, sizeof(ansiPath));
 
+	strcpy_s(ansiDir, sizeof(ansiDir), ansiPath);
+	::PathRemoveFileSpecA(ansiDir);
+
+	auto* session = getGitSession(*gitLib, ansiDir);
+
+	if (session)
 	{
-		char ansiPath[MAX_PATH];
+		sessionUsed();
 
-		TCharToChar(fullFilePath, ansiPath, sizeof(ansiPath));
-		::PathRemoveFileSpecA(ansiPath);
+		char ansiGitFilePath[MAX_PATH];
 
-		if (!gitLib->repository_open_ext(&repo, ansiPath, 0, NULL))
-		{
-			const char* ansiGitDir = gitLib->repository_workdir(repo);
+		RelativePath(ansiPath, session->root.c_str(), ansiGitFilePath, sizeof(ansiGitFilePath));
 
-			//reinit with fullFilePath after modification by PathRemoveFileSpecA(), needed to get the relative path
-			TCharToChar(fullFilePath, ansiPath, sizeof(ansiPath));
+		bool isFound = false;
 
-			RelativePath(ansiPath, ansiGitDir, ansiGitFilePath, sizeof(ansiGitFilePath));
-		}
-	}
+		if (revision && revision[0])
+		{
+			char utf8Revision[MAX_PATH];
 
-	if (repo)
-	{
-		git_index* index;
+			::WideCharToMultiByte(CP_UTF8, 0, revision, -1, utf8Revision, sizeof(utf8Revision), NULL, NULL);
 
-		if (!gitLib->repository_index(&index, repo))
+			isFound = getRevisionBlobId(*gitLib, session->session, utf8Revision, ansiGitFilePath,
+					gitFileContent._id);
+		}
+		else
 		{
-			const git_index_entry* e = gitLib->index_get_bypath(index, ansiGitFilePath, 0);
+			const git_index_entry* e = gitLib->index_get_bypath(session->session.index, ansiGitFilePath, 0);
 
 			if (e)
 			{
-				git_blob* blob;
-
-				if (!gitLib->blob_lookup(&blob, repo, &e->id))
-				{
-					git_buf gitBuf = { 0 };
-
-					if (!gitLib->blob_filtered_content(&gitBuf, blob, ansiGitFilePath, 1))
-					{
-						gitFileContent.resize(gitBuf.size + 1, 0);
-						std::memcpy(gitFileContent.data(), gitBuf.ptr, gitBuf.size);
-
-						gitLib->buf_free(&gitBuf);
-					}
-
-					gitLib->blob_free(blob);
-				}
+				gitFileContent._id = e->id;
+				isFound = true;
 			}
-
-			gitLib->index_free(index);
 		}
 
-		gitLib->repository_free(repo);
+		if (isFound)
+			gitFileContent._content = getBlobContent(*gitLib, *session, gitFileContent._id, ansiGitFilePath);
 	}
 
-	if (gitFileContent.empty())
+	if (!gitFileContent.found())
 		::MessageBox(nppData._nppHandle, TEXT("No Git data found."), PLUGIN_NAME, MB_OK);
 
 	return gitFileContent;
 }
+
+
+bool IsSameGitContent(const GitFileContent& content, const char* text, size_t len)
+{
+	if (!content.found())
+		return false;
+
+	std::unique_ptr<LibGit>& gitLib = LibGit::load();
+
+	git_oid textId;
+
+	return (gitLib && !gitLib->odb_hash(&textId, text, len, GIT_OBJ_BLOB) &&
+			!std::memcmp(textId.id, content.id().id, sizeof(textId.id)));
+}
+
+
+void ClearGitSessions()
+{
+	// Called on plugin unload as well - LibGit2 must not be loaded if it was never used
+	gitContentsCache.clear();
+	gitSessions.clear();
+
+	if (svnSessions.empty())
+		delayedSessionsRelease.cancel();
+}
+
+
+void ClearSvnSessions()
+{
+	svnSessions.clear();
+
+	if (gitSessions.empty())
+		delayedSessionsRelease.cancel();
+}
@@ -21,7 +21,78 @@
 
 #include <windows.h>
 #include <tchar.h>
-#include <vector>
+#include <memory>
+
+#include "LibGit2/LibGit2Helper.h"
+
+
+/**
+ *  \struct GitBlobContent
+ *  \brief  Blob content as filtered by LibGit2 - the buffer might point directly into the blob data so the blob is
+ *          kept along with it. Not NUL terminated.
+ */
+struct GitBlobContent
+{
+	GitBlobContent() {}
+	~GitBlobContent();
+
+	GitBlobContent(const GitBlobContent&) = delete;
+	const GitBlobContent& operator=(const GitBlobContent&) = delete;
+
+	git_blob*	blob	{NULL};
+	git_buf		buf		{NULL, 0, 0};
+};
+
+
+/**
+ *  \class  GitFileContent
+ *  \brief  Git file content at some revision - shares the (cached) LibGit2 blob content so it is handed on
+ *          without copying
+ */
+class GitFileContent
+{
+public:
+	inline const char* data() const
+	{
+		return (_content ? _content->buf.ptr : nullptr);
+	}
+
+	inline size_t size() const
+	{
+		return (_content ? _content->buf.size : 0);
+	}
+
+	// False if the file is not found in Git (empty content is still a valid content)
+	inline bool found() const
+	{
+		return static_cast<bool>(_content);
+	}
+
+	// Blob id - the same for the same content at any revision
+	inline const git_oid& id() const
+	{
+		return _id;
+	}
+
+private:
+	friend GitFileContent GetGitFileContent(const TCHAR* fullFilePath, const TCHAR* revision);
+
+	std::shared_ptr<const GitBlobContent>	_content;
+	git_oid									_id;
+};
+
 
 bool GetSvnFile(const TCHAR* fullFilePath, TCHAR* svnFile, unsigned svnFileSize);
-std::vector<char> GetGitFileContent(const TCHAR* fullFilePath);
+
+// Gets the file content at the given revision (any Git revision spec - commit, branch, tag, HEAD~N...).
+// If revision is NULL or empty the file content in the index is returned.
+GitFileContent GetGitFileContent(const TCHAR* fullFilePath, const TCHAR* revision = NULL);
+
+// Checks if the given text is exactly the Git content (has the same blob id)
+bool IsSameGitContent(const GitFileContent& content, const char* text, size_t len);
+
+// Closes the Git repositories kept open between Git diffs and drops the cached Git contents
+void ClearGitSessions();
+
+// Closes the SVN working copies databases kept open between SVN diffs
+void ClearSvnSessions();
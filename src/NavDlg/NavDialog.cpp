@@ -37,6 +37,18 @@ const int NavDialog::cSpace = 2;
 const int NavDialog::cScrollerWidth = 15;
 
 
+namespace {
+
+// 32-bit DIB pixels are 0x00RRGGBB while COLORREF is 0x00BBGGRR
+inline uint32_t toDIBColor(COLORREF color)
+{
+	return (static_cast<uint32_t>(GetRValue(color)) << 16) | (static_cast<uint32_t>(GetGValue(color)) << 8) |
+			static_cast<uint32_t>(GetBValue(color));
+}
+
+}
+
+
 void NavDialog::NavView::init(HDC hDC)
 {
 	// Create bitmaps used to store graphical representation
@@ -45,22 +57,18 @@ void NavDialog::NavView::init(HDC hDC)
 
 	m_lines	= CallScintilla(m_view, SCI_GETLINECOUNT, 0, 0);
 
-	m_hViewBMP	= ::CreateCompatibleBitmap(hDC, 1, m_lines);
+	// View bitmap is created on rasterization when its height is known
 	m_hSelBMP	= ::CreateCompatibleBitmap(hDC, 1, 1);
 
-	BITMAP bmpInfo;
-	::GetObject(m_hViewBMP, sizeof(bmpInfo), &bmpInfo);
-	::GetObject(m_hSelBMP, sizeof(bmpInfo), &bmpInfo);
-
-	// Attach bitmaps to the DC
-	::SelectObject(m_hViewDC, m_hViewBMP);
+	// Attach bitmap to the DC
 	::SelectObject(m_hSelDC, m_hSelBMP);
 }
 
 
 void NavDialog::NavView::reset()
 {
-	m_lineMap.clear();
+	m_linesPerRow	= 1;
+	m_bmpLines		= 0;
 
 	if (m_hViewDC)
 	{
@@ -136,6 +144,9 @@ void NavDialog::NavView::paint(HDC hDC, int xPos, int yPos, int width, int heigh
 	firstVisible	= docToBmpLine(firstVisible);
 	lastVisible		= docToBmpLine(lastVisible);
 
+	if (firstVisible == lastVisible)
+		++lastVisible;
+
 	h /= hScale;
 
 	// Selector is out of scope so don't draw it
@@ -164,20 +175,55 @@ void NavDialog::NavView::paint(HDC hDC, int xPos, int yPos, int width, int heigh
 }
 
 
-int NavDialog::NavView::docToBmpLine(int docLine) const
+void NavDialog::NavView::rasterize(HDC hDC, const DiffMap& diffMap, int linesPerRow,
+		const uint32_t (&palette)[map_types_count])
 {
-	if (m_lineMap.empty())
-		return docLine;
+	diff_map_t markersMap;
+	const diff_map_t* map = &diffMap.runs[m_view];
 
-	const int max = static_cast<int>(m_lineMap.size());
+	// Map lines do not include the alignment first blank line
+	int lineOffset = isAlignmentFirstLineInserted(m_view) ? 1 : 0;
 
-	for (int i = 0; i < max; ++i)
+	// Document has been changed since the compare - collect the map from the markers instead
+	if (!is_diff_map_valid(diffMap.linesCount[m_view], m_lines, lineOffset))
 	{
-		if (docLine <= m_lineMap[i])
-			return i + 1;
+		getMarkersMap(markersMap);
+		map = &markersMap;
+		lineOffset = 0;
 	}
 
-	return max;
+	std::vector<uint32_t> pixels;
+	rasterize_diff_map(*map, m_lines, linesPerRow, palette, pixels, lineOffset);
+
+	m_linesPerRow	= linesPerRow;
+	m_bmpLines		= static_cast<int>(pixels.size());
+
+	if (m_bmpLines == 0)
+		return;
+
+	m_hViewBMP = ::CreateCompatibleBitmap(hDC, 1, m_bmpLines);
+
+	// Attach bitmap to the DC
+	::SelectObject(m_hViewDC, m_hViewBMP);
+
+	BITMAPINFO bmi = { 0 };
+	bmi.bmiHeader.biSize		= sizeof(bmi.bmiHeader);
+	bmi.bmiHeader.biWidth		= 1;
+	bmi.bmiHeader.biHeight		= -m_bmpLines; // Top-down rows
+	bmi.bmiHeader.biPlanes		= 1;
+	bmi.bmiHeader.biBitCount	= 32;
+	bmi.bmiHeader.biCompression	= BI_RGB;
+
+	::SetDIBitsToDevice(m_hViewDC, 0, 0, 1, m_bmpLines, 0, 0, 0, m_bmpLines, pixels.data(), &bmi, DIB_RGB_COLORS);
+}
+
+
+void NavDialog::NavView::getMarkersMap(diff_map_t& map) const
+{
+	// Visit only the marked lines
+	for (int line = CallScintilla(m_view, SCI_MARKERNEXT, 0, MARKER_MASK_LINE); line >= 0;
+			line = CallScintilla(m_view, SCI_MARKERNEXT, line + 1, MARKER_MASK_LINE))
+		add_map_run(map, line, 1, toMapType(CallScintilla(m_view, SCI_MARKERGET, line, 0)));
 }
 
 
@@ -300,10 +346,11 @@ void NavDialog::createBitmap()
 	const int maxLines	= std::max(m_view[0].m_lines, m_view[1].m_lines);
 	const int maxHeight	= (r.bottom - r.top) - 2 * cSpace - 2;
 
-	int reductionRatio = maxLines / maxHeight;
+	// Big documents are scaled down to fit the NavBar - each bitmap line then represents several document lines
+	int linesPerRow = 1;
 
-	if (reductionRatio && (maxLines % maxHeight))
-		++reductionRatio;
+	if (maxHeight > 0 && maxLines > maxHeight)
+		linesPerRow = (maxLines + maxHeight - 1) / maxHeight;
 
 	{
 		RECT bmpRect = { 0 };
@@ -317,98 +364,22 @@ void NavDialog::createBitmap()
 		::FillRect(m_view[1].m_hSelDC, &bmpRect, hBrush);
 
 		::DeleteObject(hBrush);
+	}
 
-		hBrush = ::CreateSolidBrush(m_clr._default);
-
-		bmpRect.bottom = m_view[0].m_lines;
-		::FillRect(m_view[0].m_hViewDC, &bmpRect, hBrush);
-
-		bmpRect.bottom = m_view[1].m_lines;
-		::FillRect(m_view[1].m_hViewDC, &bmpRect, hBrush);
-
-		::DeleteObject(hBrush);
-
-		m_view[0].m_lineMap.clear();
-		m_view[1].m_lineMap.clear();
-
-		int skipLine = reductionRatio;
-		int prevMarker = m_clr._default;
-		int bmpLine = 0;
-
-		for (int i = 0; i < m_view[0].m_lines; ++i)
-		{
-			int marker = CallScintilla(m_view[0].m_view, SCI_MARKERGET, i, 0);
-			if (!marker && !reductionRatio)
-				continue;
-
-			if (marker & MARKER_MASK_CHANGED)		marker = m_clr.changed;
-			else if (marker & MARKER_MASK_ADDED)	marker = m_clr.added;
-			else if (marker & MARKER_MASK_REMOVED)	marker = m_clr.deleted;
-			else if (marker & MARKER_MASK_MOVED)	marker = m_clr.moved;
-			else if (reductionRatio)				marker = m_clr._default;
-			else
-				continue;
-
-			if (reductionRatio)
-			{
-				if (prevMarker == marker)
-					--skipLine;
-
-				if (prevMarker != marker || !skipLine)
-				{
-					skipLine = reductionRatio;
-					prevMarker = marker;
-
-					m_view[0].m_lineMap.push_back(i);
-
-					::SetPixel(m_view[0].m_hViewDC, 0, bmpLine++, marker);
-				}
-			}
-			else
-			{
-				::SetPixel(m_view[0].m_hViewDC, 0, i, marker);
-			}
-		}
-
-		skipLine = reductionRatio;
-		prevMarker = m_clr._default;
-		bmpLine = 0;
+	const uint32_t palette[map_types_count] = {
+		toDIBColor(m_clr._default),
+		toDIBColor(m_clr.moved),
+		toDIBColor(m_clr.deleted),
+		toDIBColor(m_clr.added),
+		toDIBColor(m_clr.changed)
+	};
 
-		for (int i = 0; i < m_view[1].m_lines; ++i)
-		{
-			int marker = CallScintilla(m_view[1].m_view, SCI_MARKERGET, i, 0);
-			if (!marker && !reductionRatio)
-				continue;
-
-			if (marker & MARKER_MASK_CHANGED)		marker = m_clr.changed;
-			else if (marker & MARKER_MASK_ADDED)	marker = m_clr.added;
-			else if (marker & MARKER_MASK_REMOVED)	marker = m_clr.deleted;
-			else if (marker & MARKER_MASK_MOVED)	marker = m_clr.moved;
-			else if (reductionRatio)				marker = m_clr._default;
-			else
-				continue;
-
-			if (reductionRatio)
-			{
-				if (prevMarker == marker)
-					--skipLine;
-
-				if (prevMarker != marker || !skipLine)
-				{
-					skipLine = reductionRatio;
-					prevMarker = marker;
+	HDC hDC = ::GetDC(_hSelf);
 
-					m_view[1].m_lineMap.push_back(i);
+	m_view[0].rasterize(hDC, m_diffMap, linesPerRow, palette);
+	m_view[1].rasterize(hDC, m_diffMap, linesPerRow, palette);
 
-					::SetPixel(m_view[1].m_hViewDC, 0, bmpLine++, marker);
-				}
-			}
-			else
-			{
-				::SetPixel(m_view[1].m_hViewDC, 0, i, marker);
-			}
-		}
-	}
+	::ReleaseDC(_hSelf, hDC);
 
 	setScalingFactor();
 }
@@ -22,7 +22,9 @@
 #include "Compare.h"
 #include "Window.h"
 #include "DockingDlgInterface.h"
+#include "Engine.h"
 
+#include <cstdint>
 #include <vector>
 
 
@@ -49,6 +51,17 @@ public:
 			Show();
 	}
 
+	// Diff map published by the last compare - used instead of reading the markers while it is up to date
+	void SetDiffMap(const DiffMap& diffMap)
+	{
+		m_diffMap = diffMap;
+	}
+
+	void ClearDiffMap()
+	{
+		m_diffMap.clear();
+	}
+
 	void Update();
 
 protected:
@@ -64,7 +77,8 @@ private:
 	 */
 	struct NavView
 	{
-		NavView() : m_view(0), m_hViewDC(NULL), m_hSelDC(NULL), m_hViewBMP(NULL), m_hSelBMP(NULL) {}
+		NavView() : m_view(0), m_hViewDC(NULL), m_hSelDC(NULL), m_hViewBMP(NULL), m_hSelBMP(NULL),
+				m_lines(0), m_linesPerRow(1), m_bmpLines(0) {}
 
 		~NavView()
 		{
@@ -73,6 +87,8 @@ private:
 
 		void init(HDC hDC);
 		void reset();
+		void rasterize(HDC hDC, const DiffMap& diffMap, int linesPerRow,
+				const uint32_t (&palette)[map_types_count]);
 		void paint(HDC hDC, int xPos, int yPos, int width, int height, int hScale, int hOffset);
 
 		void updateFirstVisible()
@@ -82,22 +98,25 @@ private:
 
 		int maxBmpLines() const
 		{
-			return (m_lineMap.empty() ? m_lines : static_cast<int>(m_lineMap.size()));
+			return m_bmpLines;
 		}
 
 		int bmpToDocLine(int bmpLine) const
 		{
-			if (bmpLine < 0)
+			if (bmpLine <= 0)
 				return 0;
-			else if (m_lineMap.empty())
-				return bmpLine;
-			else if (bmpLine < static_cast<int>(m_lineMap.size()))
-				return m_lineMap[bmpLine];
+			else if (bmpLine >= m_bmpLines)
+				bmpLine = m_bmpLines - 1;
+
+			return bmpLine * m_linesPerRow;
+		}
 
-			return m_lineMap.back();
+		int docToBmpLine(int docLine) const
+		{
+			return docLine / m_linesPerRow;
 		}
 
-		int docToBmpLine(int docLine) const;
+		void getMarkersMap(diff_map_t& map) const;
 
 		int		m_view;
 
@@ -110,7 +129,9 @@ private:
 		int		m_firstVisible;
 		int		m_lines;
 
-		std::vector<int>	m_lineMap;
+		// Document lines represented by each bitmap line (pixel row)
+		int		m_linesPerRow;
+		int		m_bmpLines;
 	};
 
 	void doDialog();
@@ -129,6 +150,7 @@ private:
 	tTbData	_data;
 
 	ColorSettings	m_clr;
+	DiffMap			m_diffMap;
 
 	HINSTANCE		m_hInst;
 
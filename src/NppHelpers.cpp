@@ -450,25 +450,6 @@ std::vector<char> getText(int view, int startPos, int endPos)
 }
 
 
-void toLowerCase(std::vector<char>& text)
-{
-	const int len = static_cast<int>(text.size());
-
-	if (len == 0)
-		return;
-
-	std::vector<wchar_t> wText(len);
-
-	::MultiByteToWideChar(CP_UTF8, 0, text.data(), -1, wText.data(), len * sizeof(wchar_t));
-
-	wText.push_back(L'\0');
-	::CharLowerW((LPWSTR)wText.data());
-	wText.pop_back();
-
-	::WideCharToMultiByte(CP_UTF8, 0, wText.data(), -1, text.data(), len * sizeof(char), NULL, NULL);
-}
-
-
 void insertAlignmentFirstLine(int view)
 {
 	const BOOL modified	= (BOOL)CallScintilla(view, SCI_GETMODIFY, 0, 0);
@@ -333,6 +333,13 @@ inline LRESULT getCurrentBuffId()
 }
 
 
+inline LRESULT getCurrentBuffId(int view)
+{
+	const LRESULT pos = ::SendMessage(nppData._nppHandle, NPPM_GETCURRENTDOCINDEX, 0, view);
+	return ::SendMessage(nppData._nppHandle, NPPM_GETBUFFERIDFROMPOS, pos, view);
+}
+
+
 inline int getEncoding(LRESULT buffId)
 {
 	return ::SendMessage(nppData._nppHandle, NPPM_GETBUFFERENCODING, buffId, 0);
@@ -533,6 +540,5 @@ bool isAdjacentAnnotation(int view, int line, bool down);
 bool isVisibleAdjacentAnnotation(int view, int line, bool down);
 
 std::vector<char> getText(int view, int startPos, int endPos);
-void toLowerCase(std::vector<char>& text);
 
 void addBlankSection(int view, int line, int length, int selectionMarkPosition = 0);
@@ -94,6 +94,28 @@ unsigned ProgressDlg::NextPhase()
 }
 
 
+// Jumps over the phases left to the last one (e.g. if their work is already done)
+unsigned ProgressDlg::LastPhase()
+{
+	if (IsCancelled())
+		return 0;
+
+	const unsigned lastPhase = _countof(cPhases) - 1;
+
+	if (_phase < lastPhase)
+	{
+		_phase = lastPhase;
+		_phasePosOffset = cPhases[lastPhase - 1];
+		_phaseRange = cPhases[lastPhase] - _phasePosOffset;
+		_max = _phaseRange;
+		_count = 0;
+		setPos(_phasePosOffset);
+	}
+
+	return _phase + 1;
+}
+
+
 bool ProgressDlg::SetMaxCount(unsigned max, unsigned phase)
 {
 	if (IsCancelled())
@@ -60,6 +60,7 @@ public:
 	}
 
 	unsigned NextPhase();
+	unsigned LastPhase();
 	bool SetMaxCount(unsigned max, unsigned phase = 0);
 	bool SetCount(unsigned cnt, unsigned phase = 0);
 	bool Advance(unsigned cnt = 1, unsigned phase = 0);
@@ -24,6 +24,7 @@
 #define IDD_COLOR_POPUP				102
 #define IDD_SETTINGS_DIALOG			103
 #define IDD_NAV_DIALOG				104
+#define IDD_GIT_REVISION_DIALOG		105
 
 #define IDB_SETFIRST				120
 #define IDB_SETFIRST_RTL			121
@@ -69,6 +70,7 @@
 #define IDC_COMBO_HIGHLIGHT_COLOR	1034
 #define IDC_SPIN_BOX				1035
 #define IDC_SPIN_CTL				1036
+#define IDC_GIT_REVISION			1037
 #define IDC_STATIC					-1
 
 #define COLOR_POPUP_OK		10000
@@ -0,0 +1,220 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include "anchored_diff.h"
+#include "test.h"
+
+
+namespace {
+
+// Pre-aligned sequences element (a document line) - only its hash is compared
+struct Elem
+{
+	Elem(uint64_t h) : hash(h) {}
+
+	uint64_t hash;
+
+	inline bool operator==(const Elem& rhs) const
+	{
+		return (hash == rhs.hash);
+	}
+
+	inline bool operator!=(const Elem& rhs) const
+	{
+		return (hash != rhs.hash);
+	}
+};
+
+
+const int cHugeLen		= 16384;
+const int cHugeMaxCost	= 8 * 1024;
+
+
+// Checks that the differences cover both sequences exactly and returns the matched elements count (-1 if invalid)
+int matchedLen(const std::vector<Elem>& a, const std::vector<Elem>& b,
+		const std::pair<std::vector<diff_info<void>>, bool>& diffRes)
+{
+	const std::vector<Elem>& seq1 = diffRes.second ? b : a;
+	const std::vector<Elem>& seq2 = diffRes.second ? a : b;
+
+	int off1 = 0;
+	int off2 = 0;
+	int matched = 0;
+
+	for (const auto& diff: diffRes.first)
+	{
+		if (diff.type == diff_type::DIFF_MATCH)
+		{
+			for (int i = 0; i < diff.len; ++i)
+			{
+				if (seq1[off1 + i] != seq2[off2 + i])
+					return -1;
+			}
+
+			off1 += diff.len;
+			off2 += diff.len;
+			matched += diff.len;
+		}
+		else if (diff.type == diff_type::DIFF_IN_1)
+		{
+			off1 += diff.len;
+		}
+		else
+		{
+			off2 += diff.len;
+		}
+	}
+
+	if (off1 != static_cast<int>(seq1.size()) || off2 != static_cast<int>(seq2.size()))
+		return -1;
+
+	return matched;
+}
+
+
+// Huge documents of repeating lines - nothing to pre-align on and an edit cost over the huge documents cap
+void getHugeUnanchored(std::vector<Elem>& a, std::vector<Elem>& b)
+{
+	for (int i = 0; i < cHugeLen; ++i)
+	{
+		a.emplace_back(i % 2);
+		b.emplace_back(0);
+	}
+}
+
+
+// Huge documents of unique lines with a few edits
+void getHugeAnchored(std::vector<Elem>& a, std::vector<Elem>& b)
+{
+	for (int i = 0; i < cHugeLen; ++i)
+	{
+		a.emplace_back(i);
+
+		if (i % 5000 == 100)
+			b.emplace_back(cHugeLen + i);
+		else if (i % 5000 != 200)
+			b.emplace_back(i);
+	}
+}
+
+
+void testHugeUnanchoredExact()
+{
+	std::vector<Elem> a;
+	std::vector<Elem> b;
+
+	getHugeUnanchored(a, b);
+
+	const std::vector<seq_anchor> anchors = find_anchors(a, b);
+
+	CHECK(anchors.empty());
+
+	const auto diffRes = diff_pre_aligned<void>(a, b, anchors);
+
+	CHECK_EQ(matchedLen(a, b, diffRes), cHugeLen / 2);
+}
+
+
+void testHugeUnanchoredCapped()
+{
+	std::vector<Elem> a;
+	std::vector<Elem> b;
+
+	getHugeUnanchored(a, b);
+
+	const auto diffRes = diff_pre_aligned<void>(a, b, find_anchors(a, b), cHugeMaxCost);
+
+	CHECK(!diffRes.second);
+	CHECK_EQ(diffRes.first.size(), 2u);
+	CHECK_EQ(matchedLen(a, b, diffRes), 0);
+}
+
+
+void testHugeAnchored()
+{
+	std::vector<Elem> a;
+	std::vector<Elem> b;
+
+	getHugeAnchored(a, b);
+
+	const std::vector<seq_anchor> anchors = find_anchors(a, b);
+
+	CHECK(!anchors.empty());
+
+	for (size_t i = 1; i < anchors.size(); ++i)
+	{
+		CHECK(anchors[i].off1 >= anchors[i - 1].off1 + anchors[i - 1].len);
+		CHECK(anchors[i].off2 >= anchors[i - 1].off2 + anchors[i - 1].len);
+	}
+
+	const int exactLen = matchedLen(a, b, diff_pre_aligned<void>(a, b, std::vector<seq_anchor>()));
+
+	CHECK_EQ(matchedLen(a, b, diff_pre_aligned<void>(a, b, anchors)), exactLen);
+	CHECK_EQ(matchedLen(a, b, diff_pre_aligned<void>(a, b, anchors, cHugeMaxCost)), exactLen);
+}
+
+
+// Elements owned elsewhere (like mapped file arrays) are diffed the same way
+void testView()
+{
+	std::vector<Elem> a;
+	std::vector<Elem> b;
+
+	getHugeAnchored(a, b);
+
+	const seq_view<Elem> viewA(a.data(), a.size());
+	const seq_view<Elem> viewB(b.data(), b.size());
+
+	const std::vector<seq_anchor> anchors = find_anchors(viewA, viewB);
+
+	CHECK_EQ(anchors.size(), find_anchors(a, b).size());
+
+	const auto diffRes = diff_pre_aligned<void>(viewA, viewB, anchors, cHugeMaxCost);
+
+	CHECK_EQ(matchedLen(a, b, diffRes), matchedLen(a, b, diff_pre_aligned<void>(a, b, anchors, cHugeMaxCost)));
+}
+
+
+void testCancelled()
+{
+	std::vector<Elem> a;
+	std::vector<Elem> b;
+
+	getHugeUnanchored(a, b);
+
+	const auto diffRes = diff_pre_aligned<void>(a, b, find_anchors(a, b), INT_MAX, []() { return true; });
+
+	CHECK(diffRes.first.empty());
+}
+
+} // anonymous namespace
+
+
+int main()
+{
+	RUN_TEST(testHugeUnanchoredExact);
+	RUN_TEST(testHugeUnanchoredCapped);
+	RUN_TEST(testHugeAnchored);
+	RUN_TEST(testView);
+	RUN_TEST(testCancelled);
+
+	return TESTS_RESULT();
+}
@@ -0,0 +1,165 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Line diff and words segmentation timings over the synthetic compare corpus - not run by the tests:
+ *   corpus_bench [spec name]
+ *
+ * The line diff is a plain DiffCalc over the whole texts - without the engine anchoring on unique lines - so it
+ * shows the worst case diff cost of each pattern. The lines are hashed whole (no compare options). The engine
+ * hashing, moves detection and blocks compare are timed on the same corpus by the "Benchmark Compare Corpus"
+ * command of the debug plugin build.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "corpus_gen.h"
+#include "diff.h"
+#include "wordseg.h"
+
+
+namespace {
+
+struct Timer
+{
+	Timer() : start(std::chrono::steady_clock::now()) {}
+
+	double ms() const
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	const std::chrono::steady_clock::time_point start;
+};
+
+
+// FNV-1a 64 of each line (CRLF line endings are not part of the line)
+std::vector<uint64_t> hashLines(const std::string& text)
+{
+	std::vector<uint64_t> hashes;
+
+	uint64_t hash = 0xCBF29CE484222325ULL;
+
+	for (size_t i = 0; i < text.size(); ++i)
+	{
+		if (text[i] == '\n')
+		{
+			hashes.push_back(hash);
+			hash = 0xCBF29CE484222325ULL;
+		}
+		else if (text[i] != '\r')
+		{
+			hash = (hash ^ static_cast<unsigned char>(text[i])) * 0x100000001B3ULL;
+		}
+	}
+
+	hashes.push_back(hash);
+
+	return hashes;
+}
+
+
+size_t countWords(const std::string& text)
+{
+	const char* const data = text.data();
+	const int size = static_cast<int>(text.size());
+
+	size_t words = 0;
+
+	for (int pos = 0; pos < size;)
+	{
+		int end = pos;
+
+		while (end < size && data[end] != '\r' && data[end] != '\n')
+			++end;
+
+		segment_words(data + pos, end - pos, [&words](int, int, char_type) { ++words; });
+
+		pos = (end < size && data[end] == '\r') ? end + 2 : end + 1;
+	}
+
+	return words;
+}
+
+
+void run(const corpus_spec& spec)
+{
+	std::string text1;
+	std::string text2;
+
+	Timer genTimer;
+
+	generate_corpus_pair(spec, text1, text2);
+
+	const double genMs = genTimer.ms();
+
+	Timer hashTimer;
+
+	const std::vector<uint64_t> lines1 = hashLines(text1);
+	const std::vector<uint64_t> lines2 = hashLines(text2);
+
+	const double hashMs = hashTimer.ms();
+
+	Timer diffTimer;
+
+	DiffCalc<uint64_t> diffCalc(lines1, lines2);
+
+	const std::pair<std::vector<diff_info<void>>, bool> diffRes = diffCalc();
+
+	const double diffMs = diffTimer.ms();
+
+	size_t diffLines = 0;
+
+	for (const auto& diff: diffRes.first)
+	{
+		if (diff.type != diff_type::DIFF_MATCH)
+			diffLines += diff.len;
+	}
+
+	Timer wordsTimer;
+
+	const size_t words = countWords(text1) + countWords(text2);
+
+	const double wordsMs = wordsTimer.ms();
+
+	std::printf("%-16s %7zu/%-7zu lines %8.2f MB  gen %8.1f ms  hash %7.1f ms  diff %8.1f ms (%7zu lines, "
+			"%10llu diagonals)  words %7.1f ms (%zu)\n",
+			spec.name, lines1.size(), lines2.size(), (text1.size() + text2.size()) / (1024.0 * 1024.0),
+			genMs, hashMs, diffMs, diffLines, static_cast<unsigned long long>(diffCalc.diagonals()),
+			wordsMs, words);
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char* argv[])
+{
+	const char* const only = (argc > 1) ? argv[1] : nullptr;
+
+	for (size_t i = 0; i < corpus_specs_count; ++i)
+	{
+		if (!only || !std::strcmp(only, corpus_specs[i].name))
+			run(corpus_specs[i]);
+	}
+
+	return 0;
+}
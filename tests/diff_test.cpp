@@ -0,0 +1,187 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <vector>
+
+#include "diff.h"
+#include "test.h"
+
+
+namespace {
+
+// Checks that the differences cover both sequences exactly and that the matches are real
+bool isValidDiff(const std::vector<int>& a, const std::vector<int>& b,
+		const std::pair<std::vector<diff_info<void>>, bool>& diffRes)
+{
+	const std::vector<int>& seq1 = diffRes.second ? b : a;
+	const std::vector<int>& seq2 = diffRes.second ? a : b;
+
+	int off1 = 0;
+	int off2 = 0;
+
+	for (const auto& diff: diffRes.first)
+	{
+		if (diff.type == diff_type::DIFF_MATCH)
+		{
+			for (int i = 0; i < diff.len; ++i)
+			{
+				if (seq1[off1 + i] != seq2[off2 + i])
+					return false;
+			}
+
+			off1 += diff.len;
+			off2 += diff.len;
+		}
+		else if (diff.type == diff_type::DIFF_IN_1)
+		{
+			off1 += diff.len;
+		}
+		else
+		{
+			off2 += diff.len;
+		}
+	}
+
+	return (off1 == static_cast<int>(seq1.size()) && off2 == static_cast<int>(seq2.size()));
+}
+
+
+void testIdentical()
+{
+	const std::vector<int> a { 1, 2, 3, 4, 5 };
+
+	DiffCalc<int> diffCalc(a, a);
+	const auto diffRes = diffCalc();
+
+	CHECK(!diffCalc.capped());
+	CHECK_EQ(diffRes.first.size(), 1u);
+	CHECK(diffRes.first[0].type == diff_type::DIFF_MATCH);
+	CHECK_EQ(diffRes.first[0].len, 5);
+}
+
+
+void testSmallEdits()
+{
+	const std::vector<int> a { 1, 2, 3, 4, 5, 6, 7, 8 };
+	const std::vector<int> b { 1, 2, 9, 4, 5, 7, 8, 10 };
+
+	DiffCalc<int> diffCalc(a, b);
+	const auto diffRes = diffCalc();
+
+	CHECK(!diffCalc.capped());
+	CHECK(isValidDiff(a, b, diffRes));
+}
+
+
+// Regression - capped compare of equal length sequences used to re-compare them swapped and read the first
+// stored difference out of an empty list
+void testCappedEqualLengths()
+{
+	std::vector<int> a(5000);
+	std::vector<int> b(5000);
+
+	for (int i = 0; i < 5000; ++i)
+	{
+		a[i] = i;
+		b[i] = i + 5000;
+	}
+
+	DiffCalc<int> diffCalc(a, b, 64);
+	diffCalc();
+
+	CHECK(diffCalc.capped());
+}
+
+
+void testCappedEqualLengthsWithCommonPrefix()
+{
+	std::vector<int> a(5000);
+	std::vector<int> b(5000);
+
+	for (int i = 0; i < 5000; ++i)
+	{
+		a[i] = i;
+		b[i] = (i < 100 || i % 3 == 0) ? i : -i;
+	}
+
+	DiffCalc<int> diffCalc(a, b, 16);
+	const auto diffRes = diffCalc();
+
+	CHECK(diffCalc.capped());
+	CHECK(!diffRes.first.empty());
+	CHECK(diffRes.first[0].type == diff_type::DIFF_MATCH);
+	CHECK_EQ(diffRes.first[0].len, 100);
+}
+
+
+void testCapNotReached()
+{
+	std::vector<int> a(1000);
+	std::vector<int> b(1000);
+
+	for (int i = 0; i < 1000; ++i)
+	{
+		a[i] = i;
+		b[i] = (i % 100) ? i : -i;
+	}
+
+	DiffCalc<int> diffCalc(a, b, 64);
+	const auto diffRes = diffCalc();
+
+	CHECK(!diffCalc.capped());
+	CHECK(isValidDiff(a, b, diffRes));
+}
+
+
+void testCancelled()
+{
+	std::vector<int> a(20000);
+	std::vector<int> b(20000);
+
+	for (int i = 0; i < 20000; ++i)
+	{
+		a[i] = i;
+		b[i] = (i % 2) ? i : -i;
+	}
+
+	int checks = 0;
+
+	DiffCalc<int> diffCalc(a, b);
+	diffCalc.setCancelCheck([&checks]() { return (++checks == 2); });
+
+	const auto diffRes = diffCalc();
+
+	CHECK(diffCalc.cancelled());
+	CHECK(diffRes.first.empty());
+	CHECK_EQ(checks, 2);
+}
+
+} // anonymous namespace
+
+
+int main()
+{
+	RUN_TEST(testIdentical);
+	RUN_TEST(testSmallEdits);
+	RUN_TEST(testCappedEqualLengths);
+	RUN_TEST(testCappedEqualLengthsWithCommonPrefix);
+	RUN_TEST(testCapNotReached);
+	RUN_TEST(testCancelled);
+
+	return TESTS_RESULT();
+}
@@ -0,0 +1,207 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <vector>
+
+#include "diffmap.h"
+#include "test.h"
+
+
+namespace {
+
+const uint32_t palette[map_types_count] = { 0, 1, 2, 3, 4 };
+
+
+inline uint32_t clr(map_type type)
+{
+	return palette[static_cast<int>(type)];
+}
+
+
+void testAddRunMerges()
+{
+	diff_map_t map;
+
+	add_map_run(map, 0, 2, map_type::MAP_ADDED);
+	add_map_run(map, 2, 3, map_type::MAP_ADDED);
+
+	CHECK_EQ(map.size(), 1u);
+	CHECK_EQ(map[0].line, 0);
+	CHECK_EQ(map[0].len, 5);
+
+	// Different type or a gap - new run
+	add_map_run(map, 5, 1, map_type::MAP_CHANGED);
+	add_map_run(map, 8, 1, map_type::MAP_CHANGED);
+
+	CHECK_EQ(map.size(), 3u);
+
+	// Empty and no-diff runs are skipped
+	add_map_run(map, 9, 0, map_type::MAP_CHANGED);
+	add_map_run(map, 9, 4, map_type::MAP_NONE);
+
+	CHECK_EQ(map.size(), 3u);
+}
+
+
+void testNormalize()
+{
+	diff_map_t map;
+
+	map.emplace_back(10, 5, map_type::MAP_ADDED);
+	map.emplace_back(0, 4, map_type::MAP_REMOVED);
+	map.emplace_back(4, 2, map_type::MAP_REMOVED);
+	map.emplace_back(12, 6, map_type::MAP_ADDED);
+	map.emplace_back(30, 2, map_type::MAP_MOVED);
+	map.emplace_back(31, 1, map_type::MAP_MOVED);
+
+	normalize_diff_map(map);
+
+	CHECK_EQ(map.size(), 3u);
+
+	// Adjacent runs of the same type merged
+	CHECK_EQ(map[0].line, 0);
+	CHECK_EQ(map[0].len, 6);
+	CHECK(map[0].type == map_type::MAP_REMOVED);
+
+	// Overlapping run clipped and merged
+	CHECK_EQ(map[1].line, 10);
+	CHECK_EQ(map[1].len, 8);
+
+	// Fully covered run dropped
+	CHECK_EQ(map[2].line, 30);
+	CHECK_EQ(map[2].len, 2);
+}
+
+
+void testRasterizeOneLinePerRow()
+{
+	diff_map_t map;
+
+	add_map_run(map, 1, 2, map_type::MAP_ADDED);
+	add_map_run(map, 4, 1, map_type::MAP_CHANGED);
+
+	std::vector<uint32_t> pixels;
+	rasterize_diff_map(map, 6, 1, palette, pixels);
+
+	const std::vector<uint32_t> expected { clr(map_type::MAP_NONE), clr(map_type::MAP_ADDED),
+			clr(map_type::MAP_ADDED), clr(map_type::MAP_NONE), clr(map_type::MAP_CHANGED), clr(map_type::MAP_NONE) };
+
+	CHECK(pixels == expected);
+}
+
+
+// A row shared by several runs gets the highest priority type whatever the runs order
+void testRasterizeTypePriority()
+{
+	std::vector<uint32_t> pixels;
+
+	{
+		diff_map_t map;
+
+		add_map_run(map, 0, 1, map_type::MAP_MOVED);
+		add_map_run(map, 1, 1, map_type::MAP_CHANGED);
+		add_map_run(map, 2, 1, map_type::MAP_REMOVED);
+
+		rasterize_diff_map(map, 8, 4, palette, pixels);
+
+		CHECK_EQ(pixels.size(), 2u);
+		CHECK_EQ(pixels[0], clr(map_type::MAP_CHANGED));
+		CHECK_EQ(pixels[1], clr(map_type::MAP_NONE));
+	}
+
+	{
+		diff_map_t map;
+
+		add_map_run(map, 0, 1, map_type::MAP_CHANGED);
+		add_map_run(map, 1, 2, map_type::MAP_MOVED);
+		add_map_run(map, 3, 3, map_type::MAP_ADDED);
+
+		rasterize_diff_map(map, 8, 4, palette, pixels);
+
+		CHECK_EQ(pixels.size(), 2u);
+		CHECK_EQ(pixels[0], clr(map_type::MAP_CHANGED));
+		CHECK_EQ(pixels[1], clr(map_type::MAP_ADDED));
+	}
+}
+
+
+// No diff is lost on downscaling - a single line diff colors its whole row
+void testRasterizeDownscaledSingleLine()
+{
+	diff_map_t map;
+
+	add_map_run(map, 999, 1, map_type::MAP_REMOVED);
+
+	std::vector<uint32_t> pixels;
+	rasterize_diff_map(map, 1000, 100, palette, pixels);
+
+	CHECK_EQ(pixels.size(), 10u);
+	CHECK_EQ(pixels[9], clr(map_type::MAP_REMOVED));
+
+	for (int i = 0; i < 9; ++i)
+		CHECK_EQ(pixels[i], clr(map_type::MAP_NONE));
+}
+
+
+void testRasterizeLineOffsetAndClip()
+{
+	diff_map_t map;
+
+	add_map_run(map, 0, 1, map_type::MAP_ADDED);
+	add_map_run(map, 3, 10, map_type::MAP_CHANGED);
+
+	std::vector<uint32_t> pixels;
+	rasterize_diff_map(map, 5, 1, palette, pixels, 1);
+
+	const std::vector<uint32_t> expected { clr(map_type::MAP_NONE), clr(map_type::MAP_ADDED),
+			clr(map_type::MAP_NONE), clr(map_type::MAP_NONE), clr(map_type::MAP_CHANGED) };
+
+	CHECK(pixels == expected);
+
+	rasterize_diff_map(map, 0, 1, palette, pixels);
+
+	CHECK(pixels.empty());
+}
+
+
+void testInvalidation()
+{
+	CHECK(is_diff_map_valid(100, 100));
+	CHECK(is_diff_map_valid(100, 101, 1));
+
+	// Lines added or removed since the compare
+	CHECK(!is_diff_map_valid(100, 101));
+	CHECK(!is_diff_map_valid(100, 99));
+	CHECK(!is_diff_map_valid(100, 100, 1));
+}
+
+} // anonymous namespace
+
+
+int main()
+{
+	RUN_TEST(testAddRunMerges);
+	RUN_TEST(testNormalize);
+	RUN_TEST(testRasterizeOneLinePerRow);
+	RUN_TEST(testRasterizeTypePriority);
+	RUN_TEST(testRasterizeDownscaledSingleLine);
+	RUN_TEST(testRasterizeLineOffsetAndClip);
+	RUN_TEST(testInvalidation);
+
+	return TESTS_RESULT();
+}
@@ -0,0 +1,447 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <algorithm>
+
+#include "folder_compare.h"
+#include "diff.h"
+#include "test.h"
+
+
+namespace {
+
+uint64_t hashText(const std::string& text)
+{
+	uint64_t hash = 0xCBF29CE484222325ULL;
+
+	for (char ch: text)
+		hash = (hash ^ static_cast<unsigned char>(ch)) * 0x100000001B3ULL;
+
+	return hash;
+}
+
+
+std::vector<uint64_t> linesHashes(const std::string& text)
+{
+	std::vector<uint64_t> hashes;
+
+	size_t pos = 0;
+
+	while (pos < text.size())
+	{
+		size_t end = text.find('\n', pos);
+
+		if (end == std::string::npos)
+			end = text.size();
+
+		hashes.push_back(hashText(text.substr(pos, end - pos)));
+
+		pos = end + 1;
+	}
+
+	return hashes;
+}
+
+
+/**
+ *  \class  MemoryPlatform
+ *  \brief  In-memory folders (full path to content) - records the calls the folders compare makes
+ */
+class MemoryPlatform : public folder_compare_platform
+{
+public:
+	std::map<std::wstring, std::string>	files;
+	std::set<std::wstring>				unreadableDirs;
+
+	int		hashedFiles {0};
+	int		comparedPairs {0};
+	int		phases {0};
+	bool	cancelled {false};
+
+	// Tasks are finished in reverse order
+	bool	reverseTasks {false};
+
+	std::vector<uint64_t>	taskLoads;
+
+	virtual bool list_files(const std::wstring& dir, std::vector<folder_file>& list)
+	{
+		if (unreadableDirs.count(dir))
+			return false;
+
+		for (const auto& file: files)
+		{
+			if (file.first.compare(0, dir.size(), dir) == 0)
+				list.emplace_back(file.first.substr(dir.size()), file.second.size());
+		}
+
+		return true;
+	}
+
+	virtual bool file_hash(const std::wstring& file, uint64_t& hash)
+	{
+		auto found = files.find(file);
+
+		if (found == files.end())
+			return false;
+
+		++hashedFiles;
+		hash = hashText(found->second);
+
+		return true;
+	}
+
+	virtual std::vector<uint64_t> file_lines_set(const std::wstring& file)
+	{
+		std::vector<uint64_t> linesSet = linesHashes(files[file]);
+
+		std::sort(linesSet.begin(), linesSet.end());
+		linesSet.erase(std::unique(linesSet.begin(), linesSet.end()), linesSet.end());
+
+		return linesSet;
+	}
+
+	virtual void compare_file_lines(const std::wstring& file1, const std::wstring& file2, FolderCompareItem& item)
+	{
+		++comparedPairs;
+
+		const std::vector<uint64_t> lines1 = linesHashes(files[file1]);
+		const std::vector<uint64_t> lines2 = linesHashes(files[file2]);
+
+		DiffCalc<uint64_t> diffCalc(lines1, lines2);
+
+		const auto diffRes = diffCalc(false);
+
+		item.removedLines	= 0;
+		item.addedLines		= 0;
+
+		for (const auto& diff: diffRes.first)
+		{
+			if (diff.type == diff_type::DIFF_MATCH)
+				continue;
+
+			if ((diff.type == diff_type::DIFF_IN_1) != diffRes.second)
+				item.removedLines += diff.len;
+			else
+				item.addedLines += diff.len;
+		}
+
+		item.state = (item.removedLines || item.addedLines) ? FolderItemState::MISMATCH : FolderItemState::MATCH;
+	}
+
+	virtual bool run_tasks(const std::vector<uint64_t>& loads, const std::function<void(size_t task)>& runTask,
+			const std::function<void(size_t task)>& taskDone)
+	{
+		taskLoads = loads;
+
+		for (size_t i = 0; i < loads.size(); ++i)
+		{
+			if (cancelled)
+				return false;
+
+			const size_t task = reverseTasks ? loads.size() - 1 - i : i;
+
+			runTask(task);
+			taskDone(task);
+		}
+
+		return true;
+	}
+
+	virtual bool next_phase()
+	{
+		++phases;
+		return !cancelled;
+	}
+
+	virtual void set_progress_max(unsigned) {}
+
+	virtual bool advance_progress()
+	{
+		return !cancelled;
+	}
+
+	virtual bool is_cancelled()
+	{
+		return cancelled;
+	}
+};
+
+
+const FolderCompareItem* findItem(const FoldersCompareSummary& summary, const std::wstring& path)
+{
+	for (const auto& item: summary.items)
+	{
+		if (item.path1 == path || (item.path1.empty() && item.path2 == path))
+			return &item;
+	}
+
+	return nullptr;
+}
+
+
+void testPairByPath()
+{
+	MemoryPlatform platform;
+
+	platform.files[L"a/same.txt"]		= "one\ntwo\n";
+	platform.files[L"b/same.txt"]		= "one\ntwo\n";
+	platform.files[L"a/sub/Case.txt"]	= "x\n";
+	platform.files[L"b/sub/case.TXT"]	= "x\n";
+	platform.files[L"a/changed.txt"]	= "one\ntwo\nthree\n";
+	platform.files[L"b/changed.txt"]	= "one\n2\nthree\nfour\n";
+	platform.files[L"a/old.txt"]		= "old\n";
+	platform.files[L"b/new.txt"]		= "new\n";
+
+	FoldersCompareSummary summary;
+
+	CHECK(compare_folders(L"a/", L"b/", false, 50, platform, summary) == folders_compare_result::MISMATCH);
+
+	CHECK_EQ(summary.filesCount1, 4);
+	CHECK_EQ(summary.filesCount2, 4);
+	CHECK_EQ(summary.items.size(), 5u);
+	CHECK_EQ(platform.phases, 4);
+
+	// Paths are paired case insensitively
+	const FolderCompareItem* item = findItem(summary, L"sub/Case.txt");
+
+	CHECK(item && item->path2 == L"sub/case.TXT" && item->state == FolderItemState::MATCH);
+
+	item = findItem(summary, L"same.txt");
+
+	CHECK(item && item->state == FolderItemState::MATCH);
+
+	item = findItem(summary, L"changed.txt");
+
+	CHECK(item && item->state == FolderItemState::MISMATCH);
+	CHECK(item && item->removedLines == 1 && item->addedLines == 2);
+
+	item = findItem(summary, L"old.txt");
+
+	CHECK(item && item->state == FolderItemState::ONLY_IN_1 && item->path2.empty());
+
+	item = findItem(summary, L"new.txt");
+
+	CHECK(item && item->state == FolderItemState::ONLY_IN_2);
+
+	// Equal size pairs are matched by their whole content hashes - the changed pair is the only one compared by lines
+	CHECK_EQ(platform.comparedPairs, 1);
+
+	// Items are sorted by path
+	for (size_t i = 1; i < summary.items.size(); ++i)
+	{
+		const FolderCompareItem& prev = summary.items[i - 1];
+		const FolderCompareItem& next = summary.items[i];
+
+		CHECK(compare_paths_nocase(prev.path1.empty() ? prev.path2 : prev.path1,
+				next.path1.empty() ? next.path2 : next.path1) < 0);
+	}
+
+	// Compare tasks loads are the files pairs sizes
+	CHECK_EQ(platform.taskLoads.size(), 3u);
+}
+
+
+void testMatchingFolders()
+{
+	MemoryPlatform platform;
+
+	platform.files[L"a/x.txt"]	= "x\n";
+	platform.files[L"b/X.txt"]	= "x\n";
+	platform.files[L"a/y.txt"]	= "y\ny\n";
+	platform.files[L"b/y.txt"]	= "y\ny\n";
+
+	FoldersCompareSummary summary;
+
+	CHECK(compare_folders(L"a/", L"b/", true, 50, platform, summary) == folders_compare_result::MATCH);
+	CHECK_EQ(platform.comparedPairs, 0);
+}
+
+
+void testRenames()
+{
+	MemoryPlatform platform;
+
+	const std::string lines = "1\n2\n3\n4\n5\n6\n7\n8\n9\n10\n";
+
+	platform.files[L"a/moved.txt"]		= "moved content\n";
+	platform.files[L"b/dir/moved.txt"]	= "moved content\n";
+	platform.files[L"a/edited.txt"]		= lines;
+	platform.files[L"b/renamed.txt"]	= lines + "11\n";
+	platform.files[L"a/gone.txt"]		= "gone\n";
+	platform.files[L"b/other.txt"]		= "something else\n";
+	platform.files[L"a/empty1.txt"]		= "";
+	platform.files[L"b/empty2.txt"]		= "";
+
+	FoldersCompareSummary summary;
+
+	CHECK(compare_folders(L"a/", L"b/", true, 50, platform, summary) == folders_compare_result::MISMATCH);
+
+	// Equal content - paired and matching without a lines compare
+	const FolderCompareItem* item = findItem(summary, L"moved.txt");
+
+	CHECK(item && item->path2 == L"dir/moved.txt" && item->state == FolderItemState::MATCH);
+
+	// Similar lines - paired and compared
+	item = findItem(summary, L"edited.txt");
+
+	CHECK(item && item->path2 == L"renamed.txt" && item->state == FolderItemState::MISMATCH);
+	CHECK(item && item->removedLines == 0 && item->addedLines == 1);
+	CHECK_EQ(platform.comparedPairs, 1);
+
+	// Dissimilar and empty files are not paired
+	item = findItem(summary, L"gone.txt");
+
+	CHECK(item && item->state == FolderItemState::ONLY_IN_1);
+
+	item = findItem(summary, L"empty1.txt");
+
+	CHECK(item && item->state == FolderItemState::ONLY_IN_1);
+
+	item = findItem(summary, L"empty2.txt");
+
+	CHECK(item && item->state == FolderItemState::ONLY_IN_2);
+
+	// Without renames detection they are all only in one of the folders
+	MemoryPlatform platform2;
+
+	platform2.files = platform.files;
+
+	FoldersCompareSummary summary2;
+
+	CHECK(compare_folders(L"a/", L"b/", false, 50, platform2, summary2) == folders_compare_result::MISMATCH);
+	CHECK_EQ(summary2.items.size(), 8u);
+	CHECK_EQ(platform2.comparedPairs, 0);
+}
+
+
+void testListingFailureAndCancel()
+{
+	MemoryPlatform platform;
+
+	platform.files[L"a/x.txt"] = "x\n";
+	platform.files[L"b/x.txt"] = "y\n";
+
+	platform.unreadableDirs.insert(L"b/");
+
+	FoldersCompareSummary summary;
+
+	CHECK(compare_folders(L"a/", L"b/", false, 50, platform, summary) == folders_compare_result::FAILED);
+
+	platform.unreadableDirs.clear();
+	platform.cancelled = true;
+
+	FoldersCompareSummary summary2;
+
+	CHECK(compare_folders(L"a/", L"b/", false, 50, platform, summary2) == folders_compare_result::CANCELLED);
+	CHECK_EQ(platform.comparedPairs, 0);
+}
+
+
+void testStreamedItems()
+{
+	for (bool reverseTasks: { false, true })
+	{
+		MemoryPlatform platform;
+
+		platform.reverseTasks = reverseTasks;
+
+		platform.files[L"a/1.txt"]	= "one\n";
+		platform.files[L"b/1.txt"]	= "one\n1\n";
+		platform.files[L"a/2.txt"]	= "two\n";
+		platform.files[L"a/3.txt"]	= "three\n";
+		platform.files[L"b/3.txt"]	= "three\n3\n";
+		platform.files[L"b/4.txt"]	= "four\n";
+		platform.files[L"a/5.txt"]	= "five\n";
+		platform.files[L"b/5.txt"]	= "five\n";
+
+		FoldersCompareSummary summary;
+
+		std::vector<std::wstring> passedPaths;
+		std::vector<int> comparedBefore;
+
+		CHECK(compare_folders(L"a/", L"b/", false, 50, platform, summary,
+				[&](const FolderCompareItem& item)
+				{
+					passedPaths.emplace_back(item.path1.empty() ? item.path2 : item.path1);
+					comparedBefore.emplace_back(platform.comparedPairs);
+
+					// Passed items are final
+					CHECK(item.state != FolderItemState::COMPARE_ERROR);
+				}) == folders_compare_result::MISMATCH);
+
+		CHECK_EQ(platform.comparedPairs, 2);
+
+		// All items are passed once in the summary order
+		CHECK_EQ(passedPaths.size(), summary.items.size());
+
+		for (size_t i = 0; i < passedPaths.size() && i < summary.items.size(); ++i)
+		{
+			const FolderCompareItem& item = summary.items[i];
+
+			CHECK(passedPaths[i] == (item.path1.empty() ? item.path2 : item.path1));
+		}
+
+		// Compared in listing order the first items are passed on before the last compare - in reverse order they
+		// wait for the first compared pair
+		CHECK(passedPaths.size() == 5u && comparedBefore[0] == (reverseTasks ? 2 : 1));
+	}
+}
+
+
+void testPathsOrder()
+{
+	CHECK_EQ(compare_paths_nocase(L"abc", L"ABC"), 0);
+	CHECK(compare_paths_nocase(L"ab", L"abc") < 0);
+	CHECK(compare_paths_nocase(L"B", L"a") > 0);
+
+	// Non-ASCII letters are folded as well
+	CHECK_EQ(compare_paths_nocase(L"Été", L"éTÉ"), 0);
+}
+
+
+void testLinesSetsSimilarity()
+{
+	const std::vector<uint64_t> set1 = { 1, 2, 3, 4 };
+	const std::vector<uint64_t> set2 = { 2, 3, 4, 5, 6, 7, 8, 9 };
+
+	CHECK_EQ(lines_sets_similarity(set1, set1), 100);
+	CHECK_EQ(lines_sets_similarity(set1, set2), 37);
+	CHECK_EQ(lines_sets_similarity(set1, std::vector<uint64_t>()), 0);
+	CHECK_EQ(lines_sets_similarity(std::vector<uint64_t>(), std::vector<uint64_t>()), 0);
+}
+
+} // anonymous namespace
+
+
+int main()
+{
+	RUN_TEST(testPairByPath);
+	RUN_TEST(testMatchingFolders);
+	RUN_TEST(testRenames);
+	RUN_TEST(testListingFailureAndCancel);
+	RUN_TEST(testStreamedItems);
+	RUN_TEST(testPathsOrder);
+	RUN_TEST(testLinesSetsSimilarity);
+
+	return TESTS_RESULT();
+}
@@ -0,0 +1,57 @@
+#!/bin/sh
+#
+# Creates the local Git repository the "Benchmark Git Diff..." command of the debug plugin build runs on:
+#   make_git_test_repo.sh <new repository dir> [files count]
+#
+# The base commit adds the files (200 lines each). Each of the next 8 commits appends a "change N" line (N is the
+# commit number) to every 8th file, so each file is changed in exactly one of them.
+
+set -e
+
+if [ -z "$1" ]; then
+	echo "Usage: $0 <new repository dir> [files count]" >&2
+	exit 1
+fi
+
+dir=$1
+files=${2:-5000}
+commits=8
+
+git init -q "$dir"
+cd "$dir"
+
+# Blobs are checked byte for byte against the work files
+git config core.autocrlf false
+git config user.name "Compare plugin"
+git config user.email "compare@localhost"
+
+mkdir -p src
+
+awk -v files="$files" 'BEGIN {
+	for (i = 0; i < files; ++i) {
+		file = sprintf("src/file%05d.txt", i)
+		for (line = 0; line < 200; ++line)
+			printf("Line %d of file %d - some text to compare %d\n", line, i, (i * 31 + line * 17) % 1000) > file
+		close(file)
+	}
+}'
+
+git add -A
+git commit -q -m "Base"
+
+commit=1
+
+while [ $commit -le $commits ]; do
+	awk -v files="$files" -v commits="$commits" -v commit="$commit" 'BEGIN {
+		for (i = commit - 1; i < files; i += commits) {
+			file = sprintf("src/file%05d.txt", i)
+			printf("change %d\n", commit) >> file
+			close(file)
+		}
+	}'
+
+	git commit -q -a -m "Change $commit"
+	commit=$((commit + 1))
+done
+
+echo "$dir: $files files, $commits commits after the base one"
@@ -0,0 +1,231 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Three-way merge timings over generated base, ours and theirs texts of growing size up to 1M lines - not run by the
+ * tests:
+ *   merge_bench [max lines]
+ *
+ * Both sides are diffed against the base the way the engine does it (pre-aligned on unique chunks) and then merged.
+ * The merge time per base line should stay about flat as the size doubles.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include "corpus_gen.h"
+#include "anchored_diff.h"
+#include "three_way_merge.h"
+
+
+namespace {
+
+struct BenchLine
+{
+	uint64_t hash;
+
+	inline bool operator==(const BenchLine& rhs) const
+	{
+		return (hash == rhs.hash);
+	}
+
+	inline bool operator!=(const BenchLine& rhs) const
+	{
+		return (hash != rhs.hash);
+	}
+};
+
+} // anonymous namespace
+
+
+template <>
+struct diff_key<BenchLine>
+{
+	static const bool plain = true;
+
+	typedef uint64_t type;
+
+	static inline type get(const BenchLine& elem)
+	{
+		return elem.hash;
+	}
+};
+
+
+namespace {
+
+struct Timer
+{
+	Timer() : start(std::chrono::steady_clock::now()) {}
+
+	double ms() const
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	const std::chrono::steady_clock::time_point start;
+};
+
+
+// FNV-1a 64 of each line (CRLF line endings are not part of the line)
+std::vector<BenchLine> hashLines(const std::string& text)
+{
+	std::vector<BenchLine> lines;
+
+	BenchLine line { 0xCBF29CE484222325ULL };
+
+	for (size_t i = 0; i < text.size(); ++i)
+	{
+		if (text[i] == '\n')
+		{
+			lines.push_back(line);
+			line.hash = 0xCBF29CE484222325ULL;
+		}
+		else if (text[i] != '\r')
+		{
+			line.hash = (line.hash ^ static_cast<unsigned char>(text[i])) * 0x100000001B3ULL;
+		}
+	}
+
+	lines.push_back(line);
+
+	return lines;
+}
+
+
+// Side changes against the base - the diff is pre-aligned the way the engine diffs huge documents
+std::vector<merge_hunk> diffSide(const std::vector<BenchLine>& base, const std::vector<BenchLine>& side)
+{
+	const auto diffRes = diff_pre_aligned<void>(base, side, find_anchors(base, side));
+
+	std::vector<merge_hunk> hunks;
+
+	int idx1 = 0;
+	int idx2 = 0;
+
+	for (size_t i = 0; i < diffRes.first.size(); ++i)
+	{
+		if (diffRes.first[i].type == diff_type::DIFF_MATCH)
+		{
+			idx1 += diffRes.first[i].len;
+			idx2 += diffRes.first[i].len;
+			continue;
+		}
+
+		merge_hunk hunk;
+
+		hunk.base = merge_range(idx1, 0);
+		hunk.side = merge_range(idx2, 0);
+
+		for (; i < diffRes.first.size() && diffRes.first[i].type != diff_type::DIFF_MATCH; ++i)
+		{
+			if (diffRes.first[i].type == diff_type::DIFF_IN_1)
+				hunk.base.len += diffRes.first[i].len;
+			else
+				hunk.side.len += diffRes.first[i].len;
+		}
+
+		--i;
+
+		if (diffRes.second)
+			std::swap(hunk.base, hunk.side);
+
+		hunks.emplace_back(hunk);
+
+		idx1 += diffRes.second ? hunk.side.len : hunk.base.len;
+		idx2 += diffRes.second ? hunk.base.len : hunk.side.len;
+	}
+
+	return hunks;
+}
+
+
+void run(int linesCount, double& prevNsPerLine)
+{
+	// Code-like lines with moved blocks, reordered sections and scattered edits on each side
+	const corpus_spec spec = { "three_way", 1011, corpus_pattern::TEXT, linesCount, 0, 100, 5, 10, 30, 2, 2, 2 };
+
+	std::string baseText;
+	std::string oursText;
+	std::string theirsText;
+
+	generate_corpus_three_way(spec, baseText, oursText, theirsText);
+
+	const std::vector<BenchLine> base	= hashLines(baseText);
+	const std::vector<BenchLine> ours	= hashLines(oursText);
+	const std::vector<BenchLine> theirs	= hashLines(theirsText);
+
+	Timer diffTimer;
+
+	const std::vector<merge_hunk> hunks1 = diffSide(base, ours);
+	const std::vector<merge_hunk> hunks2 = diffSide(base, theirs);
+
+	const double diffMs = diffTimer.ms();
+
+	Timer mergeTimer;
+
+	const std::vector<merge_region> regions = merge_changes(hunks1, hunks2, static_cast<int>(base.size()),
+			[&](const merge_range& oursLines, const merge_range& theirsLines)
+			{
+				return (oursLines.len == theirsLines.len &&
+						std::equal(ours.begin() + oursLines.off, ours.begin() + oursLines.off + oursLines.len,
+								theirs.begin() + theirsLines.off));
+			});
+
+	const double mergeMs = mergeTimer.ms();
+
+	size_t conflicts = 0;
+
+	for (const auto& region: regions)
+	{
+		if (region.type == MergeRegionType::CONFLICT)
+			++conflicts;
+	}
+
+	const double nsPerLine = mergeMs * 1000000.0 / base.size();
+
+	std::printf("%8zu base lines  diffs %8.1f ms (%6zu + %6zu hunks)  merge %7.2f ms (%6zu regions, %5zu conflicts)"
+			"  %6.1f ns/line", base.size(), diffMs, hunks1.size(), hunks2.size(), mergeMs, regions.size(),
+			conflicts, nsPerLine);
+
+	if (prevNsPerLine > 0)
+		std::printf("  x%.2f", nsPerLine / prevNsPerLine);
+
+	std::printf("\n");
+
+	prevNsPerLine = nsPerLine;
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char* argv[])
+{
+	const int maxLines = (argc > 1) ? std::atoi(argv[1]) : 1000000;
+
+	double prevNsPerLine = 0;
+
+	for (int linesCount = maxLines / 8; linesCount <= maxLines; linesCount *= 2)
+		run(linesCount, prevNsPerLine);
+
+	return 0;
+}
@@ -0,0 +1,49 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdio>
+
+
+// Minimal checks for the unit tests - each test executable returns the number of failed checks
+
+static int testFailures = 0;
+
+
+#define CHECK(COND) \
+	do { \
+		if (!(COND)) { \
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #COND); \
+			++testFailures; \
+		} \
+	} while (0)
+
+
+#define CHECK_EQ(A, B)	CHECK((A) == (B))
+
+
+#define RUN_TEST(TEST) \
+	do { \
+		const int failuresBefore = testFailures; \
+		TEST(); \
+		std::printf("%s: %s\n", #TEST, (testFailures == failuresBefore) ? "ok" : "FAILED"); \
+	} while (0)
+
+
+#define TESTS_RESULT()	(testFailures ? 1 : 0)
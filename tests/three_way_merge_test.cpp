@@ -0,0 +1,328 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <vector>
+#include <algorithm>
+
+#include "three_way_merge.h"
+#include "test.h"
+
+
+namespace {
+
+// Side change spec - base lines [baseOff, baseOff + baseLen) replaced by the given lines
+struct Change
+{
+	int					baseOff;
+	int					baseLen;
+	std::vector<int>	lines;
+};
+
+
+/**
+ *  \struct Side
+ *  \brief  Side lines made from the base lines by changes (in base order) and the hunks of those changes
+ */
+struct Side
+{
+	Side(const std::vector<int>& base, const std::vector<Change>& changes)
+	{
+		int basePos = 0;
+
+		for (const auto& change: changes)
+		{
+			lines.insert(lines.end(), base.begin() + basePos, base.begin() + change.baseOff);
+
+			merge_hunk hunk;
+
+			hunk.base = merge_range(change.baseOff, change.baseLen);
+			hunk.side = merge_range(static_cast<int>(lines.size()), static_cast<int>(change.lines.size()));
+
+			hunks.emplace_back(hunk);
+
+			lines.insert(lines.end(), change.lines.begin(), change.lines.end());
+
+			basePos = change.baseOff + change.baseLen;
+		}
+
+		lines.insert(lines.end(), base.begin() + basePos, base.end());
+	}
+
+	std::vector<int>		lines;
+	std::vector<merge_hunk>	hunks;
+};
+
+
+std::vector<int> getBase(int linesCount)
+{
+	std::vector<int> base;
+
+	for (int i = 0; i < linesCount; ++i)
+		base.emplace_back(i);
+
+	return base;
+}
+
+
+std::vector<merge_region> merge(const std::vector<int>& base, const Side& ours, const Side& theirs)
+{
+	return merge_changes(ours.hunks, theirs.hunks, static_cast<int>(base.size()),
+			[&](const merge_range& oursLines, const merge_range& theirsLines)
+			{
+				return (oursLines.len == theirsLines.len &&
+						std::equal(ours.lines.begin() + oursLines.off,
+								ours.lines.begin() + oursLines.off + oursLines.len,
+								theirs.lines.begin() + theirsLines.off));
+			});
+}
+
+
+// Regions must cover the base and both sides lines in order and stable regions must be the same in all three
+bool areValidRegions(const std::vector<merge_region>& regions, const std::vector<int>& base, const Side& ours,
+		const Side& theirs)
+{
+	int basePos = 0;
+	int oursPos = 0;
+	int theirsPos = 0;
+
+	for (const auto& region: regions)
+	{
+		if (region.base.off != basePos || region.ours.off != oursPos || region.theirs.off != theirsPos)
+			return false;
+
+		if (region.type == MergeRegionType::STABLE)
+		{
+			if (region.ours.len != region.base.len || region.theirs.len != region.base.len ||
+					!std::equal(base.begin() + region.base.off, base.begin() + region.base.off + region.base.len,
+							ours.lines.begin() + region.ours.off) ||
+					!std::equal(base.begin() + region.base.off, base.begin() + region.base.off + region.base.len,
+							theirs.lines.begin() + region.theirs.off))
+				return false;
+		}
+
+		basePos		+= region.base.len;
+		oursPos		+= region.ours.len;
+		theirsPos	+= region.theirs.len;
+	}
+
+	return (basePos == static_cast<int>(base.size()) && oursPos == static_cast<int>(ours.lines.size()) &&
+			theirsPos == static_cast<int>(theirs.lines.size()));
+}
+
+
+bool isRegion(const merge_region& region, MergeRegionType type, int baseOff, int baseLen)
+{
+	return (region.type == type && region.base.off == baseOff && region.base.len == baseLen);
+}
+
+
+void testNoChanges()
+{
+	const std::vector<int> base = getBase(10);
+
+	const Side ours(base, {});
+	const Side theirs(base, {});
+
+	const auto regions = merge(base, ours, theirs);
+
+	CHECK(areValidRegions(regions, base, ours, theirs));
+	CHECK_EQ(regions.size(), 1u);
+	CHECK(isRegion(regions[0], MergeRegionType::STABLE, 0, 10));
+}
+
+
+void testSeparateChanges()
+{
+	const std::vector<int> base = getBase(10);
+
+	const Side ours(base, { { 2, 1, { 100, 101 } } });
+	const Side theirs(base, { { 7, 1, {} } });
+
+	const auto regions = merge(base, ours, theirs);
+
+	CHECK(areValidRegions(regions, base, ours, theirs));
+	CHECK_EQ(regions.size(), 5u);
+
+	if (regions.size() == 5)
+	{
+		CHECK(isRegion(regions[1], MergeRegionType::CHANGED_OURS, 2, 1));
+		CHECK(isRegion(regions[3], MergeRegionType::CHANGED_THEIRS, 7, 1));
+
+		// Our side is one line longer past our change
+		CHECK_EQ(regions[3].ours.off, 8);
+		CHECK_EQ(regions[3].theirs.len, 0);
+	}
+}
+
+
+void testTouchingHunks()
+{
+	const std::vector<int> base = getBase(10);
+
+	const Side ours(base, { { 2, 3, { 100 } } });
+	const Side theirs(base, { { 5, 2, { 200, 201, 202 } } });
+
+	const auto regions = merge(base, ours, theirs);
+
+	CHECK(areValidRegions(regions, base, ours, theirs));
+	CHECK_EQ(regions.size(), 3u);
+
+	if (regions.size() == 3)
+		CHECK(isRegion(regions[1], MergeRegionType::CONFLICT, 2, 5));
+}
+
+
+void testOverlappingHunks()
+{
+	const std::vector<int> base = getBase(12);
+
+	// Our second change overlaps only with their change, which overlaps with our first one - all in one region
+	const Side ours(base, { { 2, 2, { 100 } }, { 6, 2, {} } });
+	const Side theirs(base, { { 3, 4, { 200, 201 } } });
+
+	const auto regions = merge(base, ours, theirs);
+
+	CHECK(areValidRegions(regions, base, ours, theirs));
+	CHECK_EQ(regions.size(), 3u);
+
+	if (regions.size() == 3)
+		CHECK(isRegion(regions[1], MergeRegionType::CONFLICT, 2, 6));
+}
+
+
+void testInsertionsAtSamePosition()
+{
+	const std::vector<int> base = getBase(8);
+
+	{
+		const Side ours(base, { { 4, 0, { 100, 101 } } });
+		const Side theirs(base, { { 4, 0, { 200 } } });
+
+		const auto regions = merge(base, ours, theirs);
+
+		CHECK(areValidRegions(regions, base, ours, theirs));
+		CHECK_EQ(regions.size(), 3u);
+
+		if (regions.size() == 3)
+		{
+			CHECK(isRegion(regions[1], MergeRegionType::CONFLICT, 4, 0));
+			CHECK_EQ(regions[1].ours.len, 2);
+			CHECK_EQ(regions[1].theirs.len, 1);
+		}
+	}
+
+	{
+		const Side ours(base, { { 4, 0, { 100, 101 } } });
+		const Side theirs(base, { { 4, 0, { 100, 101 } } });
+
+		const auto regions = merge(base, ours, theirs);
+
+		CHECK(areValidRegions(regions, base, ours, theirs));
+		CHECK_EQ(regions.size(), 3u);
+
+		if (regions.size() == 3)
+			CHECK(isRegion(regions[1], MergeRegionType::CHANGED_BOTH, 4, 0));
+	}
+}
+
+
+void testInsertionAtChangeEnd()
+{
+	const std::vector<int> base = getBase(8);
+
+	const Side ours(base, { { 5, 0, { 100 } } });
+	const Side theirs(base, { { 3, 2, { 200, 201 } } });
+
+	const auto regions = merge(base, ours, theirs);
+
+	CHECK(areValidRegions(regions, base, ours, theirs));
+	CHECK_EQ(regions.size(), 3u);
+
+	if (regions.size() == 3)
+		CHECK(isRegion(regions[1], MergeRegionType::CONFLICT, 3, 2));
+}
+
+
+void testChangedBothVsConflict()
+{
+	const std::vector<int> base = getBase(10);
+
+	{
+		const Side ours(base, { { 0, 1, {} }, { 3, 2, { 100, 101, 102 } } });
+		const Side theirs(base, { { 3, 2, { 100, 101, 102 } }, { 9, 1, { 200 } } });
+
+		const auto regions = merge(base, ours, theirs);
+
+		CHECK(areValidRegions(regions, base, ours, theirs));
+		CHECK_EQ(regions.size(), 5u);
+
+		if (regions.size() == 5)
+		{
+			CHECK(isRegion(regions[0], MergeRegionType::CHANGED_OURS, 0, 1));
+			CHECK(isRegion(regions[2], MergeRegionType::CHANGED_BOTH, 3, 2));
+			CHECK(isRegion(regions[4], MergeRegionType::CHANGED_THEIRS, 9, 1));
+		}
+	}
+
+	{
+		const Side ours(base, { { 3, 2, { 100, 101, 102 } } });
+		const Side theirs(base, { { 3, 2, { 100, 101 } } });
+
+		const auto regions = merge(base, ours, theirs);
+
+		CHECK(areValidRegions(regions, base, ours, theirs));
+		CHECK_EQ(regions.size(), 3u);
+
+		if (regions.size() == 3)
+			CHECK(isRegion(regions[1], MergeRegionType::CONFLICT, 3, 2));
+	}
+}
+
+
+void testEmptyBase()
+{
+	const std::vector<int> base;
+
+	const Side ours(base, { { 0, 0, { 100 } } });
+	const Side theirs(base, {});
+
+	const auto regions = merge(base, ours, theirs);
+
+	CHECK(areValidRegions(regions, base, ours, theirs));
+	CHECK_EQ(regions.size(), 1u);
+
+	if (regions.size() == 1)
+		CHECK(isRegion(regions[0], MergeRegionType::CHANGED_OURS, 0, 0));
+}
+
+} // anonymous namespace
+
+
+int main()
+{
+	RUN_TEST(testNoChanges);
+	RUN_TEST(testSeparateChanges);
+	RUN_TEST(testTouchingHunks);
+	RUN_TEST(testOverlappingHunks);
+	RUN_TEST(testInsertionsAtSamePosition);
+	RUN_TEST(testInsertionAtChangeEnd);
+	RUN_TEST(testChangedBothVsConflict);
+	RUN_TEST(testEmptyBase);
+
+	return TESTS_RESULT();
+}
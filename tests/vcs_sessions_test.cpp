@@ -0,0 +1,194 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <vector>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "vcs_sessions.h"
+#include "test.h"
+
+
+namespace {
+
+// Session closing order is recorded to check what got released and when
+struct FakeSession
+{
+	int id {0};
+};
+
+
+std::vector<int> freedSessions;
+
+
+void freeFakeSession(FakeSession& session)
+{
+	freedSessions.push_back(session.id);
+}
+
+
+FakeSession fake(int id)
+{
+	FakeSession session;
+	session.id = id;
+
+	return session;
+}
+
+
+void testDirsResolution()
+{
+	freedSessions.clear();
+
+	session_mru<FakeSession> sessions(4, 1000, freeFakeSession);
+
+	CHECK(sessions.find_dir("/repo/src", 0) == nullptr);
+
+	sessions.add("/repo/", "/repo/src", fake(1), 0);
+
+	auto* known = sessions.find_dir("/repo/src", 10);
+
+	CHECK(known != nullptr);
+	CHECK_EQ(known->session.id, 1);
+	CHECK_EQ(known->root, std::string("/repo/"));
+
+	// Another dir of the same repository is resolved by its root once and is known afterwards
+	CHECK(sessions.find_dir("/repo/doc", 20) == nullptr);
+	CHECK(sessions.find_root("/repo/", "/repo/doc", 20) == known);
+	CHECK(sessions.find_dir("/repo/doc", 30) == known);
+
+	CHECK(sessions.find_root("/other/", "/other", 30) == nullptr);
+	CHECK_EQ(sessions.size(), 1u);
+
+	sessions.clear();
+
+	CHECK(sessions.empty());
+	CHECK_EQ(freedSessions.size(), 1u);
+}
+
+
+void testMruEviction()
+{
+	freedSessions.clear();
+
+	session_mru<FakeSession> sessions(2, 1000, freeFakeSession);
+
+	sessions.add("/a/", "/a", fake(1), 0);
+	sessions.add("/b/", "/b", fake(2), 0);
+
+	// Using /a makes /b the least recently used one
+	CHECK(sessions.find_dir("/a", 1) != nullptr);
+
+	sessions.add("/c/", "/c", fake(3), 2);
+
+	CHECK_EQ(sessions.size(), 2u);
+	CHECK_EQ(freedSessions.size(), 1u);
+	CHECK_EQ(freedSessions[0], 2);
+
+	CHECK(sessions.find_dir("/b", 3) == nullptr);
+	CHECK(sessions.find_dir("/a", 3) != nullptr);
+	CHECK(sessions.find_dir("/c", 3) != nullptr);
+
+	sessions.clear();
+}
+
+
+void testIdleRelease()
+{
+	freedSessions.clear();
+
+	session_mru<FakeSession> sessions(4, 1000, freeFakeSession);
+
+	sessions.add("/a/", "/a", fake(1), 0);
+	sessions.add("/b/", "/b", fake(2), 500);
+
+	CHECK_EQ(sessions.release_idle(999), 2u);
+	CHECK(freedSessions.empty());
+
+	// Only the session unused for the whole timeout is released
+	CHECK_EQ(sessions.release_idle(1000), 1u);
+	CHECK_EQ(freedSessions.size(), 1u);
+	CHECK_EQ(freedSessions[0], 1);
+
+	// A use restarts the idle time
+	CHECK(sessions.find_dir("/b", 1400) != nullptr);
+	CHECK_EQ(sessions.release_idle(2000), 1u);
+	CHECK_EQ(sessions.release_idle(2400), 0u);
+
+	CHECK_EQ(freedSessions.size(), 2u);
+	CHECK(sessions.find_dir("/b", 2500) == nullptr);
+}
+
+
+void testIdleReleaseTimeWrap()
+{
+	freedSessions.clear();
+
+	session_mru<FakeSession> sessions(4, 1000, freeFakeSession);
+
+	const uint32_t start = 0xFFFFFF00u;
+
+	sessions.add("/a/", "/a", fake(1), start);
+
+	CHECK_EQ(sessions.release_idle(start + 500), 1u);
+	CHECK_EQ(sessions.release_idle(start + 1000), 0u);
+	CHECK_EQ(freedSessions.size(), 1u);
+}
+
+
+void testBlobContentKey()
+{
+	const unsigned char id1[4] = { 1, 2, 3, 4 };
+	const unsigned char id2[4] = { 1, 2, 3, 5 };
+
+	const std::string key = git_blob_content_key("/repo/", id1, sizeof(id1), "a.txt");
+
+	CHECK(key == git_blob_content_key("/repo/", id1, sizeof(id1), "a.txt"));
+
+	// Any of the parts makes a different key
+	CHECK(key != git_blob_content_key("/repo2/", id1, sizeof(id1), "a.txt"));
+	CHECK(key != git_blob_content_key("/repo/", id2, sizeof(id2), "a.txt"));
+	CHECK(key != git_blob_content_key("/repo/", id1, sizeof(id1), "b.txt"));
+
+	// Work dir and blob id bytes must not run into each other
+	const unsigned char idA[4] = { 'x', 2, 3, 4 };
+	const unsigned char idB[4] = { 2, 3, 4, 'a' };
+
+	CHECK(git_blob_content_key("/r", idA, sizeof(idA), "a.txt") !=
+			git_blob_content_key("/rx", idB, sizeof(idB), ".txt"));
+
+	// The key holds the raw blob id bytes - NUL bytes included
+	const unsigned char idZero[4] = { 0, 0, 0, 0 };
+
+	CHECK_EQ(git_blob_content_key("/repo/", idZero, sizeof(idZero), "a.txt").size(), 6u + 1u + 4u + 5u);
+}
+
+} // anonymous namespace
+
+
+int main()
+{
+	RUN_TEST(testDirsResolution);
+	RUN_TEST(testMruEviction);
+	RUN_TEST(testIdleRelease);
+	RUN_TEST(testIdleReleaseTimeWrap);
+	RUN_TEST(testBlobContentKey);
+
+	return TESTS_RESULT();
+}
@@ -0,0 +1,151 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Words segmentation benchmark - not run by the tests:
+ *   wordseg_bench [MB]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <string>
+#include <random>
+#include <chrono>
+
+#include "wordseg.h"
+
+
+namespace {
+
+std::string makeText(size_t size, bool utf8)
+{
+	const char* const asciiPieces[] = { "int", " ", "value", "_count", " = ", "(", "x", ", ", "42", ");",
+			"    ", "return", " ", "{", "}", "\t", "->", "data", "[i]", " + ", "1", "\n" };
+	const char* const utf8Pieces[] = { "na\xC3\xAFve", " ", "\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E", "\xE3\x80\x81",
+			"caf\xC3\xA9", "\xE2\x80\x94", "\xC2\xAB", "\xC2\xBB", "\xF0\x9F\x98\x80" };
+
+	std::mt19937 rng(1);
+	std::string text;
+
+	text.reserve(size + 64);
+
+	while (text.size() < size)
+	{
+		if (utf8 && (rng() % 4 == 0))
+			text += utf8Pieces[rng() % (sizeof(utf8Pieces) / sizeof(utf8Pieces[0]))];
+		else
+			text += asciiPieces[rng() % (sizeof(asciiPieces) / sizeof(asciiPieces[0]))];
+	}
+
+	return text;
+}
+
+
+// Per-byte classification through the C library - like the former locale dependent classifier (all non-ASCII
+// bytes are word chars, no UTF-8 punctuation)
+inline char_type classifyByte(unsigned char ch)
+{
+	return (ch == ' ' || ch == '\t') ? char_type::SPACE :
+			(std::isalnum(ch) || ch == '_' || ch >= 0x80) ? char_type::ALNUM : char_type::OTHER;
+}
+
+
+struct PerByte
+{
+	template <typename WordHandler>
+	void operator()(const char* text, int len, WordHandler&& onWord) const
+	{
+		if (len <= 0)
+			return;
+
+		int wordStart = 0;
+		char_type wordType = classifyByte(text[0]);
+
+		for (int i = 1; i < len; ++i)
+		{
+			const char_type type = classifyByte(text[i]);
+
+			if (type != wordType)
+			{
+				onWord(wordStart, i - wordStart, wordType);
+
+				wordStart	= i;
+				wordType	= type;
+			}
+		}
+
+		onWord(wordStart, len - wordStart, wordType);
+	}
+};
+
+
+struct SegmentWords
+{
+	template <typename WordHandler>
+	void operator()(const char* text, int len, WordHandler&& onWord) const
+	{
+		segment_words(text, len, onWord);
+	}
+};
+
+
+template <typename Segmenter>
+void run(const char* name, const std::string& text, const Segmenter& segmenter)
+{
+	// Segmented in lines as the engine does
+	const char* const data = text.data();
+	const int size = static_cast<int>(text.size());
+
+	size_t words = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for (int pos = 0; pos < size;)
+	{
+		int end = pos;
+
+		while (end < size && data[end] != '\n')
+			++end;
+
+		segmenter(data + pos, end - pos, [&words](int, int, char_type) { ++words; });
+
+		pos = end + 1;
+	}
+
+	const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	std::printf("%-28s %8.1f ms  %8.1f MB/s  %zu words\n", name, ms, text.size() / (ms * 1000.0), words);
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char* argv[])
+{
+	const size_t size = static_cast<size_t>((argc > 1) ? std::atoi(argv[1]) : 50) * 1024 * 1024;
+
+	const std::string ascii	= makeText(size, false);
+	const std::string utf8	= makeText(size, true);
+
+	run("ASCII segment_words", ascii, SegmentWords());
+	run("ASCII per-byte isalnum", ascii, PerByte());
+	run("UTF-8 segment_words", utf8, SegmentWords());
+	run("UTF-8 per-byte isalnum", utf8, PerByte());
+
+	return 0;
+}
@@ -0,0 +1,188 @@
+/*
+ * This file is part of Compare plugin for Notepad++
+ * Copyright (C)2017-2018 Pavel Nedev (pg.nedev@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+#include <vector>
+#include <random>
+
+#include "wordseg.h"
+#include "test.h"
+
+
+namespace {
+
+struct Word
+{
+	std::string	text;
+	char_type	type;
+
+	bool operator==(const Word& rhs) const
+	{
+		return (text == rhs.text && type == rhs.type);
+	}
+};
+
+
+std::vector<Word> getWords(const std::string& text)
+{
+	std::vector<Word> words;
+
+	segment_words(text.data(), static_cast<int>(text.size()),
+			[&](int pos, int len, char_type type) { words.push_back(Word { text.substr(pos, len), type }); });
+
+	return words;
+}
+
+
+// Char by char reference segmentation
+std::vector<Word> getWordsRef(const std::string& text)
+{
+	std::vector<Word> words;
+
+	const int len = static_cast<int>(text.size());
+
+	for (int i = 0, charLen; i < len; i += charLen)
+	{
+		const char_type type = get_char_type(text.data(), i, len, charLen);
+
+		if (words.empty() || words.back().type != type)
+			words.push_back(Word { std::string(), type });
+
+		words.back().text.append(text, i, charLen);
+	}
+
+	return words;
+}
+
+
+void testAscii()
+{
+	const std::vector<Word> expected {
+		{ "foo", char_type::ALNUM }, { " ", char_type::SPACE }, { "bar_1", char_type::ALNUM },
+		{ "+=", char_type::OTHER }, { "x", char_type::ALNUM }, { "\t ", char_type::SPACE }, { ";", char_type::OTHER }
+	};
+
+	CHECK(getWords("foo bar_1+=x\t ;") == expected);
+}
+
+
+void testUtf8Punctuation()
+{
+	// Em dash
+	{
+		const std::vector<Word> expected {
+			{ "foo", char_type::ALNUM }, { "\xE2\x80\x94", char_type::OTHER }, { "bar", char_type::ALNUM }
+		};
+
+		CHECK(getWords("foo\xE2\x80\x94" "bar") == expected);
+	}
+
+	// Guillemets and no-break space
+	{
+		const std::vector<Word> expected {
+			{ "\xC2\xAB", char_type::OTHER }, { "abc", char_type::ALNUM }, { "\xC2\xBB\xC2\xA0", char_type::OTHER }
+		};
+
+		CHECK(getWords("\xC2\xAB" "abc\xC2\xBB\xC2\xA0") == expected);
+	}
+
+	// CJK ideographic comma and fullwidth exclamation mark
+	{
+		const std::vector<Word> expected {
+			{ "\xE6\x97\xA5\xE6\x9C\xAC", char_type::ALNUM }, { "\xE3\x80\x81", char_type::OTHER },
+			{ "\xE3\x83\x86", char_type::ALNUM }, { "\xEF\xBC\x81", char_type::OTHER }
+		};
+
+		CHECK(getWords("\xE6\x97\xA5\xE6\x9C\xAC\xE3\x80\x81\xE3\x83\x86\xEF\xBC\x81") == expected);
+	}
+
+	// Math and currency symbols
+	CHECK(get_utf8_char_type(0xC3, 0x97, 0) == char_type::OTHER);
+	CHECK(get_utf8_char_type(0xE2, 0x82, 0xAC) == char_type::OTHER);
+	CHECK(get_utf8_char_type(0xE2, 0x88, 0x9E) == char_type::OTHER);
+}
+
+
+void testUtf8Letters()
+{
+	// Accented letters and the Latin-1 letters and numbers stay in their words
+	const std::vector<Word> expected {
+		{ "na\xC3\xAFve", char_type::ALNUM }, { " ", char_type::SPACE }, { "caf\xC3\xA9", char_type::ALNUM },
+		{ " ", char_type::SPACE }, { "x\xC2\xB2", char_type::ALNUM }, { " ", char_type::SPACE },
+		{ "\xF0\x9F\x98\x80", char_type::ALNUM }
+	};
+
+	CHECK(getWords("na\xC3\xAFve caf\xC3\xA9 x\xC2\xB2 \xF0\x9F\x98\x80") == expected);
+}
+
+
+void testTruncatedChar()
+{
+	const std::vector<Word> expected { { "ab", char_type::ALNUM }, { "\xE2\x80", char_type::OTHER } };
+
+	CHECK(getWords("ab\xE2\x80") == expected);
+
+	// Stray continuation byte
+	CHECK_EQ(getWords("a\x80" "b").size(), 1u);
+}
+
+
+// Chunked segmentation matches the char by char one at all offsets and chunk boundaries
+void testMatchesReference()
+{
+	const char* const pieces[] = { "a", "Z", "9", "_", " ", "\t", "(", "=", "\xC3\xA9", "\xE2\x80\x94",
+			"\xE3\x80\x81", "\xE6\x97\xA5", "\xF0\x9F\x98\x80", "\xC2\xAB", "\x80" };
+
+	std::mt19937 rng(12345);
+	std::uniform_int_distribution<int> pieceDist(0, sizeof(pieces) / sizeof(pieces[0]) - 1);
+	std::uniform_int_distribution<int> lenDist(0, 80);
+
+	for (int n = 0; n < 20000; ++n)
+	{
+		std::string text;
+
+		for (int count = lenDist(rng), i = 0; i < count; ++i)
+		{
+			// Long ASCII runs to hit the vectorized path
+			if (i % 16 == 0 && (rng() & 1))
+				text.append("abc def_123 ==  ");
+			else
+				text.append(pieces[pieceDist(rng)]);
+		}
+
+		if (getWords(text) != getWordsRef(text))
+		{
+			CHECK(!"segmentation differs from the reference");
+			return;
+		}
+	}
+}
+
+} // anonymous namespace
+
+
+int main()
+{
+	RUN_TEST(testAscii);
+	RUN_TEST(testUtf8Punctuation);
+	RUN_TEST(testUtf8Letters);
+	RUN_TEST(testTruncatedChar);
+	RUN_TEST(testMatchesReference);
+
+	return TESTS_RESULT();
+}